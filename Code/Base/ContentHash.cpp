@@ -0,0 +1,141 @@
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "Base/ContentHash.h"
+#include "Base/ParallelFor.h"
+
+namespace
+{
+    const uint64_t kC1 = 0x87c37b91114253d5ull;
+    const uint64_t kC2 = 0x4cf5ad432745937full;
+
+    // Blocks hashed separately, a worker takes at least a few of them
+    const size_t kBlockSize = 1 << 18;
+    const size_t kMinBlocksPerThread = 4;
+
+    static uint64_t RotateLeft(uint64_t value, int bits)
+    {
+        return (value << bits) | (value >> (64 - bits));
+    }
+
+    static uint64_t Mix(uint64_t value)
+    {
+        value ^= value >> 33;
+        value *= 0xff51afd7ed558ccdull;
+        value ^= value >> 33;
+        value *= 0xc4ceb9fe1a85ec53ull;
+        value ^= value >> 33;
+        return value;
+    }
+
+    static uint64_t MixLow(uint64_t k)
+    {
+        k *= kC1;
+        k = RotateLeft(k, 31);
+        k *= kC2;
+        return k;
+    }
+
+    static uint64_t MixHigh(uint64_t k)
+    {
+        k *= kC2;
+        k = RotateLeft(k, 33);
+        k *= kC1;
+        return k;
+    }
+}
+
+Hash128 ComputeHash128(const void* data, size_t size, uint64_t seed)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    const size_t stripesCount = size / 16;
+
+    uint64_t h1 = seed;
+    uint64_t h2 = seed;
+
+    for (size_t i = 0; i < stripesCount; ++i)
+    {
+        // Data may be unaligned
+        uint64_t k[2];
+        memcpy(k, bytes + i * 16, sizeof(k));
+
+        h1 ^= MixLow(k[0]);
+        h1 = RotateLeft(h1, 27);
+        h1 += h2;
+        h1 = h1 * 5 + 0x52dce729;
+
+        h2 ^= MixHigh(k[1]);
+        h2 = RotateLeft(h2, 31);
+        h2 += h1;
+        h2 = h2 * 5 + 0x38495ab5;
+    }
+
+    const uint8_t* tail = bytes + stripesCount * 16;
+    const size_t tailSize = size & 15;
+
+    uint64_t k1 = 0;
+    uint64_t k2 = 0;
+
+    for (size_t i = 0; i < tailSize; ++i)
+    {
+        if (i < 8)
+        {
+            k1 |= static_cast<uint64_t>(tail[i]) << (i * 8);
+        }
+        else
+        {
+            k2 |= static_cast<uint64_t>(tail[i]) << ((i - 8) * 8);
+        }
+    }
+
+    if (tailSize > 8)
+    {
+        h2 ^= MixHigh(k2);
+    }
+
+    if (tailSize > 0)
+    {
+        h1 ^= MixLow(k1);
+    }
+
+    h1 ^= static_cast<uint64_t>(size);
+    h2 ^= static_cast<uint64_t>(size);
+
+    h1 += h2;
+    h2 += h1;
+
+    h1 = Mix(h1);
+    h2 = Mix(h2);
+
+    h1 += h2;
+    h2 += h1;
+
+    return Hash128(h1, h2);
+}
+
+Hash128 ComputeContentHash(const void* data, size_t size, uint64_t seed)
+{
+    if (size <= kBlockSize)
+    {
+        return ComputeHash128(data, size, seed);
+    }
+
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    const size_t blocksCount = (size + kBlockSize - 1) / kBlockSize;
+
+    // Every block is seeded with its index, so reordered blocks differ
+    std::vector<Hash128> blockHashes(blocksCount);
+
+    ParallelFor(blocksCount, kMinBlocksPerThread, [&](size_t begin, size_t end)
+    {
+        for (size_t block = begin; block < end; ++block)
+        {
+            const size_t offset = block * kBlockSize;
+            const size_t blockSize = std::min(kBlockSize, size - offset);
+            blockHashes[block] = ComputeHash128(bytes + offset, blockSize, seed + block);
+        }
+    });
+
+    return ComputeHash128(blockHashes.data(), blocksCount * sizeof(Hash128), seed ^ size);
+}
\ No newline at end of file
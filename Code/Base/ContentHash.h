@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+struct Hash128
+{
+    Hash128() :
+        m_low(0), m_high(0) {}
+
+    explicit Hash128(uint64_t low, uint64_t high) :
+        m_low(low), m_high(high) {}
+
+    bool operator== (const Hash128& other) const
+    {
+        return m_low == other.m_low && m_high == other.m_high;
+    }
+
+    bool operator!= (const Hash128& other) const
+    {
+        return !(*this == other);
+    }
+
+    uint64_t m_low;
+    uint64_t m_high;
+};
+
+// Lets Hash128 be a key of unordered containers
+struct Hash128Hasher
+{
+    size_t operator() (const Hash128& hash) const
+    {
+        return static_cast<size_t>(hash.m_low ^ (hash.m_high * 0x9e3779b97f4a7c15ull));
+    }
+};
+
+/* MurmurHash3 x64 128 bit variant. Fast and well distributed but not
+ * cryptographic, good to find identical data without comparing it.
+ */
+Hash128 ComputeHash128(const void* data, size_t size, uint64_t seed = 0);
+
+/* Hash of large data is built from hashes of fixed size blocks, which
+ * are computed on worker threads. Result depends only on data and seed,
+ * but differs from ComputeHash128 for data larger than one block.
+ */
+Hash128 ComputeContentHash(const void* data, size_t size, uint64_t seed = 0);
\ No newline at end of file
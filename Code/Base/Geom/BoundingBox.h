@@ -23,6 +23,29 @@ public:
 
     bool IsValid() const { return min.x() <= max.x(); }
 
+    Vector3f GetCenter() const { return (min + max) * 0.5f; }
+
+    // Half of surface area, enough to compare boxes in SAH
+    float GetHalfArea() const
+    {
+        const Vector3f size = max - min;
+        return size.x() * size.y() + size.y() * size.z() + size.z() * size.x();
+    }
+
+    bool Contains(const BoundingBox3f& b) const
+    {
+        return
+            min.x() <= b.min.x() && min.y() <= b.min.y() && min.z() <= b.min.z() &&
+            max.x() >= b.max.x() && max.y() >= b.max.y() && max.z() >= b.max.z();
+    }
+
+    bool Intersects(const BoundingBox3f& b) const
+    {
+        return
+            min.x() <= b.max.x() && min.y() <= b.max.y() && min.z() <= b.max.z() &&
+            max.x() >= b.min.x() && max.y() >= b.min.y() && max.z() >= b.min.z();
+    }
+
     void Enlarge(float val)
     {
         assert(val > -std::numeric_limits<float>::epsilon());
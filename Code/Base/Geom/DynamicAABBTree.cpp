@@ -0,0 +1,766 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <thread>
+
+#include "Base/Geom/DynamicAABBTree.h"
+
+namespace
+{
+    const int kNullNode = -1;
+    const int kBinsCount = 16;
+
+    // Leaf box margin relative to its largest size
+    const float kFatMarginRatio = 0.1f;
+    const float kMinFatMargin = 1.0e-3f;
+
+    // Ranges smaller than this are not worth a thread
+    const int kMinParallelBuildRange = 16384;
+
+    static BoundingBox3f Union(const BoundingBox3f& a, const BoundingBox3f& b)
+    {
+        if (!a.IsValid())
+        {
+            return b;
+        }
+
+        if (!b.IsValid())
+        {
+            return a;
+        }
+
+        BoundingBox3f result(a);
+        result += b;
+        return result;
+    }
+
+    // Frustum planes which still have to be tested for children
+    static bool ClassifyBox(const Frustum& frustum, const BoundingBox3f& box, int* planesMask)
+    {
+        const Vector3f center = box.GetCenter();
+        const Vector3f extent = (box.max - box.min) * 0.5f;
+
+        for (int plane = 0; plane < Frustum::PlanesCount; ++plane)
+        {
+            if ((*planesMask & (1 << plane)) == 0)
+            {
+                continue;
+            }
+
+            const Vector4f& p = frustum.GetPlane(plane);
+
+            const float distance = p.x() * center.x() + p.y() * center.y() + p.z() * center.z() + p.w();
+            const float radius =
+                std::abs(p.x()) * extent.x() +
+                std::abs(p.y()) * extent.y() +
+                std::abs(p.z()) * extent.z();
+
+            if (distance + radius < 0.0f)
+            {
+                return false;
+            }
+
+            // Box is fully inside this plane, so are the children
+            if (distance - radius >= 0.0f)
+            {
+                *planesMask &= ~(1 << plane);
+            }
+        }
+
+        return true;
+    }
+}
+
+struct DynamicAABBTree::BuildItem
+{
+    BoundingBox3f m_box;
+    Vector3f m_centroid;
+    int m_index;
+};
+
+DynamicAABBTree::DynamicAABBTree() :
+    m_root(kNullNode),
+    m_freeList(kNullNode),
+    m_proxiesCount(0)
+{
+}
+
+void DynamicAABBTree::Clear()
+{
+    m_nodes.clear();
+    m_root = kNullNode;
+    m_freeList = kNullNode;
+    m_proxiesCount = 0;
+}
+
+void DynamicAABBTree::Build(const std::vector<BoundingBox3f>& boxes, std::vector<int>* proxies)
+{
+    assert(proxies != nullptr);
+
+    Clear();
+
+    proxies->resize(boxes.size());
+
+    if (boxes.empty())
+    {
+        return;
+    }
+
+    const int count = static_cast<int>(boxes.size());
+    std::vector<BuildItem> items(boxes.size());
+
+    ParallelFor(boxes.size(), 4096, [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            BuildItem& item = items[i];
+            item.m_box = Enlarge(boxes[i]);
+            item.m_centroid = item.m_box.GetCenter();
+            item.m_index = static_cast<int>(i);
+        }
+    });
+
+    // Tree with one object per leaf has exactly 2n - 1 nodes, so every
+    // subtree knows its node range in advance and can be built independently
+    m_nodes.resize(static_cast<size_t>(count) * 2 - 1);
+
+    int parallelDepth = 0;
+
+    while ((static_cast<size_t>(1) << parallelDepth) < GetWorkerThreadsCount())
+    {
+        ++parallelDepth;
+    }
+
+    BuildRange(items, 0, count, 0, kNullNode, parallelDepth);
+
+    m_root = 0;
+    m_proxiesCount = count;
+
+    for (size_t node = 0; node < m_nodes.size(); ++node)
+    {
+        if (m_nodes[node].IsLeaf())
+        {
+            (*proxies)[m_nodes[node].m_userData] = static_cast<int>(node);
+        }
+    }
+}
+
+void DynamicAABBTree::BuildRange(std::vector<BuildItem>& items, int begin, int end,
+    int nodeIndex, int parent, int parallelDepth)
+{
+    Node& node = m_nodes[nodeIndex];
+    node.m_parent = parent;
+
+    const int count = end - begin;
+
+    if (count == 1)
+    {
+        node.m_box = items[begin].m_box;
+        node.m_left = kNullNode;
+        node.m_right = kNullNode;
+        node.m_height = 0;
+        node.m_userData = items[begin].m_index;
+        return;
+    }
+
+    BoundingBox3f centroidBounds = BoundingBox3f::kInvalid;
+
+    for (int i = begin; i < end; ++i)
+    {
+        centroidBounds += items[i].m_centroid;
+    }
+
+    const Vector3f extent = centroidBounds.max - centroidBounds.min;
+    int middle = begin + count / 2;
+
+    int bestAxis = -1;
+    int bestBin = 0;
+    float bestCost = 0.0f;
+
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        if (!(extent[axis] > 0.0f))
+        {
+            continue;
+        }
+
+        BoundingBox3f binBoxes[kBinsCount];
+        int binCounts[kBinsCount] = {};
+
+        std::fill(binBoxes, binBoxes + kBinsCount, BoundingBox3f::kInvalid);
+
+        const float scale = kBinsCount / extent[axis];
+
+        for (int i = begin; i < end; ++i)
+        {
+            const int bin = std::min(kBinsCount - 1, static_cast<int>(
+                (items[i].m_centroid[axis] - centroidBounds.min[axis]) * scale));
+
+            binBoxes[bin] = Union(binBoxes[bin], items[i].m_box);
+            ++binCounts[bin];
+        }
+
+        float rightAreas[kBinsCount];
+        int rightCounts[kBinsCount];
+        BoundingBox3f accumulated = BoundingBox3f::kInvalid;
+        int accumulatedCount = 0;
+
+        for (int bin = kBinsCount - 1; bin > 0; --bin)
+        {
+            accumulated = Union(accumulated, binBoxes[bin]);
+            accumulatedCount += binCounts[bin];
+            rightAreas[bin] = accumulatedCount > 0 ? accumulated.GetHalfArea() : 0.0f;
+            rightCounts[bin] = accumulatedCount;
+        }
+
+        accumulated = BoundingBox3f::kInvalid;
+        accumulatedCount = 0;
+
+        for (int bin = 0; bin + 1 < kBinsCount; ++bin)
+        {
+            accumulated = Union(accumulated, binBoxes[bin]);
+            accumulatedCount += binCounts[bin];
+
+            if (accumulatedCount == 0 || rightCounts[bin + 1] == 0)
+            {
+                continue;
+            }
+
+            const float cost = accumulated.GetHalfArea() * accumulatedCount +
+                rightAreas[bin + 1] * rightCounts[bin + 1];
+
+            if (bestAxis < 0 || cost < bestCost)
+            {
+                bestCost = cost;
+                bestAxis = axis;
+                bestBin = bin;
+            }
+        }
+    }
+
+    if (bestAxis >= 0)
+    {
+        const float scale = kBinsCount / extent[bestAxis];
+        const float minValue = centroidBounds.min[bestAxis];
+
+        middle = static_cast<int>(std::partition(items.begin() + begin, items.begin() + end,
+            [=](const BuildItem& item)
+        {
+            return std::min(kBinsCount - 1, static_cast<int>(
+                (item.m_centroid[bestAxis] - minValue) * scale)) <= bestBin;
+        }) - items.begin());
+    }
+
+    // Same centroids can't be separated, any split is as good
+    if (middle == begin || middle == end)
+    {
+        middle = begin + count / 2;
+    }
+
+    const int left = nodeIndex + 1;
+    const int right = nodeIndex + 2 * (middle - begin);
+
+    if (parallelDepth > 0 && count >= kMinParallelBuildRange)
+    {
+        std::thread leftThread([&]()
+        {
+            BuildRange(items, begin, middle, left, nodeIndex, parallelDepth - 1);
+        });
+
+        BuildRange(items, middle, end, right, nodeIndex, parallelDepth - 1);
+        leftThread.join();
+    }
+    else
+    {
+        BuildRange(items, begin, middle, left, nodeIndex, 0);
+        BuildRange(items, middle, end, right, nodeIndex, 0);
+    }
+
+    // Node reference is still valid, nodes vector is not resized during build
+    node.m_left = left;
+    node.m_right = right;
+    node.m_box = Union(m_nodes[left].m_box, m_nodes[right].m_box);
+    node.m_height = 1 + std::max(m_nodes[left].m_height, m_nodes[right].m_height);
+    node.m_userData = -1;
+}
+
+int DynamicAABBTree::Insert(const BoundingBox3f& box, int userData)
+{
+    const int proxy = AllocateNode();
+
+    Node& node = m_nodes[proxy];
+    node.m_box = Enlarge(box);
+    node.m_userData = userData;
+    node.m_height = 0;
+
+    InsertLeaf(proxy);
+    ++m_proxiesCount;
+
+    return proxy;
+}
+
+void DynamicAABBTree::Remove(int proxy)
+{
+    assert(proxy >= 0 && proxy < static_cast<int>(m_nodes.size()));
+    assert(m_nodes[proxy].IsLeaf());
+
+    RemoveLeaf(proxy);
+    FreeNode(proxy);
+    --m_proxiesCount;
+}
+
+bool DynamicAABBTree::Move(int proxy, const BoundingBox3f& box)
+{
+    assert(proxy >= 0 && proxy < static_cast<int>(m_nodes.size()));
+    assert(m_nodes[proxy].IsLeaf());
+
+    if (m_nodes[proxy].m_box.Contains(box))
+    {
+        return false;
+    }
+
+    RemoveLeaf(proxy);
+    m_nodes[proxy].m_box = Enlarge(box);
+    InsertLeaf(proxy);
+
+    return true;
+}
+
+const BoundingBox3f& DynamicAABBTree::GetBoundingBox() const
+{
+    return m_root == kNullNode ? BoundingBox3f::kInvalid : m_nodes[m_root].m_box;
+}
+
+int DynamicAABBTree::GetHeight() const
+{
+    return m_root == kNullNode ? 0 : m_nodes[m_root].m_height;
+}
+
+void DynamicAABBTree::Query(const BoundingBox3f& box, std::vector<int>* userData) const
+{
+    assert(userData != nullptr);
+
+    if (m_root == kNullNode)
+    {
+        return;
+    }
+
+    std::vector<int> stack;
+    stack.reserve(64);
+    stack.push_back(m_root);
+
+    while (!stack.empty())
+    {
+        const Node& node = m_nodes[stack.back()];
+        stack.pop_back();
+
+        if (!node.m_box.Intersects(box))
+        {
+            continue;
+        }
+
+        if (node.IsLeaf())
+        {
+            userData->push_back(node.m_userData);
+        }
+        else
+        {
+            stack.push_back(node.m_right);
+            stack.push_back(node.m_left);
+        }
+    }
+}
+
+void DynamicAABBTree::Query(const Frustum& frustum, std::vector<int>* userData) const
+{
+    assert(userData != nullptr);
+
+    if (m_root == kNullNode)
+    {
+        return;
+    }
+
+    const int allPlanes = (1 << Frustum::PlanesCount) - 1;
+
+    // Node and planes which the node is not fully inside of
+    std::vector<std::pair<int, int>> stack;
+    stack.reserve(64);
+    stack.emplace_back(m_root, allPlanes);
+
+    while (!stack.empty())
+    {
+        const std::pair<int, int> item = stack.back();
+        stack.pop_back();
+
+        const Node& node = m_nodes[item.first];
+        int planesMask = item.second;
+
+        if (planesMask != 0 && !ClassifyBox(frustum, node.m_box, &planesMask))
+        {
+            continue;
+        }
+
+        if (node.IsLeaf())
+        {
+            userData->push_back(node.m_userData);
+        }
+        else
+        {
+            stack.emplace_back(node.m_right, planesMask);
+            stack.emplace_back(node.m_left, planesMask);
+        }
+    }
+}
+
+void DynamicAABBTree::Query(const std::vector<BoundingBox3f>& boxes,
+    std::vector<std::vector<int>>* userData) const
+{
+    assert(userData != nullptr);
+
+    userData->resize(boxes.size());
+
+    ParallelFor(boxes.size(), 16, [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            (*userData)[i].clear();
+            Query(boxes[i], &(*userData)[i]);
+        }
+    });
+}
+
+void DynamicAABBTree::Query(const std::vector<Frustum>& frustums,
+    std::vector<std::vector<int>>* userData) const
+{
+    assert(userData != nullptr);
+
+    userData->resize(frustums.size());
+
+    ParallelFor(frustums.size(), 1, [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            (*userData)[i].clear();
+            Query(frustums[i], &(*userData)[i]);
+        }
+    });
+}
+
+int DynamicAABBTree::AllocateNode()
+{
+    if (m_freeList == kNullNode)
+    {
+        const int oldSize = static_cast<int>(m_nodes.size());
+        const int newSize = std::max(16, oldSize * 2);
+
+        m_nodes.resize(static_cast<size_t>(newSize));
+
+        for (int i = oldSize; i < newSize; ++i)
+        {
+            m_nodes[i].m_parent = i + 1 < newSize ? i + 1 : kNullNode;
+            m_nodes[i].m_height = -1;
+        }
+
+        m_freeList = oldSize;
+    }
+
+    const int index = m_freeList;
+    Node& node = m_nodes[index];
+
+    m_freeList = node.m_parent;
+
+    node.m_parent = kNullNode;
+    node.m_left = kNullNode;
+    node.m_right = kNullNode;
+    node.m_height = 0;
+    node.m_userData = -1;
+
+    return index;
+}
+
+void DynamicAABBTree::FreeNode(int node)
+{
+    m_nodes[node].m_parent = m_freeList;
+    m_nodes[node].m_height = -1;
+    m_freeList = node;
+}
+
+void DynamicAABBTree::InsertLeaf(int leaf)
+{
+    if (m_root == kNullNode)
+    {
+        m_root = leaf;
+        m_nodes[leaf].m_parent = kNullNode;
+        return;
+    }
+
+    // Descend choosing child with the smallest area increase
+    const BoundingBox3f leafBox = m_nodes[leaf].m_box;
+    int index = m_root;
+
+    while (!m_nodes[index].IsLeaf())
+    {
+        const Node& node = m_nodes[index];
+
+        const float area = node.m_box.GetHalfArea();
+        const float combinedArea = Union(node.m_box, leafBox).GetHalfArea();
+
+        // Cost of making new parent for this node and the leaf
+        const float cost = 2.0f * combinedArea;
+
+        // Minimum cost of pushing the leaf further down
+        const float inheritanceCost = 2.0f * (combinedArea - area);
+
+        float childCosts[2];
+        const int children[2] = { node.m_left, node.m_right };
+
+        for (int i = 0; i < 2; ++i)
+        {
+            const Node& child = m_nodes[children[i]];
+            const float childArea = Union(child.m_box, leafBox).GetHalfArea();
+
+            childCosts[i] = inheritanceCost +
+                (child.IsLeaf() ? childArea : childArea - child.m_box.GetHalfArea());
+        }
+
+        if (cost < childCosts[0] && cost < childCosts[1])
+        {
+            break;
+        }
+
+        index = childCosts[0] < childCosts[1] ? children[0] : children[1];
+    }
+
+    const int sibling = index;
+    const int oldParent = m_nodes[sibling].m_parent;
+    const int newParent = AllocateNode();
+
+    Node& parent = m_nodes[newParent];
+    parent.m_parent = oldParent;
+    parent.m_box = Union(leafBox, m_nodes[sibling].m_box);
+    parent.m_height = m_nodes[sibling].m_height + 1;
+    parent.m_left = sibling;
+    parent.m_right = leaf;
+
+    if (oldParent != kNullNode)
+    {
+        Node& grandParent = m_nodes[oldParent];
+
+        if (grandParent.m_left == sibling)
+        {
+            grandParent.m_left = newParent;
+        }
+        else
+        {
+            grandParent.m_right = newParent;
+        }
+    }
+    else
+    {
+        m_root = newParent;
+    }
+
+    m_nodes[sibling].m_parent = newParent;
+    m_nodes[leaf].m_parent = newParent;
+
+    FixUpwards(m_nodes[leaf].m_parent);
+}
+
+void DynamicAABBTree::RemoveLeaf(int leaf)
+{
+    if (leaf == m_root)
+    {
+        m_root = kNullNode;
+        return;
+    }
+
+    const int parent = m_nodes[leaf].m_parent;
+    const int grandParent = m_nodes[parent].m_parent;
+    const int sibling = m_nodes[parent].m_left == leaf ?
+        m_nodes[parent].m_right : m_nodes[parent].m_left;
+
+    if (grandParent != kNullNode)
+    {
+        // Sibling takes place of the parent
+        if (m_nodes[grandParent].m_left == parent)
+        {
+            m_nodes[grandParent].m_left = sibling;
+        }
+        else
+        {
+            m_nodes[grandParent].m_right = sibling;
+        }
+
+        m_nodes[sibling].m_parent = grandParent;
+        FreeNode(parent);
+
+        FixUpwards(grandParent);
+    }
+    else
+    {
+        m_root = sibling;
+        m_nodes[sibling].m_parent = kNullNode;
+        FreeNode(parent);
+    }
+}
+
+void DynamicAABBTree::FixUpwards(int index)
+{
+    while (index != kNullNode)
+    {
+        index = Balance(index);
+
+        Node& node = m_nodes[index];
+        const Node& left = m_nodes[node.m_left];
+        const Node& right = m_nodes[node.m_right];
+
+        node.m_height = 1 + std::max(left.m_height, right.m_height);
+        node.m_box = Union(left.m_box, right.m_box);
+
+        index = node.m_parent;
+    }
+}
+
+// Rotates taller child up if subtrees heights differ by more than one
+int DynamicAABBTree::Balance(int indexA)
+{
+    Node& a = m_nodes[indexA];
+
+    if (a.IsLeaf() || a.m_height < 2)
+    {
+        return indexA;
+    }
+
+    const int indexB = a.m_left;
+    const int indexC = a.m_right;
+    Node& b = m_nodes[indexB];
+    Node& c = m_nodes[indexC];
+
+    const int balance = c.m_height - b.m_height;
+
+    if (balance > 1)
+    {
+        // C becomes parent of A
+        const int indexF = c.m_left;
+        const int indexG = c.m_right;
+        Node& f = m_nodes[indexF];
+        Node& g = m_nodes[indexG];
+
+        c.m_left = indexA;
+        c.m_parent = a.m_parent;
+        a.m_parent = indexC;
+
+        if (c.m_parent != kNullNode)
+        {
+            Node& parent = m_nodes[c.m_parent];
+
+            if (parent.m_left == indexA)
+            {
+                parent.m_left = indexC;
+            }
+            else
+            {
+                parent.m_right = indexC;
+            }
+        }
+        else
+        {
+            m_root = indexC;
+        }
+
+        // Taller child of C stays with C
+        if (f.m_height > g.m_height)
+        {
+            c.m_right = indexF;
+            a.m_right = indexG;
+            g.m_parent = indexA;
+            a.m_box = Union(b.m_box, g.m_box);
+            c.m_box = Union(a.m_box, f.m_box);
+            a.m_height = 1 + std::max(b.m_height, g.m_height);
+            c.m_height = 1 + std::max(a.m_height, f.m_height);
+        }
+        else
+        {
+            c.m_right = indexG;
+            a.m_right = indexF;
+            f.m_parent = indexA;
+            a.m_box = Union(b.m_box, f.m_box);
+            c.m_box = Union(a.m_box, g.m_box);
+            a.m_height = 1 + std::max(b.m_height, f.m_height);
+            c.m_height = 1 + std::max(a.m_height, g.m_height);
+        }
+
+        return indexC;
+    }
+
+    if (balance < -1)
+    {
+        // B becomes parent of A
+        const int indexD = b.m_left;
+        const int indexE = b.m_right;
+        Node& d = m_nodes[indexD];
+        Node& e = m_nodes[indexE];
+
+        b.m_left = indexA;
+        b.m_parent = a.m_parent;
+        a.m_parent = indexB;
+
+        if (b.m_parent != kNullNode)
+        {
+            Node& parent = m_nodes[b.m_parent];
+
+            if (parent.m_left == indexA)
+            {
+                parent.m_left = indexB;
+            }
+            else
+            {
+                parent.m_right = indexB;
+            }
+        }
+        else
+        {
+            m_root = indexB;
+        }
+
+        if (d.m_height > e.m_height)
+        {
+            b.m_right = indexD;
+            a.m_left = indexE;
+            e.m_parent = indexA;
+            a.m_box = Union(c.m_box, e.m_box);
+            b.m_box = Union(a.m_box, d.m_box);
+            a.m_height = 1 + std::max(c.m_height, e.m_height);
+            b.m_height = 1 + std::max(a.m_height, d.m_height);
+        }
+        else
+        {
+            b.m_right = indexE;
+            a.m_left = indexD;
+            d.m_parent = indexA;
+            a.m_box = Union(c.m_box, d.m_box);
+            b.m_box = Union(a.m_box, e.m_box);
+            a.m_height = 1 + std::max(c.m_height, d.m_height);
+            b.m_height = 1 + std::max(a.m_height, e.m_height);
+        }
+
+        return indexB;
+    }
+
+    return indexA;
+}
+
+BoundingBox3f DynamicAABBTree::Enlarge(const BoundingBox3f& box) const
+{
+    // Objects without geometry are never found by queries
+    if (!box.IsValid())
+    {
+        return box;
+    }
+
+    const Vector3f size = box.max - box.min;
+    const float margin = std::max(kMinFatMargin,
+        kFatMarginRatio * std::max(size.x(), std::max(size.y(), size.z())));
+
+    return box.Enlarged(margin);
+}
\ No newline at end of file
@@ -0,0 +1,211 @@
+#pragma once
+
+#include <vector>
+
+#include "Base/ParallelFor.h"
+#include "Base/Geom/BoundingBox.h"
+#include "Base/Geom/Frustum.h"
+#include "Base/Geom/Ray.h"
+
+/* Bounding volume hierarchy with one object per leaf which supports
+ * insertion, removal and movement of objects. Leaves store boxes
+ * enlarged by a margin, so small movements don't touch the tree.
+ * Tree is kept balanced by rotations on every structural change.
+ * Object is identified by proxy returned on insertion, and carries
+ * user data returned by queries. Queries are read only and can be
+ * run concurrently.
+ */
+class DynamicAABBTree
+{
+public:
+    DynamicAABBTree();
+
+    DynamicAABBTree(const DynamicAABBTree&) = delete;
+
+    /* Replaces content with boxes[i] carrying user data i.
+     * Top-down binned SAH build, large subtrees are built in parallel.
+     * Proxy of every box is written to proxies.
+     */
+    void Build(const std::vector<BoundingBox3f>& boxes, std::vector<int>* proxies);
+
+    int Insert(const BoundingBox3f& box, int userData);
+
+    void Remove(int proxy);
+
+    /* Updates object box. Returns false if the box still fits
+     * into enlarged one and the tree was not changed.
+     */
+    bool Move(int proxy, const BoundingBox3f& box);
+
+    void Clear();
+
+    int GetUserData(int proxy) const { return m_nodes[proxy].m_userData; }
+    void SetUserData(int proxy, int userData) { m_nodes[proxy].m_userData = userData; }
+
+    // Enlarged box stored in the tree
+    const BoundingBox3f& GetFatBox(int proxy) const { return m_nodes[proxy].m_box; }
+
+    const BoundingBox3f& GetBoundingBox() const;
+
+    int GetHeight() const;
+
+    int GetProxiesCount() const { return m_proxiesCount; }
+
+    // Appends user data of objects which enlarged boxes overlap the box
+    void Query(const BoundingBox3f& box, std::vector<int>* userData) const;
+
+    // Appends user data of objects which enlarged boxes intersect frustum
+    void Query(const Frustum& frustum, std::vector<int>* userData) const;
+
+    // Batch versions, queries are distributed between threads
+    void Query(const std::vector<BoundingBox3f>& boxes,
+        std::vector<std::vector<int>>* userData) const;
+
+    void Query(const std::vector<Frustum>& frustums,
+        std::vector<std::vector<int>>* userData) const;
+
+    /* Calls callback(userData, maxDistance) for objects which boxes are hit
+     * by the ray, nearest boxes first. Callback returns distance to clip the
+     * ray to (usually distance of found hit or unchanged maxDistance),
+     * negative value stops the query.
+     */
+    template<typename Callback>
+    void RayCast(const Ray& ray, float maxDistance, const Callback& callback) const;
+
+    // Same for many rays on all cores, callback(rayIndex, userData, maxDistance)
+    template<typename Callback>
+    void RayCast(const std::vector<Ray>& rays, float maxDistance, const Callback& callback) const;
+
+private:
+    struct Node
+    {
+        bool IsLeaf() const { return m_left < 0; }
+
+        BoundingBox3f m_box;
+        // Next free node for free list entries
+        int m_parent;
+        int m_left;
+        int m_right;
+        // Leaf has zero height, free node has negative one
+        int m_height;
+        int m_userData;
+    };
+
+    struct BuildItem;
+
+    int AllocateNode();
+    void FreeNode(int node);
+
+    void InsertLeaf(int leaf);
+    void RemoveLeaf(int leaf);
+
+    // Recomputes boxes and heights up to the root, rotating unbalanced nodes
+    void FixUpwards(int node);
+    int Balance(int node);
+
+    void BuildRange(std::vector<BuildItem>& items, int begin, int end,
+        int nodeIndex, int parent, int parallelDepth);
+
+    BoundingBox3f Enlarge(const BoundingBox3f& box) const;
+
+    std::vector<Node> m_nodes;
+    int m_root;
+    int m_freeList;
+    int m_proxiesCount;
+};
+
+template<typename Callback>
+void DynamicAABBTree::RayCast(const Ray& ray, float maxDistance, const Callback& callback) const
+{
+    if (m_root < 0)
+    {
+        return;
+    }
+
+    const Vector3f invDirection = XRay::GetInverseDirection(ray);
+
+    // Node and entry distance, the ray could be clipped after the node was pushed
+    std::vector<std::pair<int, float>> stack;
+    stack.reserve(64);
+
+    float entry = 0.0f;
+
+    if (XRay::IntersectBox(m_nodes[m_root].m_box, ray.m_origin, invDirection, maxDistance, &entry))
+    {
+        stack.emplace_back(m_root, entry);
+    }
+
+    while (!stack.empty())
+    {
+        const std::pair<int, float> item = stack.back();
+        stack.pop_back();
+
+        if (item.second > maxDistance)
+        {
+            continue;
+        }
+
+        const Node& node = m_nodes[item.first];
+
+        if (node.IsLeaf())
+        {
+            maxDistance = callback(node.m_userData, maxDistance);
+
+            if (maxDistance < 0.0f)
+            {
+                return;
+            }
+
+            continue;
+        }
+
+        float leftEntry = 0.0f;
+        float rightEntry = 0.0f;
+
+        const bool left = XRay::IntersectBox(m_nodes[node.m_left].m_box,
+            ray.m_origin, invDirection, maxDistance, &leftEntry);
+        const bool right = XRay::IntersectBox(m_nodes[node.m_right].m_box,
+            ray.m_origin, invDirection, maxDistance, &rightEntry);
+
+        // Far child goes first to the stack, so near one is visited first
+        if (left && right)
+        {
+            if (leftEntry < rightEntry)
+            {
+                stack.emplace_back(node.m_right, rightEntry);
+                stack.emplace_back(node.m_left, leftEntry);
+            }
+            else
+            {
+                stack.emplace_back(node.m_left, leftEntry);
+                stack.emplace_back(node.m_right, rightEntry);
+            }
+        }
+        else if (left)
+        {
+            stack.emplace_back(node.m_left, leftEntry);
+        }
+        else if (right)
+        {
+            stack.emplace_back(node.m_right, rightEntry);
+        }
+    }
+}
+
+template<typename Callback>
+void DynamicAABBTree::RayCast(const std::vector<Ray>& rays, float maxDistance,
+    const Callback& callback) const
+{
+    ParallelFor(rays.size(), 64, [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            const int rayIndex = static_cast<int>(i);
+
+            RayCast(rays[i], maxDistance, [&](int userData, float distance)
+            {
+                return callback(rayIndex, userData, distance);
+            });
+        }
+    });
+}
\ No newline at end of file
@@ -0,0 +1,70 @@
+#include <cassert>
+#include <cmath>
+
+#include "Base/Geom/Frustum.h"
+
+Frustum::Frustum(const glm::mat4& viewProjection)
+{
+    // glm matrices are column major, m[column][row]
+    const glm::mat4& m = viewProjection;
+
+    for (int plane = 0; plane < PlanesCount; ++plane)
+    {
+        const int row = plane / 2;
+        const float sign = (plane % 2) == 0 ? 1.0f : -1.0f;
+
+        Vector4f& p = m_planes[plane];
+
+        p = Vector4f(
+            m[0][3] + sign * m[0][row],
+            m[1][3] + sign * m[1][row],
+            m[2][3] + sign * m[2][row],
+            m[3][3] + sign * m[3][row]);
+
+        const float length = std::sqrt(p.x() * p.x() + p.y() * p.y() + p.z() * p.z());
+
+        if (length > 0.0f)
+        {
+            p /= length;
+        }
+    }
+}
+
+bool Frustum::Intersects(const BoundingBox3f& box) const
+{
+    int lastFailedPlane = 0;
+    return Intersects(box, &lastFailedPlane);
+}
+
+bool Frustum::Intersects(const BoundingBox3f& box, int* lastFailedPlane) const
+{
+    assert(lastFailedPlane != nullptr);
+
+    if (!box.IsValid())
+    {
+        return false;
+    }
+
+    const Vector3f center = (box.min + box.max) * 0.5f;
+    const Vector3f extent = (box.max - box.min) * 0.5f;
+
+    for (int i = 0; i < PlanesCount; ++i)
+    {
+        const int plane = (*lastFailedPlane + i) % PlanesCount;
+        const Vector4f& p = m_planes[plane];
+
+        const float distance = p.x() * center.x() + p.y() * center.y() + p.z() * center.z() + p.w();
+        const float radius =
+            std::abs(p.x()) * extent.x() +
+            std::abs(p.y()) * extent.y() +
+            std::abs(p.z()) * extent.z();
+
+        if (distance + radius < 0.0f)
+        {
+            *lastFailedPlane = plane;
+            return false;
+        }
+    }
+
+    return true;
+}
\ No newline at end of file
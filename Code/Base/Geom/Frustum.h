@@ -0,0 +1,41 @@
+#pragma once
+
+#include "Base/Geom/BoundingBox.h"
+#include "Base/Geom/Vector.h"
+
+// GLM
+#include <glm/glm.hpp>
+
+/* Six planes of view volume. Plane normals look inside,
+ * point p is inside the plane if dot(normal, p) + w >= 0.
+ */
+class Frustum
+{
+public:
+    enum Plane
+    {
+        Left,
+        Right,
+        Bottom,
+        Top,
+        Near,
+        Far,
+        PlanesCount
+    };
+
+    // Extracts normalized planes from projection * view matrix
+    explicit Frustum(const glm::mat4& viewProjection);
+
+    const Vector4f& GetPlane(int plane) const { return m_planes[plane]; }
+
+    // Conservative test, box is rejected only if it's outside some plane
+    bool Intersects(const BoundingBox3f& box) const;
+
+    /* Same test starting from the plane which rejected the box last time.
+     * lastFailedPlane is updated when the box is rejected.
+     */
+    bool Intersects(const BoundingBox3f& box, int* lastFailedPlane) const;
+
+private:
+    Vector4f m_planes[PlanesCount];
+};
\ No newline at end of file
@@ -3,6 +3,19 @@
 #include <memory>
 #include <vector>
 
+// Continuous part of index data
+struct IndexRange
+{
+    IndexRange() :
+        m_first(0), m_count(0) {}
+
+    explicit IndexRange(int first, int count) :
+        m_first(first), m_count(count) {}
+
+    int m_first;
+    int m_count;
+};
+
 class IndexBlob
 {
 public:
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <utility>
+
+#include "Base/Geom/BoundingBox.h"
+#include "Base/Geom/Vector.h"
+
+// Half line starting at origin, direction is expected to be normalized
+struct Ray
+{
+    Ray() {}
+
+    explicit Ray(const Vector3f& origin, const Vector3f& direction) :
+        m_origin(origin), m_direction(direction) {}
+
+    Vector3f GetPoint(float distance) const
+    {
+        return m_origin + m_direction * distance;
+    }
+
+    Vector3f m_origin;
+    Vector3f m_direction;
+};
+
+// Closest intersection of ray with triangle mesh
+struct RayHit
+{
+    RayHit() :
+        m_triangle(-1), m_distance(0.0f), m_u(0.0f), m_v(0.0f) {}
+
+    // Index of triangle in source index list (first index / 3)
+    int m_triangle;
+    float m_distance;
+
+    // Barycentric coordinates of the second and the third triangle vertices
+    float m_u;
+    float m_v;
+};
+
+namespace XRay {
+
+    inline Vector3f GetInverseDirection(const Ray& ray)
+    {
+        return Vector3f(
+            1.0f / ray.m_direction.x(),
+            1.0f / ray.m_direction.y(),
+            1.0f / ray.m_direction.z());
+    }
+
+    /* Slab test, invDirection is component-wise inverse of ray direction.
+     * Writes distance where the ray enters the box (zero if origin is inside).
+     */
+    inline bool IntersectBox(const BoundingBox3f& box, const Vector3f& origin,
+        const Vector3f& invDirection, float maxDistance, float* entryDistance = nullptr)
+    {
+        float tmin = 0.0f;
+        float tmax = maxDistance;
+
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            float t0 = (box.min[axis] - origin[axis]) * invDirection[axis];
+            float t1 = (box.max[axis] - origin[axis]) * invDirection[axis];
+
+            if (t0 > t1)
+            {
+                std::swap(t0, t1);
+            }
+
+            tmin = t0 > tmin ? t0 : tmin;
+            tmax = t1 < tmax ? t1 : tmax;
+
+            if (tmin > tmax)
+            {
+                return false;
+            }
+        }
+
+        if (entryDistance != nullptr)
+        {
+            *entryDistance = tmin;
+        }
+
+        return true;
+    }
+
+}
\ No newline at end of file
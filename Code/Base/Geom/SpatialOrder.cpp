@@ -0,0 +1,188 @@
+#include <algorithm>
+#include <utility>
+
+#include "Base/ParallelFor.h"
+#include "Base/Geom/SpatialOrder.h"
+
+namespace
+{
+    const int kBitsPerAxis = 10;
+    const uint32_t kAxisCells = 1u << kBitsPerAxis;
+    const size_t kMinPointsPerThread = 65536;
+
+    // Inserts two zero bits between every bit of 10 bit value
+    static uint32_t SpreadBits(uint32_t v)
+    {
+        v &= 0x000003ff;
+        v = (v | (v << 16)) & 0x030000ff;
+        v = (v | (v << 8)) & 0x0300f00f;
+        v = (v | (v << 4)) & 0x030c30c3;
+        v = (v | (v << 2)) & 0x09249249;
+        return v;
+    }
+
+    static uint32_t Interleave(uint32_t x, uint32_t y, uint32_t z)
+    {
+        return (SpreadBits(x) << 2) | (SpreadBits(y) << 1) | SpreadBits(z);
+    }
+
+    // Skilling's "axes to transpose" followed by bits interleaving
+    static uint32_t HilbertCode(uint32_t x, uint32_t y, uint32_t z)
+    {
+        uint32_t axes[3] = { x, y, z };
+        const uint32_t highBit = 1u << (kBitsPerAxis - 1);
+
+        // Inverse undo excess work
+        for (uint32_t q = highBit; q > 1; q >>= 1)
+        {
+            const uint32_t p = q - 1;
+
+            for (int i = 0; i < 3; ++i)
+            {
+                if ((axes[i] & q) != 0)
+                {
+                    axes[0] ^= p;
+                }
+                else
+                {
+                    const uint32_t t = (axes[0] ^ axes[i]) & p;
+                    axes[0] ^= t;
+                    axes[i] ^= t;
+                }
+            }
+        }
+
+        // Gray encode
+        axes[1] ^= axes[0];
+        axes[2] ^= axes[1];
+
+        uint32_t t = 0;
+
+        for (uint32_t q = highBit; q > 1; q >>= 1)
+        {
+            if ((axes[2] & q) != 0)
+            {
+                t ^= q - 1;
+            }
+        }
+
+        axes[0] ^= t;
+        axes[1] ^= t;
+        axes[2] ^= t;
+
+        return Interleave(axes[0], axes[1], axes[2]);
+    }
+
+    static uint32_t Quantize(float value, float min, float max)
+    {
+        const float range = max - min;
+
+        if (!(range > 0.0f))
+        {
+            return 0;
+        }
+
+        const float cell = (value - min) / range * static_cast<float>(kAxisCells);
+
+        return static_cast<uint32_t>(std::min(std::max(cell, 0.0f),
+            static_cast<float>(kAxisCells - 1)));
+    }
+
+    template<typename GetPoint>
+    static std::vector<int> SortByCurve(size_t count, const BoundingBox3f& bounds,
+        SpaceFillingCurve curve, const GetPoint& getPoint)
+    {
+        std::vector<std::pair<uint32_t, int>> codes(count);
+
+        ParallelFor(count, kMinPointsPerThread, [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                codes[i] = std::make_pair(
+                    XSpatialOrder::GetCurveCode(getPoint(i), bounds, curve),
+                    static_cast<int>(i));
+            }
+        });
+
+        // Index in the pair keeps sort result stable
+        std::sort(codes.begin(), codes.end());
+
+        std::vector<int> order(count);
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            order[i] = codes[i].second;
+        }
+
+        return order;
+    }
+}
+
+namespace XSpatialOrder {
+
+    uint32_t GetCurveCode(const Vector3f& point, const BoundingBox3f& bounds,
+        SpaceFillingCurve curve)
+    {
+        const uint32_t x = Quantize(point.x(), bounds.min.x(), bounds.max.x());
+        const uint32_t y = Quantize(point.y(), bounds.min.y(), bounds.max.y());
+        const uint32_t z = Quantize(point.z(), bounds.min.z(), bounds.max.z());
+
+        return curve == SpaceFillingCurve::Hilbert ?
+            HilbertCode(x, y, z) : Interleave(x, y, z);
+    }
+
+}
+
+std::vector<int> ComputeSpatialOrder(const ArrayView<const Vector3f>& points,
+    SpaceFillingCurve curve)
+{
+    BoundingBox3f bounds = BoundingBox3f::kInvalid;
+    bounds += points;
+
+    return SortByCurve(points.usize(), bounds, curve, [&points](size_t i) -> const Vector3f&
+    {
+        return points[static_cast<int>(i)];
+    });
+}
+
+std::vector<int> ComputeSpatialOrder(const std::vector<BoundingBox3f>& boxes,
+    SpaceFillingCurve curve)
+{
+    std::vector<Vector3f> centers(boxes.size());
+
+    for (size_t i = 0; i < boxes.size(); ++i)
+    {
+        centers[i] = (boxes[i].min + boxes[i].max) * 0.5f;
+    }
+
+    return ComputeSpatialOrder(ArrayView<const Vector3f>(
+        centers.data(), static_cast<int>(centers.size())), curve);
+}
+
+VertexBlobPtr ReorderVertices(const VertexBlob& vertices, std::vector<int>* indices,
+    SpaceFillingCurve curve)
+{
+    assert(indices != nullptr);
+
+    const std::vector<int> order = ComputeSpatialOrder(
+        vertices.GetFieldView<VertexBlobField::Pos>(), curve);
+
+    VertexBlobPtr result = std::make_shared<VertexBlob>(vertices.GetFields(), vertices.Size());
+    std::vector<int> remap(order.size());
+
+    ParallelFor(order.size(), kMinPointsPerThread, [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            result->CopyPoint(static_cast<int>(i), vertices, order[i]);
+            remap[order[i]] = static_cast<int>(i);
+        }
+    });
+
+    for (int& index : *indices)
+    {
+        index = remap[index];
+    }
+
+    return result;
+}
\ No newline at end of file
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Base/ArrayView.h"
+#include "Base/Geom/BoundingBox.h"
+#include "Base/Geom/VertexBlob.h"
+
+enum class SpaceFillingCurve
+{
+    // Bits interleaving, cheap to compute
+    Morton,
+
+    // No jumps between neighbour cells, better locality
+    Hilbert
+};
+
+namespace XSpatialOrder {
+
+    // Code of point on the curve, 10 bits per axis
+    uint32_t GetCurveCode(const Vector3f& point, const BoundingBox3f& bounds,
+        SpaceFillingCurve curve);
+
+}
+
+// Returns indices of points in the order they are visited by the curve
+std::vector<int> ComputeSpatialOrder(const ArrayView<const Vector3f>& points,
+    SpaceFillingCurve curve = SpaceFillingCurve::Hilbert);
+
+// Same for centers of bounding boxes
+std::vector<int> ComputeSpatialOrder(const std::vector<BoundingBox3f>& boxes,
+    SpaceFillingCurve curve = SpaceFillingCurve::Hilbert);
+
+/* Makes copy of vertices sorted along the curve,
+ * indices are remapped to new vertex positions
+ */
+VertexBlobPtr ReorderVertices(const VertexBlob& vertices, std::vector<int>* indices,
+    SpaceFillingCurve curve = SpaceFillingCurve::Hilbert);
+
+/* Sorts objects along the curve by their bounding boxes.
+ * getBoundingBox must return BoundingBox3f for an object.
+ */
+template<typename T, typename GetBoundingBox>
+void SortSpatially(std::vector<T>& objects, const GetBoundingBox& getBoundingBox,
+    SpaceFillingCurve curve = SpaceFillingCurve::Hilbert)
+{
+    std::vector<BoundingBox3f> boxes;
+    boxes.reserve(objects.size());
+
+    for (const T& object : objects)
+    {
+        boxes.push_back(getBoundingBox(object));
+    }
+
+    const std::vector<int> order = ComputeSpatialOrder(boxes, curve);
+
+    std::vector<T> sorted;
+    sorted.reserve(objects.size());
+
+    for (int index : order)
+    {
+        sorted.push_back(std::move(objects[index]));
+    }
+
+    objects.swap(sorted);
+}
\ No newline at end of file
@@ -0,0 +1,370 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+#include "Base/ParallelFor.h"
+#include "Base/Geom/TangentSpace.h"
+
+namespace
+{
+    const size_t kMinTrianglesPerThread = 16384;
+    const size_t kMinVerticesPerThread = 16384;
+
+    // Source vertex split into output vertices by triangle corner keys
+    struct VertexSplit
+    {
+        // Output vertex for each triangle corner
+        std::vector<int> cornerVertex;
+        // Source vertex for each output vertex
+        std::vector<int> sourceVertex;
+        // Corners of output vertex i are corners[offsets[i], offsets[i + 1])
+        std::vector<int> offsets;
+        std::vector<int> corners;
+    };
+
+    /* Corners which reference the same source vertex and have equal keys
+     * are merged into one output vertex.
+     */
+    static void SplitVertices(int verticesCount, const std::vector<int>& indices,
+        const std::vector<int64_t>& cornerKeys, VertexSplit* split)
+    {
+        assert(split != nullptr && cornerKeys.size() == indices.size());
+
+        const size_t sourceCount = static_cast<size_t>(verticesCount);
+        const int cornersCount = static_cast<int>(indices.size());
+
+        // Group corners by source vertex
+        std::vector<int> sourceOffsets(sourceCount + 1, 0);
+
+        for (int corner = 0; corner < cornersCount; ++corner)
+        {
+            ++sourceOffsets[indices[corner] + 1];
+        }
+
+        for (size_t i = 0; i < sourceCount; ++i)
+        {
+            sourceOffsets[i + 1] += sourceOffsets[i];
+        }
+
+        split->corners.resize(indices.size());
+
+        {
+            std::vector<int> fill(sourceOffsets.begin(), sourceOffsets.end() - 1);
+
+            for (int corner = 0; corner < cornersCount; ++corner)
+            {
+                split->corners[fill[indices[corner]]++] = corner;
+            }
+        }
+
+        // Order corners of every vertex by key and count distinct keys
+        std::vector<int> outputOffsets(sourceCount + 1, 0);
+
+        ParallelFor(sourceCount, kMinVerticesPerThread, [&](size_t begin, size_t end)
+        {
+            for (size_t vertex = begin; vertex < end; ++vertex)
+            {
+                int* const first = split->corners.data() + sourceOffsets[vertex];
+                int* const last = split->corners.data() + sourceOffsets[vertex + 1];
+
+                std::sort(first, last, [&cornerKeys](int a, int b)
+                {
+                    return cornerKeys[a] != cornerKeys[b] ?
+                        cornerKeys[a] < cornerKeys[b] : a < b;
+                });
+
+                int clusters = 0;
+
+                for (const int* corner = first; corner != last; ++corner)
+                {
+                    if (corner == first || cornerKeys[*corner] != cornerKeys[*(corner - 1)])
+                    {
+                        ++clusters;
+                    }
+                }
+
+                outputOffsets[vertex + 1] = clusters;
+            }
+        });
+
+        for (size_t i = 0; i < sourceCount; ++i)
+        {
+            outputOffsets[i + 1] += outputOffsets[i];
+        }
+
+        const size_t outputCount = static_cast<size_t>(outputOffsets[sourceCount]);
+
+        split->cornerVertex.resize(indices.size());
+        split->sourceVertex.resize(outputCount);
+        split->offsets.resize(outputCount + 1);
+        split->offsets[outputCount] = cornersCount;
+
+        ParallelFor(sourceCount, kMinVerticesPerThread, [&](size_t begin, size_t end)
+        {
+            for (size_t vertex = begin; vertex < end; ++vertex)
+            {
+                int output = outputOffsets[vertex] - 1;
+
+                for (int i = sourceOffsets[vertex]; i < sourceOffsets[vertex + 1]; ++i)
+                {
+                    const int corner = split->corners[i];
+
+                    if (i == sourceOffsets[vertex] ||
+                        cornerKeys[corner] != cornerKeys[split->corners[i - 1]])
+                    {
+                        ++output;
+                        split->sourceVertex[output] = static_cast<int>(vertex);
+                        split->offsets[output] = i;
+                    }
+
+                    split->cornerVertex[corner] = output;
+                }
+            }
+        });
+    }
+
+    static float GetCornerAngle(const ArrayView<const Vector3f>& positions,
+        const std::vector<int>& indices, int corner)
+    {
+        const int triangle = corner - corner % 3;
+        const Vector3f& a = positions[indices[corner]];
+        const Vector3f& b = positions[indices[triangle + (corner + 1) % 3]];
+        const Vector3f& c = positions[indices[triangle + (corner + 2) % 3]];
+
+        const Vector3f ab = b - a;
+        const Vector3f ac = c - a;
+        const float lengths = ab.norm() * ac.norm();
+
+        if (lengths <= std::numeric_limits<float>::min())
+        {
+            return 0.0f;
+        }
+
+        return std::acos(std::max(-1.0f, std::min(1.0f, ab.dot(ac) / lengths)));
+    }
+
+    static Vector3f GetAnyOrthogonal(const Vector3f& v)
+    {
+        const Vector3f axis = std::abs(v.x()) < 0.9f ?
+            Vector3f(1.0f, 0.0f, 0.0f) : Vector3f(0.0f, 1.0f, 0.0f);
+
+        return v.cross(axis).normalized();
+    }
+
+    static VertexBlobPtr MakeSplitBlob(const VertexBlob& vertices,
+        VertexBlobField fields, const VertexSplit& split,
+        std::vector<int>* outIndices)
+    {
+        VertexBlobPtr result = std::make_shared<VertexBlob>(fields,
+            static_cast<int>(split.sourceVertex.size()));
+
+        ParallelFor(split.sourceVertex.size(), kMinVerticesPerThread, [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                result->CopyPoint(static_cast<int>(i), vertices, split.sourceVertex[i]);
+            }
+        });
+
+        *outIndices = split.cornerVertex;
+
+        return result;
+    }
+}
+
+namespace TangentSpace {
+
+    VertexBlobPtr GenerateNormals(const VertexBlob& vertices,
+        const std::vector<int>& indices,
+        const std::vector<uint32_t>& smoothingGroups,
+        std::vector<int>* outIndices)
+    {
+        assert(outIndices != nullptr && indices.size() % 3 == 0);
+        assert(smoothingGroups.empty() || smoothingGroups.size() * 3 == indices.size());
+
+        const ArrayView<const Vector3f> positions =
+            vertices.GetFieldView<VertexBlobField::Pos>();
+        const size_t trianglesCount = indices.size() / 3;
+
+        std::vector<Vector3f> faceNormals(trianglesCount);
+        std::vector<int64_t> cornerKeys(indices.size());
+
+        ParallelFor(trianglesCount, kMinTrianglesPerThread, [&](size_t begin, size_t end)
+        {
+            for (size_t triangle = begin; triangle < end; ++triangle)
+            {
+                const Vector3f& a = positions[indices[triangle * 3]];
+                const Vector3f& b = positions[indices[triangle * 3 + 1]];
+                const Vector3f& c = positions[indices[triangle * 3 + 2]];
+
+                const Vector3f normal = (b - a).cross(c - a);
+                const float length = normal.norm();
+
+                faceNormals[triangle] = length > std::numeric_limits<float>::min() ?
+                    Vector3f(normal / length) : Vector3f(0.0f, 0.0f, 0.0f);
+
+                const uint32_t group = smoothingGroups.empty() ? 1 : smoothingGroups[triangle];
+
+                // Flat triangles get unique keys to never share vertices
+                const int64_t key = group != 0 ?
+                    static_cast<int64_t>(group) : -static_cast<int64_t>(triangle + 1);
+
+                cornerKeys[triangle * 3] = key;
+                cornerKeys[triangle * 3 + 1] = key;
+                cornerKeys[triangle * 3 + 2] = key;
+            }
+        });
+
+        VertexSplit split;
+        SplitVertices(vertices.Size(), indices, cornerKeys, &split);
+
+        VertexBlobPtr result = MakeSplitBlob(vertices,
+            vertices.GetFields() | VertexBlobField::Norm, split, outIndices);
+
+        ArrayView<Vector3f> normals = result->GetFieldView<VertexBlobField::Norm>();
+
+        ParallelFor(split.sourceVertex.size(), kMinVerticesPerThread, [&](size_t begin, size_t end)
+        {
+            for (size_t vertex = begin; vertex < end; ++vertex)
+            {
+                Vector3f normal(0.0f, 0.0f, 0.0f);
+
+                for (int i = split.offsets[vertex]; i < split.offsets[vertex + 1]; ++i)
+                {
+                    const int corner = split.corners[i];
+                    normal += faceNormals[corner / 3] * GetCornerAngle(positions, indices, corner);
+                }
+
+                const float length = normal.norm();
+
+                normals[static_cast<int>(vertex)] = length > std::numeric_limits<float>::min() ?
+                    Vector3f(normal / length) : Vector3f(0.0f, 0.0f, 1.0f);
+            }
+        });
+
+        return result;
+    }
+
+    VertexBlobPtr GenerateTangents(const VertexBlob& vertices,
+        const std::vector<int>& indices,
+        std::vector<int>* outIndices)
+    {
+        assert(outIndices != nullptr && indices.size() % 3 == 0);
+
+        const VertexBlobField required =
+            VertexBlobField::Pos | VertexBlobField::Norm | VertexBlobField::TexCoords;
+
+        if ((vertices.GetFields() & required) != required)
+        {
+            return nullptr;
+        }
+
+        const ArrayView<const Vector3f> positions =
+            vertices.GetFieldView<VertexBlobField::Pos>();
+        const ArrayView<const Vector3f> sourceNormals =
+            vertices.GetFieldView<VertexBlobField::Norm>();
+        const ArrayView<const Vector2f> texCoords =
+            vertices.GetFieldView<VertexBlobField::TexCoords>();
+        const size_t trianglesCount = indices.size() / 3;
+
+        // Derivatives of position along texture s and t axes
+        std::vector<Vector3f> faceTangents(trianglesCount);
+        std::vector<Vector3f> faceBitangents(trianglesCount);
+        std::vector<int64_t> cornerKeys(indices.size());
+
+        ParallelFor(trianglesCount, kMinTrianglesPerThread, [&](size_t begin, size_t end)
+        {
+            for (size_t triangle = begin; triangle < end; ++triangle)
+            {
+                const int i0 = indices[triangle * 3];
+                const int i1 = indices[triangle * 3 + 1];
+                const int i2 = indices[triangle * 3 + 2];
+
+                const Vector3f e1 = positions[i1] - positions[i0];
+                const Vector3f e2 = positions[i2] - positions[i0];
+                const Vector2f d1 = texCoords[i1] - texCoords[i0];
+                const Vector2f d2 = texCoords[i2] - texCoords[i0];
+
+                // Doubled signed area in texture space
+                const float area = d1.x() * d2.y() - d2.x() * d1.y();
+
+                if (std::abs(area) > std::numeric_limits<float>::min())
+                {
+                    faceTangents[triangle] = (e1 * d2.y() - e2 * d1.y()) / area;
+                    faceBitangents[triangle] = (e2 * d1.x() - e1 * d2.x()) / area;
+                }
+                else
+                {
+                    faceTangents[triangle] = Vector3f(0.0f, 0.0f, 0.0f);
+                    faceBitangents[triangle] = Vector3f(0.0f, 0.0f, 0.0f);
+                }
+
+                // Mirrored mapping must not be merged with regular one
+                const int64_t key = area < 0.0f ? 1 : 0;
+
+                cornerKeys[triangle * 3] = key;
+                cornerKeys[triangle * 3 + 1] = key;
+                cornerKeys[triangle * 3 + 2] = key;
+            }
+        });
+
+        VertexSplit split;
+        SplitVertices(vertices.Size(), indices, cornerKeys, &split);
+
+        VertexBlobPtr result = MakeSplitBlob(vertices,
+            vertices.GetFields() | VertexBlobField::Tangent, split, outIndices);
+
+        ArrayView<Vector4f> tangents = result->GetFieldView<VertexBlobField::Tangent>();
+
+        ParallelFor(split.sourceVertex.size(), kMinVerticesPerThread, [&](size_t begin, size_t end)
+        {
+            for (size_t vertex = begin; vertex < end; ++vertex)
+            {
+                const Vector3f& normal = sourceNormals[split.sourceVertex[vertex]];
+
+                Vector3f tangent(0.0f, 0.0f, 0.0f);
+                Vector3f bitangent(0.0f, 0.0f, 0.0f);
+
+                for (int i = split.offsets[vertex]; i < split.offsets[vertex + 1]; ++i)
+                {
+                    const int corner = split.corners[i];
+                    const float angle = GetCornerAngle(positions, indices, corner);
+
+                    // Project onto tangent plane before accumulation
+                    Vector3f t = faceTangents[corner / 3];
+                    t -= normal * normal.dot(t);
+
+                    Vector3f b = faceBitangents[corner / 3];
+                    b -= normal * normal.dot(b);
+
+                    const float tLength = t.norm();
+                    const float bLength = b.norm();
+
+                    if (tLength > std::numeric_limits<float>::min())
+                    {
+                        tangent += t * (angle / tLength);
+                    }
+
+                    if (bLength > std::numeric_limits<float>::min())
+                    {
+                        bitangent += b * (angle / bLength);
+                    }
+                }
+
+                const float length = tangent.norm();
+
+                tangent = length > std::numeric_limits<float>::min() ?
+                    Vector3f(tangent / length) : GetAnyOrthogonal(normal);
+
+                const float sign = normal.cross(tangent).dot(bitangent) < 0.0f ? -1.0f : 1.0f;
+
+                tangents[static_cast<int>(vertex)] =
+                    Vector4f(tangent.x(), tangent.y(), tangent.z(), sign);
+            }
+        });
+
+        return result;
+    }
+
+}
\ No newline at end of file
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Base/Geom/VertexBlob.h"
+
+namespace TangentSpace {
+
+    /* Makes copy of vertices with VertexBlobField::Norm computed for
+     * triangles list. Face normals are accumulated with weights equal to
+     * the angle of triangle corner. Triangles from different smoothing
+     * groups do not share normals, so vertices are split at hard edges.
+     * Smoothing group 0 means flat shading, empty smoothingGroups means
+     * the whole mesh is smooth. New triangles are written to outIndices.
+     */
+    VertexBlobPtr GenerateNormals(const VertexBlob& vertices,
+        const std::vector<int>& indices,
+        const std::vector<uint32_t>& smoothingGroups,
+        std::vector<int>* outIndices);
+
+    /* Makes copy of vertices with VertexBlobField::Tangent. Uses
+     * MikkTSpace-like convention (not bit-exact): per triangle tangents
+     * are summed per vertex and orthogonalized to vertex normal, w holds
+     * bitangent sign (bitangent = w * cross(normal, tangent)). Normal maps
+     * baked by MikkTSpace tools may not match exactly.
+     * Vertices shared by triangles with mirrored texture mapping are split.
+     * Returns nullptr if there are no normals or texture coordinates.
+     */
+    VertexBlobPtr GenerateTangents(const VertexBlob& vertices,
+        const std::vector<int>& indices,
+        std::vector<int>* outIndices);
+
+}
\ No newline at end of file
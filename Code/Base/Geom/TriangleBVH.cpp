@@ -0,0 +1,486 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <xmmintrin.h>
+
+#include "Base/Geom/TriangleBVH.h"
+
+namespace
+{
+    const int kBinsCount = 12;
+    const int kMaxLeafSize = 4;
+    const int kForcedLeafSize = 16;
+    // Deeper nodes are split by median to bound traversal stack size
+    const int kMaxSahDepth = 40;
+    const int kTraversalStackSize = 96;
+    // Node traversal cost relative to triangle test
+    const float kTraversalCost = 1.0f;
+    const size_t kPacketSize = 4;
+
+    /* Moller-Trumbore for four triangles, culls nothing.
+     * Returns lane of the closest hit closer than maxDistance or -1,
+     * any hit lane if anyHit is set.
+     */
+    static int IntersectPacket(const float* const* packet, const __m128* origin,
+        const __m128* direction, float maxDistance, bool anyHit,
+        float* distance, float* u, float* v)
+    {
+        const float* const vertex = packet[0];
+        const float* const edge1 = packet[1];
+        const float* const edge2 = packet[2];
+
+        const __m128 e1x = _mm_loadu_ps(edge1);
+        const __m128 e1y = _mm_loadu_ps(edge1 + 4);
+        const __m128 e1z = _mm_loadu_ps(edge1 + 8);
+        const __m128 e2x = _mm_loadu_ps(edge2);
+        const __m128 e2y = _mm_loadu_ps(edge2 + 4);
+        const __m128 e2z = _mm_loadu_ps(edge2 + 8);
+
+        // p = direction x edge2
+        const __m128 px = _mm_sub_ps(_mm_mul_ps(direction[1], e2z), _mm_mul_ps(direction[2], e2y));
+        const __m128 py = _mm_sub_ps(_mm_mul_ps(direction[2], e2x), _mm_mul_ps(direction[0], e2z));
+        const __m128 pz = _mm_sub_ps(_mm_mul_ps(direction[0], e2y), _mm_mul_ps(direction[1], e2x));
+
+        const __m128 det = _mm_add_ps(_mm_add_ps(
+            _mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+
+        const __m128 absDet = _mm_andnot_ps(_mm_set1_ps(-0.0f), det);
+        __m128 mask = _mm_cmpgt_ps(absDet, _mm_set1_ps(1.0e-12f));
+
+        if (_mm_movemask_ps(mask) == 0)
+        {
+            return -1;
+        }
+
+        const __m128 invDet = _mm_div_ps(_mm_set1_ps(1.0f), det);
+
+        // s = origin - vertex
+        const __m128 sx = _mm_sub_ps(origin[0], _mm_loadu_ps(vertex));
+        const __m128 sy = _mm_sub_ps(origin[1], _mm_loadu_ps(vertex + 4));
+        const __m128 sz = _mm_sub_ps(origin[2], _mm_loadu_ps(vertex + 8));
+
+        const __m128 lanesU = _mm_mul_ps(_mm_add_ps(_mm_add_ps(
+            _mm_mul_ps(sx, px), _mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)), invDet);
+
+        // q = s x edge1
+        const __m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+        const __m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+        const __m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+
+        const __m128 lanesV = _mm_mul_ps(_mm_add_ps(_mm_add_ps(
+            _mm_mul_ps(direction[0], qx), _mm_mul_ps(direction[1], qy)), _mm_mul_ps(direction[2], qz)), invDet);
+
+        const __m128 lanesT = _mm_mul_ps(_mm_add_ps(_mm_add_ps(
+            _mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), invDet);
+
+        const __m128 zero = _mm_setzero_ps();
+
+        mask = _mm_and_ps(mask, _mm_cmpge_ps(lanesU, zero));
+        mask = _mm_and_ps(mask, _mm_cmpge_ps(lanesV, zero));
+        mask = _mm_and_ps(mask, _mm_cmple_ps(_mm_add_ps(lanesU, lanesV), _mm_set1_ps(1.0f)));
+        mask = _mm_and_ps(mask, _mm_cmpgt_ps(lanesT, zero));
+        mask = _mm_and_ps(mask, _mm_cmple_ps(lanesT, _mm_set1_ps(maxDistance)));
+
+        const int hits = _mm_movemask_ps(mask);
+
+        if (hits == 0)
+        {
+            return -1;
+        }
+
+        float t[4];
+        _mm_storeu_ps(t, lanesT);
+
+        int lane = -1;
+
+        for (int i = 0; i < 4; ++i)
+        {
+            if ((hits & (1 << i)) != 0 && (lane < 0 || t[i] < t[lane]))
+            {
+                lane = i;
+
+                if (anyHit)
+                {
+                    break;
+                }
+            }
+        }
+
+        if (!anyHit)
+        {
+            float lanesUValues[4];
+            float lanesVValues[4];
+            _mm_storeu_ps(lanesUValues, lanesU);
+            _mm_storeu_ps(lanesVValues, lanesV);
+
+            *distance = t[lane];
+            *u = lanesUValues[lane];
+            *v = lanesVValues[lane];
+        }
+
+        return lane;
+    }
+}
+
+struct TriangleBVH::BuildItem
+{
+    BoundingBox3f m_bounds;
+    Vector3f m_centroid;
+    int m_triangle;
+};
+
+TriangleBVH::TriangleBVH(const ArrayView<const Vector3f>& positions,
+    const std::vector<int>& indices) :
+    m_trianglesCount(0)
+{
+    assert(indices.size() % 3 == 0);
+
+    const int trianglesCount = static_cast<int>(indices.size() / 3);
+
+    std::vector<Vector3f> sourceVertices(indices.size());
+    std::vector<BuildItem> items;
+    items.reserve(static_cast<size_t>(trianglesCount));
+
+    for (int triangle = 0; triangle < trianglesCount; ++triangle)
+    {
+        BuildItem item;
+        item.m_bounds = BoundingBox3f::kInvalid;
+        item.m_triangle = triangle;
+
+        for (int corner = 0; corner < 3; ++corner)
+        {
+            const size_t index = static_cast<size_t>(triangle * 3 + corner);
+            sourceVertices[index] = positions[indices[index]];
+            item.m_bounds += sourceVertices[index];
+        }
+
+        const size_t first = static_cast<size_t>(triangle * 3);
+        const Vector3f normal = (sourceVertices[first + 1] - sourceVertices[first]).cross(
+            sourceVertices[first + 2] - sourceVertices[first]);
+
+        // Degenerate triangles can't be hit
+        if (normal.squaredNorm() > 0.0f)
+        {
+            item.m_centroid = item.m_bounds.GetCenter();
+            items.push_back(item);
+        }
+    }
+
+    if (items.empty())
+    {
+        return;
+    }
+
+    m_trianglesCount = static_cast<int>(items.size());
+    m_nodes.reserve(items.size() * 2 / kMaxLeafSize + 1);
+    m_packets.reserve(items.size() / kPacketSize + 1);
+
+    BuildNode(items, 0, static_cast<int>(items.size()), 0, sourceVertices);
+}
+
+const BoundingBox3f& TriangleBVH::GetBoundingBox() const
+{
+    return m_nodes.empty() ? BoundingBox3f::kInvalid : m_nodes.front().m_bounds;
+}
+
+bool TriangleBVH::Intersect(const Ray& ray, float maxDistance, RayHit* hit) const
+{
+    assert(hit != nullptr);
+    return Traverse(ray, maxDistance, false, hit);
+}
+
+bool TriangleBVH::IsOccluded(const Ray& ray, float maxDistance) const
+{
+    return Traverse(ray, maxDistance, true, nullptr);
+}
+
+int TriangleBVH::BuildNode(std::vector<BuildItem>& items, int begin, int end, int depth,
+    const std::vector<Vector3f>& sourceVertices)
+{
+    const int nodeIndex = static_cast<int>(m_nodes.size());
+    m_nodes.emplace_back();
+
+    BoundingBox3f bounds = BoundingBox3f::kInvalid;
+    BoundingBox3f centroidBounds = BoundingBox3f::kInvalid;
+
+    for (int i = begin; i < end; ++i)
+    {
+        bounds += items[i].m_bounds;
+        centroidBounds += items[i].m_centroid;
+    }
+
+    const int count = end - begin;
+    const Vector3f centroidExtent = centroidBounds.max - centroidBounds.min;
+
+    int axis = 0;
+
+    for (int i = 1; i < 3; ++i)
+    {
+        if (centroidExtent[i] > centroidExtent[axis])
+        {
+            axis = i;
+        }
+    }
+
+    int middle = begin;
+    bool medianSplit = false;
+
+    // All centroids in one point can't be split
+    if (count > kMaxLeafSize && centroidExtent[axis] > 0.0f)
+    {
+        if (depth < kMaxSahDepth)
+        {
+            int bestAxis = -1;
+            int bestBin = 0;
+            float bestCost = static_cast<float>(count);
+
+            for (int binAxis = 0; binAxis < 3; ++binAxis)
+            {
+                if (!(centroidExtent[binAxis] > 0.0f))
+                {
+                    continue;
+                }
+
+                BoundingBox3f binBounds[kBinsCount];
+                int binCounts[kBinsCount] = {};
+
+                std::fill(binBounds, binBounds + kBinsCount, BoundingBox3f::kInvalid);
+
+                const float scale = kBinsCount / centroidExtent[binAxis];
+
+                for (int i = begin; i < end; ++i)
+                {
+                    const int bin = std::min(kBinsCount - 1, static_cast<int>(
+                        (items[i].m_centroid[binAxis] - centroidBounds.min[binAxis]) * scale));
+
+                    binBounds[bin] += items[i].m_bounds;
+                    ++binCounts[bin];
+                }
+
+                // Sweep from the right to know cost of every right part
+                float rightAreas[kBinsCount];
+                int rightCounts[kBinsCount];
+                BoundingBox3f accumulated = BoundingBox3f::kInvalid;
+                int accumulatedCount = 0;
+
+                for (int bin = kBinsCount - 1; bin > 0; --bin)
+                {
+                    if (binCounts[bin] > 0)
+                    {
+                        accumulated += binBounds[bin];
+                    }
+
+                    accumulatedCount += binCounts[bin];
+                    rightAreas[bin] = accumulatedCount > 0 ? accumulated.GetHalfArea() : 0.0f;
+                    rightCounts[bin] = accumulatedCount;
+                }
+
+                accumulated = BoundingBox3f::kInvalid;
+                accumulatedCount = 0;
+
+                for (int bin = 0; bin + 1 < kBinsCount; ++bin)
+                {
+                    if (binCounts[bin] > 0)
+                    {
+                        accumulated += binBounds[bin];
+                    }
+
+                    accumulatedCount += binCounts[bin];
+
+                    if (accumulatedCount == 0 || rightCounts[bin + 1] == 0)
+                    {
+                        continue;
+                    }
+
+                    const float cost = kTraversalCost +
+                        (accumulated.GetHalfArea() * accumulatedCount +
+                         rightAreas[bin + 1] * rightCounts[bin + 1]) / bounds.GetHalfArea();
+
+                    if (cost < bestCost)
+                    {
+                        bestCost = cost;
+                        bestAxis = binAxis;
+                        bestBin = bin;
+                    }
+                }
+            }
+
+            if (bestAxis >= 0)
+            {
+                const float scale = kBinsCount / centroidExtent[bestAxis];
+                const float minValue = centroidBounds.min[bestAxis];
+
+                axis = bestAxis;
+                middle = static_cast<int>(std::partition(items.begin() + begin, items.begin() + end,
+                    [=](const BuildItem& item)
+                {
+                    return std::min(kBinsCount - 1, static_cast<int>(
+                        (item.m_centroid[bestAxis] - minValue) * scale)) <= bestBin;
+                }) - items.begin());
+            }
+            else
+            {
+                // SAH prefers leaf, but too big leaves are still split
+                medianSplit = count > kForcedLeafSize;
+            }
+        }
+        else
+        {
+            medianSplit = true;
+        }
+
+        if (medianSplit)
+        {
+            middle = begin + count / 2;
+
+            std::nth_element(items.begin() + begin, items.begin() + middle, items.begin() + end,
+                [axis](const BuildItem& a, const BuildItem& b)
+            {
+                return a.m_centroid[axis] < b.m_centroid[axis];
+            });
+        }
+    }
+
+    if (middle == begin || middle == end)
+    {
+        Node& leaf = m_nodes[nodeIndex];
+        leaf.m_bounds = bounds;
+        leaf.m_offset = static_cast<int>(m_packets.size());
+        leaf.m_count = static_cast<int>((static_cast<size_t>(count) + kPacketSize - 1) / kPacketSize);
+        leaf.m_axis = 0;
+
+        for (int first = begin; first < end; first += static_cast<int>(kPacketSize))
+        {
+            TrianglePacket packet = {};
+
+            for (int lane = 0; lane < static_cast<int>(kPacketSize); ++lane)
+            {
+                if (first + lane >= end)
+                {
+                    packet.m_triangles[lane] = -1;
+                    continue;
+                }
+
+                const int triangle = items[first + lane].m_triangle;
+                const Vector3f* vertices = &sourceVertices[static_cast<size_t>(triangle) * 3];
+                const Vector3f edge1 = vertices[1] - vertices[0];
+                const Vector3f edge2 = vertices[2] - vertices[0];
+
+                for (int axis = 0; axis < 3; ++axis)
+                {
+                    packet.m_vertex[axis][lane] = vertices[0][axis];
+                    packet.m_edge1[axis][lane] = edge1[axis];
+                    packet.m_edge2[axis][lane] = edge2[axis];
+                }
+
+                packet.m_triangles[lane] = triangle;
+            }
+
+            m_packets.push_back(packet);
+        }
+
+        return nodeIndex;
+    }
+
+    BuildNode(items, begin, middle, depth + 1, sourceVertices);
+    const int right = BuildNode(items, middle, end, depth + 1, sourceVertices);
+
+    // Vector could be reallocated by children
+    Node& node = m_nodes[nodeIndex];
+    node.m_bounds = bounds;
+    node.m_offset = right;
+    node.m_count = 0;
+    node.m_axis = axis;
+
+    return nodeIndex;
+}
+
+bool TriangleBVH::Traverse(const Ray& ray, float maxDistance, bool anyHit, RayHit* hit) const
+{
+    if (m_nodes.empty())
+    {
+        return false;
+    }
+
+    const Vector3f invDirection = XRay::GetInverseDirection(ray);
+
+    const __m128 origin[3] =
+    {
+        _mm_set1_ps(ray.m_origin.x()),
+        _mm_set1_ps(ray.m_origin.y()),
+        _mm_set1_ps(ray.m_origin.z())
+    };
+
+    const __m128 direction[3] =
+    {
+        _mm_set1_ps(ray.m_direction.x()),
+        _mm_set1_ps(ray.m_direction.y()),
+        _mm_set1_ps(ray.m_direction.z())
+    };
+
+    int stack[kTraversalStackSize];
+    int stackSize = 0;
+    int nodeIndex = 0;
+
+    float closest = maxDistance;
+    bool found = false;
+
+    for (;;)
+    {
+        const Node& node = m_nodes[nodeIndex];
+
+        if (XRay::IntersectBox(node.m_bounds, ray.m_origin, invDirection, closest))
+        {
+            if (node.m_count == 0)
+            {
+                // Visit near child first, so far one is often culled by closest distance
+                const bool backwards = ray.m_direction[node.m_axis] < 0.0f;
+
+                assert(stackSize < kTraversalStackSize);
+                stack[stackSize++] = backwards ? nodeIndex + 1 : node.m_offset;
+                nodeIndex = backwards ? node.m_offset : nodeIndex + 1;
+                continue;
+            }
+
+            for (int i = node.m_offset; i < node.m_offset + node.m_count; ++i)
+            {
+                const TrianglePacket& packet = m_packets[i];
+                const float* const arrays[3] = { &packet.m_vertex[0][0], &packet.m_edge1[0][0], &packet.m_edge2[0][0] };
+
+                float distance;
+                float u;
+                float v;
+
+                const int lane = IntersectPacket(arrays, origin, direction,
+                    closest, anyHit, &distance, &u, &v);
+
+                if (lane < 0)
+                {
+                    continue;
+                }
+
+                if (anyHit)
+                {
+                    return true;
+                }
+
+                closest = distance;
+                found = true;
+
+                hit->m_triangle = packet.m_triangles[lane];
+                hit->m_distance = distance;
+                hit->m_u = u;
+                hit->m_v = v;
+            }
+        }
+
+        if (stackSize == 0)
+        {
+            break;
+        }
+
+        nodeIndex = stack[--stackSize];
+    }
+
+    return found;
+}
\ No newline at end of file
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "Base/ArrayView.h"
+#include "Base/Geom/BoundingBox.h"
+#include "Base/Geom/Ray.h"
+
+/* Bounding volume hierarchy over triangles, built with binned SAH.
+ * Triangles are copied, so the source mesh can be released after build.
+ * Leaf triangles are stored in packets of four which are tested
+ * against the ray at once with SSE.
+ * Queries are read only and can run concurrently.
+ * Ray direction doesn't have to be normalized, distances are
+ * measured in direction lengths then.
+ */
+class TriangleBVH
+{
+public:
+    explicit TriangleBVH(const ArrayView<const Vector3f>& positions,
+        const std::vector<int>& indices);
+
+    TriangleBVH(const TriangleBVH&) = delete;
+
+    const BoundingBox3f& GetBoundingBox() const;
+
+    int GetTrianglesCount() const { return m_trianglesCount; }
+
+    // Finds closest hit not farther than maxDistance
+    bool Intersect(const Ray& ray, float maxDistance, RayHit* hit) const;
+
+    // Returns true on any hit not farther than maxDistance
+    bool IsOccluded(const Ray& ray, float maxDistance) const;
+
+private:
+    struct Node
+    {
+        BoundingBox3f m_bounds;
+        // First packet for leaf, right child for inner node (left one follows parent)
+        int m_offset;
+        // Zero for inner nodes
+        int m_count;
+        int m_axis;
+    };
+
+    // Four triangles in structure of arrays form, unused lanes have zero edges
+    struct TrianglePacket
+    {
+        float m_vertex[3][4];
+        float m_edge1[3][4];
+        float m_edge2[3][4];
+        // Source triangle index per lane, negative for unused lanes
+        int m_triangles[4];
+    };
+
+    struct BuildItem;
+
+    int BuildNode(std::vector<BuildItem>& items, int begin, int end, int depth,
+        const std::vector<Vector3f>& sourceVertices);
+
+    bool Traverse(const Ray& ray, float maxDistance, bool anyHit, RayHit* hit) const;
+
+    std::vector<Node> m_nodes;
+    std::vector<TrianglePacket> m_packets;
+    int m_trianglesCount;
+};
+
+using TriangleBVHPtr = std::shared_ptr<TriangleBVH>;
\ No newline at end of file
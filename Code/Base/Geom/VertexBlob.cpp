@@ -1,11 +1,12 @@
 #include "Base/Geom/VertexBlob.h"
 
+#include <cstring>
 #include <new>
 #include <utility>
 
 namespace XPointBlob {
 
-    static int GetFieldSize(VertexBlobField field)
+    int GetFieldSize(VertexBlobField field)
     {
         switch (field)
         {
@@ -17,6 +18,10 @@ namespace XPointBlob {
             return sizeof(PointBlobFieldMeta<VertexBlobField::Color>::Type);
         case VertexBlobField::TexCoords:
             return sizeof(PointBlobFieldMeta<VertexBlobField::TexCoords>::Type);
+        case VertexBlobField::Tangent:
+            return sizeof(PointBlobFieldMeta<VertexBlobField::Tangent>::Type);
+        case VertexBlobField::BakedLight:
+            return sizeof(PointBlobFieldMeta<VertexBlobField::BakedLight>::Type);
         default:
             assert(false);
             return 0;
@@ -102,6 +107,31 @@ int VertexBlob::TotalSize() const
     return XPointBlob::GetPointSize(m_fields) * Size();
 }
 
+void VertexBlob::CopyPoint(int index, const VertexBlob& source, int sourceIndex)
+{
+    assert(index >= 0 && index < m_size);
+    assert(sourceIndex >= 0 && sourceIndex < source.m_size);
+
+    const VertexBlobField commonFields = m_fields & source.m_fields;
+
+    uint8_t* const point = m_blob +
+        static_cast<size_t>(index) * XPointBlob::GetPointSize(m_fields);
+
+    const uint8_t* const sourcePoint = source.m_blob +
+        static_cast<size_t>(sourceIndex) * XPointBlob::GetPointSize(source.m_fields);
+
+    for (VertexBlobField i = static_cast<VertexBlobField>(1); i < VertexBlobField::_Last; i <<= 1)
+    {
+        if ((commonFields & i) != VertexBlobField::Empty)
+        {
+            std::memcpy(
+                point + XPointBlob::GetFieldOffset(i, m_fields),
+                sourcePoint + XPointBlob::GetFieldOffset(i, source.m_fields),
+                XPointBlob::GetFieldSize(i));
+        }
+    }
+}
+
 VertexBlob& VertexBlob::Swap(VertexBlob& other)
 {
     std::swap(m_fields, other.m_fields);
@@ -18,8 +18,12 @@ enum class VertexBlobField : uint16_t
     Color = 4,
     // Texture coordinates
     TexCoords = 8,
+    // Tangent with bitangent sign in w component
+    Tangent = 16,
+    // Baked static lights irradiance with ambient occlusion in w component
+    BakedLight = 32,
     // Must be last entry
-    _Last = 16
+    _Last = 64
 };
 
 ENUM_FLAG_OPERATORS(VertexBlobField)
@@ -29,9 +33,12 @@ template<> struct PointBlobFieldMeta<VertexBlobField::Pos> { using Type = Vector
 template<> struct PointBlobFieldMeta<VertexBlobField::Norm> { using Type = Vector3f; };
 template<> struct PointBlobFieldMeta<VertexBlobField::Color> { using Type = Vector4f; };
 template<> struct PointBlobFieldMeta<VertexBlobField::TexCoords> { using Type = Vector2f; };
+template<> struct PointBlobFieldMeta<VertexBlobField::Tangent> { using Type = Vector4f; };
+template<> struct PointBlobFieldMeta<VertexBlobField::BakedLight> { using Type = Vector4f; };
 
 namespace XPointBlob {
 
+    int GetFieldSize(VertexBlobField field);
     int GetPointSize(VertexBlobField fields);
     int GetFieldOffset(VertexBlobField field, VertexBlobField fields);
 
@@ -91,6 +98,9 @@ public:
             XPointBlob::GetPointSize(m_fields));
     }
 
+    // Copies fields which present in both blobs from source point
+    void CopyPoint(int index, const VertexBlob& source, int sourceIndex);
+
     VertexBlob& Swap(VertexBlob& other);
 
     VertexBlob& operator=(VertexBlob&& other);
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+// Count of threads worth to spawn for cpu bound work
+inline size_t GetWorkerThreadsCount()
+{
+    const unsigned int hardwareThreads = std::thread::hardware_concurrency();
+
+    return hardwareThreads > 0 ? static_cast<size_t>(hardwareThreads) : 1;
+}
+
+/* Splits [0, count) into contiguous chunks of at least minChunkSize
+ * elements and calls func(begin, end) for every chunk. Chunks are
+ * processed on separate threads, the calling thread takes the last one.
+ */
+template<typename Func>
+void ParallelFor(size_t count, size_t minChunkSize, const Func& func)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    const size_t chunkSizeLimit = minChunkSize > 0 ? minChunkSize : 1;
+    const size_t chunksCount = std::min(GetWorkerThreadsCount(),
+        (count + chunkSizeLimit - 1) / chunkSizeLimit);
+
+    if (chunksCount < 2)
+    {
+        func(static_cast<size_t>(0), count);
+        return;
+    }
+
+    const size_t chunkSize = (count + chunksCount - 1) / chunksCount;
+
+    std::vector<std::thread> threads;
+    threads.reserve(chunksCount - 1);
+
+    size_t begin = 0;
+
+    for (size_t chunk = 0; chunk + 1 < chunksCount; ++chunk)
+    {
+        const size_t end = std::min(count, begin + chunkSize);
+        threads.emplace_back([&func, begin, end]() { func(begin, end); });
+        begin = end;
+    }
+
+    func(begin, count);
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+}
\ No newline at end of file
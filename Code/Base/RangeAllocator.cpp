@@ -0,0 +1,141 @@
+#include <cassert>
+#include <iterator>
+
+#include "Base/RangeAllocator.h"
+
+RangeAllocator::RangeAllocator(int capacity) :
+    m_capacity(capacity),
+    m_used(0)
+{
+    assert(capacity >= 0);
+
+    if (capacity > 0)
+    {
+        InsertFree(0, capacity);
+    }
+}
+
+bool RangeAllocator::Allocate(int size, int* offset)
+{
+    assert(size > 0 && offset != nullptr);
+
+    const auto best = m_freeBySize.lower_bound(size);
+
+    if (best == m_freeBySize.end())
+    {
+        return false;
+    }
+
+    *offset = best->second;
+    AllocateAt(*offset, size);
+
+    return true;
+}
+
+void RangeAllocator::AllocateAt(int offset, int size)
+{
+    const auto it = m_freeByOffset.find(offset);
+    assert(it != m_freeByOffset.end() && it->second >= size);
+
+    const int rest = it->second - size;
+    EraseFree(it);
+
+    if (rest > 0)
+    {
+        InsertFree(offset + size, rest);
+    }
+
+    m_used += size;
+}
+
+void RangeAllocator::Free(int offset, int size)
+{
+    assert(size > 0 && offset >= 0 && offset + size <= m_capacity);
+
+    m_used -= size;
+
+    // Merge with neighbours
+    auto next = m_freeByOffset.lower_bound(offset);
+
+    if (next != m_freeByOffset.end() && next->first == offset + size)
+    {
+        size += next->second;
+
+        const auto after = std::next(next);
+        EraseFree(next);
+        next = after;
+    }
+
+    if (next != m_freeByOffset.begin())
+    {
+        auto previous = std::prev(next);
+
+        if (previous->first + previous->second == offset)
+        {
+            offset = previous->first;
+            size += previous->second;
+            EraseFree(previous);
+        }
+    }
+
+    InsertFree(offset, size);
+}
+
+void RangeAllocator::Grow(int capacity)
+{
+    assert(capacity >= m_capacity);
+
+    const int added = capacity - m_capacity;
+    const int offset = m_capacity;
+
+    if (added == 0)
+    {
+        return;
+    }
+
+    // Free adds units back to used counter
+    m_capacity = capacity;
+    m_used += added;
+    Free(offset, added);
+}
+
+bool RangeAllocator::FindLower(int size, int offset, int* result) const
+{
+    for (const auto& range : m_freeByOffset)
+    {
+        if (range.first >= offset)
+        {
+            break;
+        }
+
+        if (range.second >= size)
+        {
+            *result = range.first;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void RangeAllocator::InsertFree(int offset, int size)
+{
+    m_freeByOffset[offset] = size;
+    m_freeBySize.emplace(size, offset);
+}
+
+void RangeAllocator::EraseFree(std::map<int, int>::iterator it)
+{
+    const auto sizes = m_freeBySize.equal_range(it->second);
+
+    for (auto sizeIt = sizes.first; sizeIt != sizes.second; ++sizeIt)
+    {
+        if (sizeIt->second == it->first)
+        {
+            m_freeBySize.erase(sizeIt);
+            break;
+        }
+    }
+
+    m_freeByOffset.erase(it);
+}
\ No newline at end of file
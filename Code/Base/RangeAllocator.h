@@ -0,0 +1,43 @@
+#pragma once
+
+#include <map>
+
+/* Allocator of ranges of a linear buffer, units are up to caller
+ * (bytes, vertices, indices). Allocation takes the best fitting free
+ * range, freed ranges are merged with adjacent free ones.
+ */
+class RangeAllocator
+{
+public:
+    explicit RangeAllocator(int capacity);
+
+    // False if there is no free range large enough
+    bool Allocate(int size, int* offset);
+
+    // Offset must be start of free range returned by FindLower
+    void AllocateAt(int offset, int size);
+
+    void Free(int offset, int size);
+
+    // New units are free and appended at the end
+    void Grow(int capacity);
+
+    /* Finds the lowest free range before offset which can take size
+     * units. Range moved there never overlaps its current place.
+     */
+    bool FindLower(int size, int offset, int* result) const;
+
+    int GetCapacity() const { return m_capacity; }
+    int GetUsed() const { return m_used; }
+    int GetFreeRangesCount() const { return static_cast<int>(m_freeByOffset.size()); }
+
+private:
+    void InsertFree(int offset, int size);
+    void EraseFree(std::map<int, int>::iterator it);
+
+    // Offset to size and size to offset of free ranges
+    std::map<int, int> m_freeByOffset;
+    std::multimap<int, int> m_freeBySize;
+    int m_capacity;
+    int m_used;
+};
\ No newline at end of file
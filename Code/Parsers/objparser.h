@@ -1,12 +1,17 @@
 #pragma once
+#include <algorithm>
 #include <cassert>
+#include <cstdint>
 #include <iostream>
 #include <string>
 #include <sstream>
 #include <fstream>
 #include <vector>
 #include <type_traits>
+#include <utility>
 
+#include "Base/Geom/TangentSpace.h"
+#include "Scene/MeshInstancing.h"
 #include "Scene/Model3d.h"
 
 namespace obj
@@ -26,7 +31,25 @@ namespace obj
 
     struct Facet
     {
+        Facet() :
+            m_smoothingGroup(0)
+        {}
+
         std::vector<VertexIndices> m_vertices;
+
+        // 0 means smoothing is off
+        uint32_t m_smoothingGroup;
+    };
+
+    // Object or group started by 'o' or 'g' statement
+    struct Group
+    {
+        Group() :
+            m_firstFacet(0)
+        {}
+
+        std::string m_name;
+        size_t m_firstFacet;
     };
 
     template<int size, class T>
@@ -64,10 +87,18 @@ namespace obj
     class ObjModel
     {
     public:
+        ObjModel() :
+            m_smoothingGroup(0)
+        {}
+
         std::vector<Vec<4, T>> m_vertices;
         std::vector<Vec<3, T>> m_normals;
         std::vector<Vec<3, T>> m_textureCoords;
         std::vector<Facet> m_facets;
+        std::vector<Group> m_groups;
+
+        // Smoothing group for facets being parsed
+        uint32_t m_smoothingGroup;
     };
 
     template<class T>
@@ -317,6 +348,7 @@ namespace obj
 
             if (model)
             {
+                f.m_smoothingGroup = model->m_smoothingGroup;
                 model->m_facets.push_back(f);
             }
 
@@ -326,24 +358,73 @@ namespace obj
 
         //Object name
         static ParseErrorCode Parse_O(const std::string& word,
-            std::stringstream&, ObjModel<T>*, std::ostream*)
+            std::stringstream& line, ObjModel<T>* model, std::ostream*)
         {
             assert(word.size() == 1);
+            BeginGroup(line, model);
             return ParseErrorCode::Ok;
         }
 
         //Group name
         static ParseErrorCode Parse_G(const std::string& word,
-            std::stringstream&, ObjModel<T>*, std::ostream*)
+            std::stringstream& line, ObjModel<T>* model, std::ostream*)
         {
             assert(word.size() == 1);
+            BeginGroup(line, model);
             return ParseErrorCode::Ok;
         }
 
+        static void BeginGroup(std::stringstream& line, ObjModel<T>* model)
+        {
+            if (model == nullptr)
+            {
+                return;
+            }
+
+            // 'o' followed by 'g' without facets between them names one group
+            if (model->m_groups.empty() ||
+                model->m_groups.back().m_firstFacet != model->m_facets.size())
+            {
+                model->m_groups.emplace_back();
+                model->m_groups.back().m_firstFacet = model->m_facets.size();
+            }
+
+            std::string name;
+            getline(line >> std::ws, name);
+            model->m_groups.back().m_name = name;
+        }
+
         //Smooth shading
         static ParseErrorCode Parse_S(const std::string& word,
-            std::stringstream&, ObjModel<T>*, std::ostream*)
+            std::stringstream& line, ObjModel<T>* model, std::ostream* logstream)
         {
+            std::string group;
+            line >> group;
+
+            uint32_t smoothingGroup = 0;
+
+            if (group != "off")
+            {
+                std::stringstream groupStream(group);
+                groupStream >> smoothingGroup;
+
+                if (groupStream.fail())
+                {
+                    if (logstream != nullptr)
+                    {
+                        *logstream << "Failed to read smoothing group from line "
+                            << line.str();
+                    }
+
+                    return ParseErrorCode::UnexpectedFormat;
+                }
+            }
+
+            if (model != nullptr)
+            {
+                model->m_smoothingGroup = smoothingGroup;
+            }
+
             assert(word.size() == 1);
             return ParseErrorCode::Ok;
         }
@@ -432,8 +513,13 @@ namespace obj
         }
     };
 
+    /* Missing normals are generated with respect to smoothing groups.
+     * Set generateTangents to fill VertexBlobField::Tangent when
+     * texture coordinates are present.
+     */
     template<class T>
-    Model3dPtr Convert(const ObjModel<T>& model, const IMaterialPtr& mat)
+    Model3dPtr Convert(const ObjModel<T>& model, const IMaterialPtr& mat,
+        bool generateTangents = false)
     {
         VertexBlobField fields = VertexBlobField::Pos;
 
@@ -461,6 +547,9 @@ namespace obj
         std::vector<int> indices;
         indices.reserve(model.m_facets.size() * 3);
 
+        std::vector<uint32_t> smoothingGroups;
+        smoothingGroups.reserve(model.m_facets.size());
+
         auto normView = vertexBlob->GetFieldView<VertexBlobField::Norm>();
         auto texCoordsView = vertexBlob->GetFieldView<VertexBlobField::TexCoords>();
 
@@ -470,9 +559,13 @@ namespace obj
             {
                 const VertexIndices& vi = facet.m_vertices[vertexIndex];
 
-                if (vertexIndex < 3)
+                // Polygons are triangulated as a fan
+                if (vertexIndex >= 2)
                 {
+                    indices.push_back(facet.m_vertices.front().positionIndex);
+                    indices.push_back(facet.m_vertices[vertexIndex - 1].positionIndex);
                     indices.push_back(vi.positionIndex);
+                    smoothingGroups.push_back(facet.m_smoothingGroup);
                 }
 
                 if (vi.normalIndex >= 0)
@@ -492,10 +585,210 @@ namespace obj
             }
         }
 
+        if ((fields & VertexBlobField::Norm) == VertexBlobField::Empty)
+        {
+            std::vector<int> splitIndices;
+            vertexBlob = TangentSpace::GenerateNormals(*vertexBlob,
+                indices, smoothingGroups, &splitIndices);
+            indices.swap(splitIndices);
+        }
+
+        if (generateTangents)
+        {
+            std::vector<int> splitIndices;
+            VertexBlobPtr withTangents = TangentSpace::GenerateTangents(
+                *vertexBlob, indices, &splitIndices);
+
+            if (withTangents != nullptr)
+            {
+                vertexBlob = withTangents;
+                indices.swap(splitIndices);
+            }
+        }
+
         MeshDataPtr meshData = std::make_shared<MeshData>(
             vertexBlob, std::make_shared<IndexBlob>(indices));
 
         return std::make_shared<Model3d>(meshData, mat);
     }
 
+    namespace XObj
+    {
+        /* Builds mesh with own compact vertices for facets [first, last).
+         * localIndex maps model positions to mesh vertices, it must be
+         * filled with -1 and is left so, only touched entries are reset.
+         */
+        template<class T>
+        MeshDataPtr ConvertFacets(const ObjModel<T>& model,
+            size_t firstFacet, size_t lastFacet, bool generateNormals,
+            std::vector<int>* localIndexPtr)
+        {
+            assert(localIndexPtr != nullptr && localIndexPtr->size() == model.m_vertices.size());
+            std::vector<int>& localIndex = *localIndexPtr;
+
+            VertexBlobField fields = VertexBlobField::Pos;
+
+            if (model.m_normals.size() > 0)
+            {
+                fields |= VertexBlobField::Norm;
+            }
+
+            if (model.m_textureCoords.size() > 0)
+            {
+                fields |= VertexBlobField::TexCoords;
+            }
+
+            std::vector<const VertexIndices*> localVertices;
+            std::vector<int> indices;
+            std::vector<uint32_t> smoothingGroups;
+
+            for (size_t facetIndex = firstFacet; facetIndex < lastFacet; ++facetIndex)
+            {
+                const Facet& facet = model.m_facets[facetIndex];
+
+                for (size_t vertexIndex = 0; vertexIndex < facet.m_vertices.size(); ++vertexIndex)
+                {
+                    const VertexIndices& vi = facet.m_vertices[vertexIndex];
+
+                    if (localIndex[vi.positionIndex] < 0)
+                    {
+                        localIndex[vi.positionIndex] = static_cast<int>(localVertices.size());
+                        localVertices.push_back(&vi);
+                    }
+
+                    // Polygons are triangulated as a fan
+                    if (vertexIndex >= 2)
+                    {
+                        indices.push_back(localIndex[facet.m_vertices.front().positionIndex]);
+                        indices.push_back(localIndex[facet.m_vertices[vertexIndex - 1].positionIndex]);
+                        indices.push_back(localIndex[vi.positionIndex]);
+                        smoothingGroups.push_back(facet.m_smoothingGroup);
+                    }
+                }
+            }
+
+            for (const VertexIndices* vi : localVertices)
+            {
+                localIndex[vi->positionIndex] = -1;
+            }
+
+            VertexBlobPtr vertexBlob = std::make_shared<VertexBlob>(fields,
+                static_cast<int>(localVertices.size()));
+
+            auto vertexView = vertexBlob->GetFieldView<VertexBlobField::Pos>();
+            auto normView = vertexBlob->GetFieldView<VertexBlobField::Norm>();
+            auto texCoordsView = vertexBlob->GetFieldView<VertexBlobField::TexCoords>();
+
+            for (int i = 0; i < static_cast<int>(localVertices.size()); ++i)
+            {
+                const VertexIndices& vi = *localVertices[i];
+                const auto& pos = model.m_vertices[vi.positionIndex];
+                vertexView[i] = Vector3f(pos.At<0>(), pos.At<1>(), pos.At<2>());
+
+                if (!normView.empty())
+                {
+                    normView[i] = Vector3f(0.0f, 0.0f, 0.0f);
+
+                    if (vi.normalIndex >= 0)
+                    {
+                        const auto& norm = model.m_normals[vi.normalIndex];
+                        normView[i] = Vector3f(norm.At<0>(), norm.At<1>(), norm.At<2>());
+                    }
+                }
+
+                if (!texCoordsView.empty())
+                {
+                    texCoordsView[i] = Vector2f(0.0f, 0.0f);
+
+                    if (vi.textureCoordIndex >= 0)
+                    {
+                        const auto& texCoord = model.m_textureCoords[vi.textureCoordIndex];
+                        texCoordsView[i] = Vector2f(texCoord.At<0>(), texCoord.At<1>());
+                    }
+                }
+            }
+
+            if (generateNormals && normView.empty())
+            {
+                std::vector<int> splitIndices;
+                vertexBlob = TangentSpace::GenerateNormals(*vertexBlob,
+                    indices, smoothingGroups, &splitIndices);
+                indices.swap(splitIndices);
+            }
+
+            return std::make_shared<MeshData>(
+                vertexBlob, std::make_shared<IndexBlob>(indices));
+        }
+    }
+
+    /* Converts every 'o'/'g' group to its own mesh and stores
+     * geometrically identical groups once with list of placements.
+     * Missing normals are generated for unique meshes only.
+     */
+    template<class T>
+    std::vector<MeshInstances> ConvertInstanced(const ObjModel<T>& model,
+        float tolerance = 1.0e-4f)
+    {
+        // Facets range of every non empty group
+        std::vector<std::pair<size_t, size_t>> groupFacets;
+        size_t firstFacet = 0;
+
+        for (size_t i = 0; i <= model.m_groups.size(); ++i)
+        {
+            const size_t lastFacet = i < model.m_groups.size() ?
+                model.m_groups[i].m_firstFacet : model.m_facets.size();
+
+            if (lastFacet > firstFacet)
+            {
+                groupFacets.emplace_back(firstFacet, lastFacet);
+            }
+
+            firstFacet = lastFacet;
+        }
+
+        // Shared by all groups, so its size does not multiply by groups count
+        std::vector<int> localIndex(model.m_vertices.size(), -1);
+        std::vector<MeshDataPtr> groupMeshes;
+        groupMeshes.reserve(groupFacets.size());
+
+        for (const auto& facets : groupFacets)
+        {
+            groupMeshes.push_back(XObj::ConvertFacets(model,
+                facets.first, facets.second, false, &localIndex));
+        }
+
+        std::vector<MeshInstances> result = DetectInstances(groupMeshes, tolerance);
+
+        if (model.m_normals.empty())
+        {
+            for (MeshInstances& instances : result)
+            {
+                const auto& facets = groupFacets[instances.m_sourceIndex];
+
+                instances.m_meshData = XObj::ConvertFacets(model,
+                    facets.first, facets.second, true, &localIndex);
+            }
+        }
+
+        return result;
+    }
+
+    // Makes model for every placement of converted meshes
+    inline std::vector<Model3dPtr> MakeModels(
+        const std::vector<MeshInstances>& meshes, const IMaterialPtr& mat)
+    {
+        std::vector<Model3dPtr> result;
+
+        for (const MeshInstances& instances : meshes)
+        {
+            for (const glm::mat4& matrix : instances.m_matrices)
+            {
+                result.push_back(std::make_shared<Model3d>(instances.m_meshData, mat));
+                result.back()->SetMatrix(matrix);
+            }
+        }
+
+        return result;
+    }
+
 }
\ No newline at end of file
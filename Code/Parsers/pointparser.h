@@ -0,0 +1,297 @@
+#pragma once
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <vector>
+
+#include "Base/Geom/Vector.h"
+
+namespace points
+{
+    enum class ParseErrorCode
+    {
+        CannotOpenFile,
+        UnexpectedFormat,
+        Ok
+    };
+
+    /* Reads point positions from huge files in batches, so the whole
+     * file is never in memory. Supported formats:
+     *  - OBJ, only 'v' statements are read;
+     *  - binary little endian PLY, x y z properties of 'vertex' element.
+     * Format is chosen by file extension.
+     */
+    class PointParser
+    {
+    public:
+        PointParser() :
+            m_format(Format::Obj),
+            m_pointsLeft(0),
+            m_pointSize(0)
+        {
+            m_offsets[0] = m_offsets[1] = m_offsets[2] = 0;
+            m_doubles[0] = m_doubles[1] = m_doubles[2] = false;
+        }
+
+        PointParser(const PointParser&) = delete;
+
+        ParseErrorCode Open(const std::string& fileName, std::ostream* logstream = nullptr)
+        {
+            m_file.close();
+            m_file.clear();
+
+            const size_t dot = fileName.find_last_of('.');
+            std::string extension = dot == std::string::npos ? std::string() : fileName.substr(dot + 1);
+
+            for (char& c : extension)
+            {
+                c = static_cast<char>(tolower(c));
+            }
+
+            m_format = extension == "ply" ? Format::Ply : Format::Obj;
+            m_file.open(fileName, m_format == Format::Ply ? std::ifstream::binary : std::ifstream::in);
+
+            if (!m_file.good())
+            {
+                if (logstream != nullptr)
+                {
+                    *logstream << "Can't open file " << fileName << std::endl;
+                }
+
+                return ParseErrorCode::CannotOpenFile;
+            }
+
+            return m_format == Format::Ply ? ReadPlyHeader(logstream) : ParseErrorCode::Ok;
+        }
+
+        /* Appends up to maxCount points, returns number of appended ones.
+         * Zero means the end of file.
+         */
+        size_t Read(size_t maxCount, std::vector<Vector3f>* points)
+        {
+            return m_format == Format::Ply ? ReadPly(maxCount, points) : ReadObj(maxCount, points);
+        }
+
+    private:
+        enum class Format
+        {
+            Obj,
+            Ply
+        };
+
+        size_t ReadObj(size_t maxCount, std::vector<Vector3f>* points)
+        {
+            size_t count = 0;
+
+            while (count < maxCount && std::getline(m_file, m_line))
+            {
+                // 'v' followed by whitespace, not 'vt' or 'vn'
+                const char* text = m_line.c_str();
+
+                while (*text == ' ' || *text == '\t')
+                {
+                    ++text;
+                }
+
+                if (text[0] != 'v' || (text[1] != ' ' && text[1] != '\t'))
+                {
+                    continue;
+                }
+
+                char* end = nullptr;
+                Vector3f point;
+                text += 1;
+
+                for (int axis = 0; axis < 3; ++axis)
+                {
+                    point[axis] = strtof(text, &end);
+                    text = end;
+                }
+
+                points->push_back(point);
+                ++count;
+            }
+
+            return count;
+        }
+
+        ParseErrorCode ReadPlyHeader(std::ostream* logstream)
+        {
+            bool binary = false;
+            bool vertexElement = false;
+            bool vertexFound = false;
+            int found = 0;
+
+            while (std::getline(m_file, m_line))
+            {
+                if (!m_line.empty() && m_line.back() == '\r')
+                {
+                    m_line.pop_back();
+                }
+
+                std::stringstream lineStream(m_line);
+                std::string word;
+                lineStream >> word;
+
+                if (word == "format")
+                {
+                    lineStream >> word;
+                    binary = word == "binary_little_endian";
+                }
+                else if (word == "element")
+                {
+                    std::string name;
+                    uint64_t count = 0;
+                    lineStream >> name >> count;
+
+                    // Data of elements before vertices would have to be skipped
+                    if (!vertexFound && name != "vertex" && count != 0)
+                    {
+                        return Fail("PLY elements before vertices are not supported", logstream);
+                    }
+
+                    vertexElement = name == "vertex";
+
+                    if (vertexElement)
+                    {
+                        vertexFound = true;
+                        m_pointsLeft = count;
+                    }
+                }
+                else if (word == "property" && vertexElement)
+                {
+                    std::string type;
+                    std::string name;
+                    lineStream >> type >> name;
+
+                    const int size = GetPlyTypeSize(type);
+
+                    if (size == 0)
+                    {
+                        return Fail("PLY list properties of vertices are not supported", logstream);
+                    }
+
+                    const int axis = name == "x" ? 0 : name == "y" ? 1 : name == "z" ? 2 : -1;
+
+                    if (axis >= 0 && (type == "float" || type == "float32" || type == "double" || type == "float64"))
+                    {
+                        m_offsets[axis] = m_pointSize;
+                        m_doubles[axis] = size == 8;
+                        found |= 1 << axis;
+                    }
+
+                    m_pointSize += size;
+                }
+                else if (word == "end_header")
+                {
+                    if (!binary)
+                    {
+                        return Fail("Only binary little endian PLY is supported", logstream);
+                    }
+
+                    if (found != 7)
+                    {
+                        return Fail("PLY vertices have no float x, y, z properties", logstream);
+                    }
+
+                    return ParseErrorCode::Ok;
+                }
+            }
+
+            return Fail("PLY header is not finished", logstream);
+        }
+
+        size_t ReadPly(size_t maxCount, std::vector<Vector3f>* points)
+        {
+            const size_t count = static_cast<size_t>(std::min<uint64_t>(maxCount, m_pointsLeft));
+
+            m_buffer.resize(count * m_pointSize);
+
+            if (count == 0 || !m_file.read(m_buffer.data(), m_buffer.size()))
+            {
+                m_pointsLeft = 0;
+                return 0;
+            }
+
+            m_pointsLeft -= count;
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                const char* data = m_buffer.data() + i * m_pointSize;
+                Vector3f point;
+
+                for (int axis = 0; axis < 3; ++axis)
+                {
+                    if (m_doubles[axis])
+                    {
+                        double value;
+                        memcpy(&value, data + m_offsets[axis], sizeof(value));
+                        point[axis] = static_cast<float>(value);
+                    }
+                    else
+                    {
+                        memcpy(&point[axis], data + m_offsets[axis], sizeof(float));
+                    }
+                }
+
+                points->push_back(point);
+            }
+
+            return count;
+        }
+
+        // Zero for list properties
+        static int GetPlyTypeSize(const std::string& type)
+        {
+            if (type == "char" || type == "uchar" || type == "int8" || type == "uint8")
+            {
+                return 1;
+            }
+
+            if (type == "short" || type == "ushort" || type == "int16" || type == "uint16")
+            {
+                return 2;
+            }
+
+            if (type == "int" || type == "uint" || type == "float" ||
+                type == "int32" || type == "uint32" || type == "float32")
+            {
+                return 4;
+            }
+
+            if (type == "double" || type == "float64")
+            {
+                return 8;
+            }
+
+            return 0;
+        }
+
+        static ParseErrorCode Fail(const char* message, std::ostream* logstream)
+        {
+            if (logstream != nullptr)
+            {
+                *logstream << message << std::endl;
+            }
+
+            return ParseErrorCode::UnexpectedFormat;
+        }
+
+        std::ifstream m_file;
+        Format m_format;
+        std::string m_line;
+        std::vector<char> m_buffer;
+
+        // PLY vertex layout
+        uint64_t m_pointsLeft;
+        int m_pointSize;
+        int m_offsets[3];
+        bool m_doubles[3];
+    };
+}
\ No newline at end of file
@@ -83,6 +83,30 @@ const glm::mat4& Camera::GetProjection() const
     return m_projection;
 }
 
+Frustum Camera::GetFrustum() const
+{
+    return Frustum(GetProjection() * GetViewMatrix());
+}
+
+Ray Camera::GetRay(float x, float y) const
+{
+    const glm::mat4 inverse = glm::inverse(GetProjection() * GetViewMatrix());
+
+    // Window y goes down, normalized device y goes up
+    const glm::vec2 ndc(x * 2.0f - 1.0f, 1.0f - y * 2.0f);
+
+    glm::vec4 nearPoint = inverse * glm::vec4(ndc, -1.0f, 1.0f);
+    glm::vec4 farPoint = inverse * glm::vec4(ndc, 1.0f, 1.0f);
+    nearPoint /= nearPoint.w;
+    farPoint /= farPoint.w;
+
+    const glm::vec3 direction = glm::normalize(glm::vec3(farPoint - nearPoint));
+
+    return Ray(
+        Vector3f(nearPoint.x, nearPoint.y, nearPoint.z),
+        Vector3f(direction.x, direction.y, direction.z));
+}
+
 void Camera::SetAngles(float yaw, float pitch)
 {
     glm::vec3 front;
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "Base/EnumFlags.h"
+#include "Base/Geom/Frustum.h"
+#include "Base/Geom/Ray.h"
 
 // GLM
 #include <glm/glm.hpp>
@@ -44,6 +46,14 @@ public:
     /* This is not editable value */
     const glm::mat4& GetProjection() const;
 
+    /* View volume in world space */
+    Frustum GetFrustum() const;
+
+    /* World space ray through window point, coordinates are
+     * in [0, 1] range starting from top left corner
+     */
+    Ray GetRay(float x, float y) const;
+
     void SetAngles(float yaw, float pitch);
 
     float GetYaw() const
@@ -0,0 +1,39 @@
+#include <cstring>
+
+#include "Render/CameraUniformBlock.h"
+
+CameraUniformBlock::CameraUniformBlock() :
+    m_buffer(sizeof(Data)),
+    m_data(),
+    m_uploaded(false)
+{
+}
+
+void CameraUniformBlock::Update(const Camera& camera)
+{
+    Update(camera.GetViewMatrix(), camera.GetProjection(), camera.GetPosition());
+}
+
+void CameraUniformBlock::Update(const glm::mat4& view, const glm::mat4& projection,
+    const glm::vec3& viewPosition)
+{
+    Data data;
+    data.m_view = view;
+    data.m_projection = projection;
+    data.m_viewPosition = viewPosition;
+    data.m_padding = 0.0f;
+
+    if (m_uploaded && memcmp(&data, &m_data, sizeof(Data)) == 0)
+    {
+        return;
+    }
+
+    m_data = data;
+    m_buffer.Upload(&m_data, sizeof(Data));
+    m_uploaded = true;
+}
+
+void CameraUniformBlock::Bind() const
+{
+    m_buffer.Bind(UniformBlockBinding::Camera);
+}
\ No newline at end of file
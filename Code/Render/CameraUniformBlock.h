@@ -0,0 +1,50 @@
+#pragma once
+
+#include "Render/Camera.h"
+#include "Render/UniformBuffer.h"
+
+// GLM
+#include <glm/glm.hpp>
+
+/* Camera block of all programs:
+ *
+ * layout (std140) uniform Camera
+ * {
+ *     mat4 view;
+ *     mat4 projection;
+ *     vec3 viewPosition;
+ * };
+ *
+ * Data is compared with the previous upload, so buffer is written only
+ * on frames where camera moves.
+ */
+class CameraUniformBlock
+{
+public:
+    CameraUniformBlock();
+
+    void Update(const Camera& camera);
+    void Update(const glm::mat4& view, const glm::mat4& projection,
+        const glm::vec3& viewPosition);
+
+    // Binds buffer to UniformBlockBinding::Camera
+    void Bind() const;
+
+    GLuint GetBufferId() const { return m_buffer.GetId(); }
+    int GetUploadsCount() const { return m_buffer.GetUploadsCount(); }
+
+private:
+    struct Data
+    {
+        glm::mat4 m_view;
+        glm::mat4 m_projection;
+        glm::vec3 m_viewPosition;
+        float m_padding;
+    };
+
+    static_assert(sizeof(Data) == 144, "Data must match std140 layout of Camera block");
+
+    UniformBuffer m_buffer;
+    Data m_data;
+    bool m_uploaded;
+};
\ No newline at end of file
@@ -1,33 +1,46 @@
+#include <cassert>
+
 #include "Render/ElementBufferObject.h"
+#include "Render/GLState.h"
 
 ElementBufferObject::ElementBufferObject(const VertexBufferObjectPtr& vbo,
     const IndexBlobPtr& indexBlob) :
     m_indexBlob(indexBlob),
     m_vbo(vbo)
 {
-    glBindVertexArray(m_vbo->GetVAO()->GetIdentifier());
+    // Copy target does not touch element buffer binding of any VAO
     glGenBuffers(1, &m_EBO);
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+    XGLState::BindBuffer(GL_COPY_WRITE_BUFFER, m_EBO);
+    glBufferData(GL_COPY_WRITE_BUFFER,
         sizeof(int) * m_indexBlob->GetData().size(),
         m_indexBlob->GetData().data(), GL_STATIC_DRAW);
 
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    XGLState::BindBuffer(GL_COPY_WRITE_BUFFER, 0);
 }
 
 ElementBufferObject::~ElementBufferObject()
 {
-    glDeleteBuffers(1, &m_EBO);
+    XGLState::DeleteBuffers(1, &m_EBO);
 }
 
 void ElementBufferObject::Draw()
 {
-    glBindVertexArray(m_vbo->GetVAO()->GetIdentifier());
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
+    m_vbo->Bind();
+    XGLState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
     glDrawElements(GL_TRIANGLES, 
         static_cast<GLsizei>(m_indexBlob->GetData().size()),
         GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
+}
+
+void ElementBufferObject::Draw(const IndexRange& range)
+{
+    assert(range.m_first >= 0 && range.m_count >= 0 &&
+        static_cast<size_t>(range.m_first + range.m_count) <= m_indexBlob->GetData().size());
+
+    m_vbo->Bind();
+    XGLState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
+    glDrawElements(GL_TRIANGLES,
+        static_cast<GLsizei>(range.m_count),
+        GL_UNSIGNED_INT, (GLvoid*)(range.m_first * sizeof(int)));
 }
\ No newline at end of file
@@ -14,6 +14,7 @@ public:
     ~ElementBufferObject();
 
     void Draw();
+    void Draw(const IndexRange& range);
 
     const IndexBlobPtr& GetIndexBlob() const { return m_indexBlob; }
 
@@ -0,0 +1,67 @@
+#include <cassert>
+
+#include "Render/FrameBufferObject.h"
+#include "Render/GLState.h"
+
+FrameBufferObject::FrameBufferObject(int width, int height) :
+    m_width(width),
+    m_height(height)
+{
+    assert(width > 0 && height > 0);
+
+    glGenTextures(1, &m_colorTexture);
+    XGLState::BindTexture(GL_TEXTURE_2D, m_colorTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0,
+        GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    XGLState::BindTexture(GL_TEXTURE_2D, 0);
+
+    glGenRenderbuffers(1, &m_depthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &m_FBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_FBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+        GL_TEXTURE_2D, m_colorTexture, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+        GL_RENDERBUFFER, m_depthBuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+FrameBufferObject::~FrameBufferObject()
+{
+    glDeleteFramebuffers(1, &m_FBO);
+    glDeleteRenderbuffers(1, &m_depthBuffer);
+    XGLState::DeleteTextures(1, &m_colorTexture);
+}
+
+bool FrameBufferObject::IsComplete() const
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, m_FBO);
+    const GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    return status == GL_FRAMEBUFFER_COMPLETE;
+}
+
+void FrameBufferObject::Bind() const
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, m_FBO);
+}
+
+void FrameBufferObject::UnbindAny()
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void FrameBufferObject::GenerateMipmaps() const
+{
+    XGLState::BindTexture(GL_TEXTURE_2D, m_colorTexture);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    XGLState::BindTexture(GL_TEXTURE_2D, 0);
+}
\ No newline at end of file
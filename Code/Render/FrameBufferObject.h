@@ -0,0 +1,40 @@
+#pragma once
+
+// GLEW
+#ifndef GLEW_STATIC
+#define GLEW_STATIC
+#endif
+#include <GLEW/glew.h>
+#include <memory>
+
+// Offscreen render target with RGBA color texture and depth buffer
+class FrameBufferObject
+{
+public:
+    FrameBufferObject(int width, int height);
+    ~FrameBufferObject();
+
+    FrameBufferObject(const FrameBufferObject&) = delete;
+
+    bool IsComplete() const;
+
+    // Following draws go to this buffer, viewport is not changed
+    void Bind() const;
+    static void UnbindAny();
+
+    // Call after drawing to sample color texture with mipmaps
+    void GenerateMipmaps() const;
+
+    int GetWidth() const { return m_width; }
+    int GetHeight() const { return m_height; }
+    GLuint GetColorTexture() const { return m_colorTexture; }
+
+private:
+    int m_width;
+    int m_height;
+    GLuint m_FBO;
+    GLuint m_colorTexture;
+    GLuint m_depthBuffer;
+};
+
+using FrameBufferObjectPtr = std::shared_ptr<FrameBufferObject>;
\ No newline at end of file
@@ -0,0 +1,260 @@
+#include "Render/GLState.h"
+
+namespace
+{
+    // Value of binding is unknown until it is set through the shadow
+    const GLuint kUnknown = static_cast<GLuint>(-1);
+    const GLfloat kUnknownSize = -1.0f;
+    const int kTextureUnitsCount = 32;
+
+    enum BufferTarget
+    {
+        ArrayBuffer,
+        ElementArrayBuffer,
+        DrawIndirectBuffer,
+        BufferTargetsCount
+    };
+
+    struct State
+    {
+        State() :
+            m_program(kUnknown),
+            m_vertexArray(kUnknown),
+            m_activeTexture(kUnknown),
+            m_frontPolygonMode(kUnknown),
+            m_backPolygonMode(kUnknown),
+            m_lineWidth(kUnknownSize),
+            m_pointSize(kUnknownSize)
+        {
+            for (GLuint& buffer : m_buffers)
+            {
+                buffer = kUnknown;
+            }
+
+            for (GLuint& texture : m_textures)
+            {
+                texture = kUnknown;
+            }
+        }
+
+        GLuint m_program;
+        GLuint m_vertexArray;
+        GLuint m_buffers[BufferTargetsCount];
+        GLuint m_activeTexture;
+        GLuint m_textures[kTextureUnitsCount];
+        GLenum m_frontPolygonMode;
+        GLenum m_backPolygonMode;
+        GLfloat m_lineWidth;
+        GLfloat m_pointSize;
+        GLStateStats m_stats;
+    };
+
+    // Every thread has its own context
+    static thread_local State s_state;
+
+    static int GetBufferTarget(GLenum target)
+    {
+        switch (target)
+        {
+        case GL_ARRAY_BUFFER: return ArrayBuffer;
+        case GL_ELEMENT_ARRAY_BUFFER: return ElementArrayBuffer;
+        case GL_DRAW_INDIRECT_BUFFER: return DrawIndirectBuffer;
+        default: return -1;
+        }
+    }
+
+    // Returns true if call must be issued
+    template<typename T>
+    static bool Update(T& shadow, T value)
+    {
+        if (shadow == value)
+        {
+            ++s_state.m_stats.m_filteredCalls;
+            return false;
+        }
+
+        shadow = value;
+        ++s_state.m_stats.m_issuedCalls;
+        return true;
+    }
+
+    static void Issue()
+    {
+        ++s_state.m_stats.m_issuedCalls;
+    }
+}
+
+namespace XGLState {
+
+    void UseProgram(GLuint program)
+    {
+        if (Update(s_state.m_program, program))
+        {
+            glUseProgram(program);
+        }
+    }
+
+    void BindVertexArray(GLuint vertexArray)
+    {
+        if (Update(s_state.m_vertexArray, vertexArray))
+        {
+            glBindVertexArray(vertexArray);
+
+            // Element array binding is part of VAO
+            s_state.m_buffers[ElementArrayBuffer] = kUnknown;
+        }
+    }
+
+    void BindBuffer(GLenum target, GLuint buffer)
+    {
+        const int index = GetBufferTarget(target);
+
+        if (index < 0)
+        {
+            Issue();
+            glBindBuffer(target, buffer);
+            return;
+        }
+
+        if (Update(s_state.m_buffers[index], buffer))
+        {
+            glBindBuffer(target, buffer);
+        }
+    }
+
+    void ActiveTexture(GLenum unit)
+    {
+        if (Update(s_state.m_activeTexture, unit))
+        {
+            glActiveTexture(unit);
+        }
+    }
+
+    void BindTexture(GLenum target, GLuint texture)
+    {
+        const GLuint unit = s_state.m_activeTexture - GL_TEXTURE0;
+
+        if (target != GL_TEXTURE_2D || s_state.m_activeTexture == kUnknown ||
+            unit >= static_cast<GLuint>(kTextureUnitsCount))
+        {
+            Issue();
+            glBindTexture(target, texture);
+            return;
+        }
+
+        if (Update(s_state.m_textures[unit], texture))
+        {
+            glBindTexture(target, texture);
+        }
+    }
+
+    void PolygonMode(GLenum face, GLenum mode)
+    {
+        const bool front = face != GL_BACK;
+        const bool back = face != GL_FRONT;
+
+        if ((!front || s_state.m_frontPolygonMode == mode) &&
+            (!back || s_state.m_backPolygonMode == mode))
+        {
+            ++s_state.m_stats.m_filteredCalls;
+            return;
+        }
+
+        if (front)
+        {
+            s_state.m_frontPolygonMode = mode;
+        }
+
+        if (back)
+        {
+            s_state.m_backPolygonMode = mode;
+        }
+
+        Issue();
+        glPolygonMode(face, mode);
+    }
+
+    void LineWidth(GLfloat width)
+    {
+        if (Update(s_state.m_lineWidth, width))
+        {
+            glLineWidth(width);
+        }
+    }
+
+    void PointSize(GLfloat size)
+    {
+        if (Update(s_state.m_pointSize, size))
+        {
+            glPointSize(size);
+        }
+    }
+
+    void DeleteProgram(GLuint program)
+    {
+        // Program in use stays current until another one is used
+        if (s_state.m_program == program)
+        {
+            s_state.m_program = kUnknown;
+        }
+
+        glDeleteProgram(program);
+    }
+
+    void DeleteVertexArrays(GLsizei count, const GLuint* vertexArrays)
+    {
+        for (GLsizei i = 0; i < count; ++i)
+        {
+            if (vertexArrays[i] != 0 && s_state.m_vertexArray == vertexArrays[i])
+            {
+                s_state.m_vertexArray = 0;
+                s_state.m_buffers[ElementArrayBuffer] = 0;
+            }
+        }
+
+        glDeleteVertexArrays(count, vertexArrays);
+    }
+
+    void DeleteBuffers(GLsizei count, const GLuint* buffers)
+    {
+        for (GLsizei i = 0; i < count; ++i)
+        {
+            for (GLuint& buffer : s_state.m_buffers)
+            {
+                if (buffers[i] != 0 && buffer == buffers[i])
+                {
+                    buffer = 0;
+                }
+            }
+        }
+
+        glDeleteBuffers(count, buffers);
+    }
+
+    void DeleteTextures(GLsizei count, const GLuint* textures)
+    {
+        for (GLsizei i = 0; i < count; ++i)
+        {
+            for (GLuint& texture : s_state.m_textures)
+            {
+                if (textures[i] != 0 && texture == textures[i])
+                {
+                    texture = 0;
+                }
+            }
+        }
+
+        glDeleteTextures(count, textures);
+    }
+
+    const GLStateStats& GetStats()
+    {
+        return s_state.m_stats;
+    }
+
+    void ResetStats()
+    {
+        s_state.m_stats = GLStateStats();
+    }
+
+}
\ No newline at end of file
@@ -0,0 +1,51 @@
+#pragma once
+
+// GLEW
+#ifndef GLEW_STATIC
+#define GLEW_STATIC
+#endif
+#include <GLEW/glew.h>
+
+struct GLStateStats
+{
+    GLStateStats() :
+        m_issuedCalls(0),
+        m_filteredCalls(0)
+    {}
+
+    // Calls passed to GL
+    int m_issuedCalls;
+    // Calls which would set the value already in effect
+    int m_filteredCalls;
+};
+
+/* Shadows of GL bindings and fixed state with the same signatures as GL
+ * calls, values already in effect are not set again. All changes of
+ * tracked state must go through these functions, otherwise shadow gets
+ * out of sync. Tracked buffer targets are array, element array and draw
+ * indirect ones, element array binding is forgotten when VAO changes.
+ * Texture bindings are tracked for GL_TEXTURE_2D target. Shadow belongs
+ * to calling thread, as its GL context does.
+ */
+namespace XGLState {
+
+    void UseProgram(GLuint program);
+    void BindVertexArray(GLuint vertexArray);
+    void BindBuffer(GLenum target, GLuint buffer);
+    void ActiveTexture(GLenum unit);
+    void BindTexture(GLenum target, GLuint texture);
+    void PolygonMode(GLenum face, GLenum mode);
+    void LineWidth(GLfloat width);
+    void PointSize(GLfloat size);
+
+    // GL unbinds deleted objects, shadow has to follow
+    void DeleteProgram(GLuint program);
+    void DeleteVertexArrays(GLsizei count, const GLuint* vertexArrays);
+    void DeleteBuffers(GLsizei count, const GLuint* buffers);
+    void DeleteTextures(GLsizei count, const GLuint* textures);
+
+    // Counters of calling thread since the last reset, reset once per frame
+    const GLStateStats& GetStats();
+    void ResetStats();
+
+}
\ No newline at end of file
@@ -0,0 +1,408 @@
+#include <algorithm>
+#include <cassert>
+
+#include "Render/MeshBufferPool.h"
+#include "Render/GLState.h"
+#include "Render/VertexFormat.h"
+
+MeshBufferPool::Storage::Storage(int elementSize, int capacity) :
+    m_elementSize(elementSize),
+    m_allocator(capacity),
+    m_fragmented(false)
+{
+    // Copy targets do not touch element buffer binding of current VAO
+    glGenBuffers(1, &m_buffer);
+    XGLState::BindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER,
+        static_cast<size_t>(capacity) * m_elementSize, nullptr, GL_STATIC_DRAW);
+    XGLState::BindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+MeshBufferPool::MeshBufferPool(VertexBlobField fields,
+    int verticesCapacity, int indicesCapacity) :
+    m_fields(fields),
+    m_VAO(0),
+    m_vertices(XPointBlob::GetPointSize(fields), verticesCapacity),
+    m_indices(sizeof(int), indicesCapacity),
+    m_fence(nullptr)
+{
+    assert(verticesCapacity > 0 && indicesCapacity > 0);
+}
+
+MeshBufferPool::~MeshBufferPool()
+{
+    // Shared VAO of the format is not owned
+    if (!XVertexFormat::IsSeparateFormatSupported())
+    {
+        XGLState::DeleteVertexArrays(1, &m_VAO);
+    }
+
+    XGLState::DeleteBuffers(1, &m_vertices.m_buffer);
+    XGLState::DeleteBuffers(1, &m_indices.m_buffer);
+
+    if (m_fence != nullptr)
+    {
+        glDeleteSync(m_fence);
+    }
+}
+
+int MeshBufferPool::AddVertices(const VertexBlob& vertices)
+{
+    assert(vertices.GetFields() == m_fields);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    WaitForOtherThreads();
+    const int id = Add(m_vertices, vertices.Data(), vertices.Size());
+    FenceChanges();
+
+    return id;
+}
+
+int MeshBufferPool::AddIndices(const IndexBlobPtr& indices)
+{
+    const std::vector<int>& data = indices->GetData();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    WaitForOtherThreads();
+    const int id = Add(m_indices, data.data(), static_cast<int>(data.size()));
+    FenceChanges();
+
+    return id;
+}
+
+void MeshBufferPool::FreeVertices(int range)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // Freed range may be refilled by other thread while draws of this one read it
+    Free(m_vertices, range);
+    FenceChanges();
+}
+
+void MeshBufferPool::FreeIndices(int range)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    Free(m_indices, range);
+    FenceChanges();
+}
+
+int MeshBufferPool::GetVerticesOffset(int range) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_vertices.m_ranges[range].m_offset;
+}
+
+int MeshBufferPool::GetIndicesOffset(int range) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_indices.m_ranges[range].m_offset;
+}
+
+size_t MeshBufferPool::Defragment(size_t maxMovedBytes)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    WaitForOtherThreads();
+
+    const size_t moved = Defragment(m_vertices, maxMovedBytes);
+    const size_t total = moved + Defragment(m_indices, maxMovedBytes - std::min(moved, maxMovedBytes));
+
+    if (total > 0)
+    {
+        FenceChanges();
+    }
+
+    return total;
+}
+
+void MeshBufferPool::Sync()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    WaitForOtherThreads();
+}
+
+void MeshBufferPool::Bind()
+{
+    Sync();
+
+    if (XVertexFormat::IsSeparateFormatSupported())
+    {
+        // Pools of other formats and vertex buffers may use it in between
+        XGLState::BindVertexArray(XVertexFormat::GetSharedVertexArray(m_fields));
+        XVertexFormat::BindVertexBuffer(m_vertices.m_buffer, m_fields);
+        XGLState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indices.m_buffer);
+        return;
+    }
+
+    // Created on first draw, pool may be filled by a thread with other context
+    if (m_VAO == 0)
+    {
+        glGenVertexArrays(1, &m_VAO);
+        XGLState::BindVertexArray(m_VAO);
+        SetupAttributes();
+        XGLState::BindBuffer(GL_ARRAY_BUFFER, 0);
+        return;
+    }
+
+    XGLState::BindVertexArray(m_VAO);
+}
+
+void MeshBufferPool::SetupAttributes() const
+{
+    if (XVertexFormat::IsSeparateFormatSupported())
+    {
+        XVertexFormat::SetupFormat(m_fields);
+        XVertexFormat::BindVertexBuffer(m_vertices.m_buffer, m_fields);
+    }
+    else
+    {
+        XGLState::BindBuffer(GL_ARRAY_BUFFER, m_vertices.m_buffer);
+        XVertexFormat::SetupPointers(m_fields);
+    }
+
+    XGLState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indices.m_buffer);
+}
+
+int MeshBufferPool::GetVerticesCapacity() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_vertices.m_allocator.GetCapacity();
+}
+
+int MeshBufferPool::GetIndicesCapacity() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_indices.m_allocator.GetCapacity();
+}
+
+int MeshBufferPool::GetFreeRangesCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_vertices.m_allocator.GetFreeRangesCount() + m_indices.m_allocator.GetFreeRangesCount();
+}
+
+int MeshBufferPool::Add(Storage& storage, const void* data, int count)
+{
+    int offset = 0;
+
+    // Empty meshes still get an id
+    if (count > 0 && !storage.m_allocator.Allocate(count, &offset))
+    {
+        const int capacity = storage.m_allocator.GetCapacity();
+        Grow(storage, std::max(capacity * 2, capacity + count));
+
+        const bool allocated = storage.m_allocator.Allocate(count, &offset);
+        assert(allocated);
+        (void)allocated;
+    }
+
+    if (count > 0)
+    {
+        XGLState::BindBuffer(GL_COPY_WRITE_BUFFER, storage.m_buffer);
+        glBufferSubData(GL_COPY_WRITE_BUFFER,
+            static_cast<size_t>(offset) * storage.m_elementSize,
+            static_cast<size_t>(count) * storage.m_elementSize, data);
+        XGLState::BindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+
+    int id = 0;
+
+    if (!storage.m_freeIds.empty())
+    {
+        id = storage.m_freeIds.back();
+        storage.m_freeIds.pop_back();
+    }
+    else
+    {
+        id = static_cast<int>(storage.m_ranges.size());
+        storage.m_ranges.emplace_back();
+    }
+
+    storage.m_ranges[id].m_offset = offset;
+    storage.m_ranges[id].m_size = count;
+
+    return id;
+}
+
+void MeshBufferPool::Free(Storage& storage, int range)
+{
+    Range& freed = storage.m_ranges[range];
+
+    if (freed.m_size > 0)
+    {
+        storage.m_allocator.Free(freed.m_offset, freed.m_size);
+        storage.m_fragmented = true;
+    }
+
+    freed.m_offset = 0;
+    freed.m_size = 0;
+    storage.m_freeIds.push_back(range);
+}
+
+void MeshBufferPool::Grow(Storage& storage, int capacity)
+{
+    const size_t oldSize = static_cast<size_t>(storage.m_allocator.GetCapacity()) * storage.m_elementSize;
+    const size_t newSize = static_cast<size_t>(capacity) * storage.m_elementSize;
+
+    // Content goes through temporary buffer, so name of the storage is kept
+    GLuint temporary = 0;
+    glGenBuffers(1, &temporary);
+
+    XGLState::BindBuffer(GL_COPY_READ_BUFFER, storage.m_buffer);
+    XGLState::BindBuffer(GL_COPY_WRITE_BUFFER, temporary);
+    glBufferData(GL_COPY_WRITE_BUFFER, oldSize, nullptr, GL_STATIC_COPY);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldSize);
+
+    XGLState::BindBuffer(GL_COPY_READ_BUFFER, temporary);
+    XGLState::BindBuffer(GL_COPY_WRITE_BUFFER, storage.m_buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, newSize, nullptr, GL_STATIC_DRAW);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldSize);
+
+    XGLState::BindBuffer(GL_COPY_READ_BUFFER, 0);
+    XGLState::BindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    XGLState::DeleteBuffers(1, &temporary);
+
+    storage.m_allocator.Grow(capacity);
+}
+
+size_t MeshBufferPool::Defragment(Storage& storage, size_t maxMovedBytes)
+{
+    if (!storage.m_fragmented || maxMovedBytes == 0)
+    {
+        return 0;
+    }
+
+    std::vector<int> ids;
+
+    for (size_t id = 0; id < storage.m_ranges.size(); ++id)
+    {
+        if (storage.m_ranges[id].m_size > 0)
+        {
+            ids.push_back(static_cast<int>(id));
+        }
+    }
+
+    std::sort(ids.begin(), ids.end(), [&storage](int a, int b)
+    {
+        return storage.m_ranges[a].m_offset > storage.m_ranges[b].m_offset;
+    });
+
+    XGLState::BindBuffer(GL_COPY_READ_BUFFER, storage.m_buffer);
+    XGLState::BindBuffer(GL_COPY_WRITE_BUFFER, storage.m_buffer);
+
+    size_t moved = 0;
+    bool budgetExceeded = false;
+
+    for (int id : ids)
+    {
+        Range& range = storage.m_ranges[id];
+        const size_t bytes = static_cast<size_t>(range.m_size) * storage.m_elementSize;
+
+        // At least one range is moved, so large ones are not stuck
+        if (moved > 0 && moved + bytes > maxMovedBytes)
+        {
+            budgetExceeded = true;
+            break;
+        }
+
+        int lower = 0;
+
+        if (!storage.m_allocator.FindLower(range.m_size, range.m_offset, &lower))
+        {
+            continue;
+        }
+
+        // Ranges do not overlap, so copy inside one buffer is allowed
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+            static_cast<size_t>(range.m_offset) * storage.m_elementSize,
+            static_cast<size_t>(lower) * storage.m_elementSize, bytes);
+
+        storage.m_allocator.AllocateAt(lower, range.m_size);
+        storage.m_allocator.Free(range.m_offset, range.m_size);
+        range.m_offset = lower;
+
+        moved += bytes;
+    }
+
+    XGLState::BindBuffer(GL_COPY_READ_BUFFER, 0);
+    XGLState::BindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    storage.m_fragmented = budgetExceeded;
+
+    return moved;
+}
+
+void MeshBufferPool::WaitForOtherThreads()
+{
+    const std::thread::id thread = std::this_thread::get_id();
+
+    if (m_fence == nullptr || m_fenceThread == thread ||
+        std::find(m_fenceWaiters.begin(), m_fenceWaiters.end(), thread) != m_fenceWaiters.end())
+    {
+        return;
+    }
+
+    // Server side wait, commands of this context are queued after the fence
+    glWaitSync(m_fence, 0, GL_TIMEOUT_IGNORED);
+    m_fenceWaiters.push_back(thread);
+}
+
+void MeshBufferPool::FenceChanges()
+{
+    if (m_fence != nullptr)
+    {
+        glDeleteSync(m_fence);
+    }
+
+    // Flush puts the fence into command stream, other contexts may wait for it
+    m_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();
+
+    m_fenceThread = std::this_thread::get_id();
+    m_fenceWaiters.clear();
+}
+
+PooledVertices::PooledVertices(const MeshBufferPoolPtr& pool, const VertexBlobPtr& vertices) :
+    m_pool(pool),
+    m_vertexBlob(vertices)
+{
+    m_range = m_pool->AddVertices(*m_vertexBlob);
+}
+
+PooledVertices::~PooledVertices()
+{
+    m_pool->FreeVertices(m_range);
+}
+
+MeshBuffer::MeshBuffer(const PooledVerticesPtr& vertices, const IndexBlobPtr& indices) :
+    m_vertices(vertices),
+    m_indexBlob(indices)
+{
+    m_indicesCount = static_cast<int>(m_indexBlob->GetData().size());
+    m_range = GetPool()->AddIndices(m_indexBlob);
+}
+
+MeshBuffer::~MeshBuffer()
+{
+    GetPool()->FreeIndices(m_range);
+}
+
+void MeshBuffer::Draw() const
+{
+    Draw(IndexRange(0, m_indicesCount));
+}
+
+void MeshBuffer::Draw(const IndexRange& range) const
+{
+    assert(range.m_first >= 0 && range.m_count >= 0 &&
+        range.m_first + range.m_count <= m_indicesCount);
+
+    const size_t firstIndex = static_cast<size_t>(GetFirstIndex() + range.m_first);
+
+    GetPool()->Bind();
+    glDrawElementsBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(range.m_count),
+        GL_UNSIGNED_INT, (GLvoid*)(firstIndex * sizeof(int)), GetBaseVertex());
+}
\ No newline at end of file
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Base/RangeAllocator.h"
+#include "Base/Geom/IndexBlob.h"
+#include "Base/Geom/VertexBlob.h"
+
+// GLEW
+#ifndef GLEW_STATIC
+#define GLEW_STATIC
+#endif
+#include <GLEW/glew.h>
+
+/* Vertices and indices of meshes with the same vertex fields
+ * suballocated from one vertex and one element buffer, so all of them
+ * are drawn with one VAO. Buffers grow keeping their names, so VAOs set
+ * up with SetupAttributes stay valid. Defragment moves ranges, offsets
+ * must be read on every draw.
+ * Ranges are guarded by mutex, so meshes may be added and freed by
+ * loader threads with contexts sharing objects with the main one. GL
+ * changes of a thread are fenced, other threads wait for the fence in
+ * Sync before reading the buffers.
+ */
+class MeshBufferPool
+{
+public:
+    explicit MeshBufferPool(VertexBlobField fields,
+        int verticesCapacity = 1 << 16, int indicesCapacity = 1 << 18);
+    ~MeshBufferPool();
+
+    MeshBufferPool(const MeshBufferPool&) = delete;
+
+    // Return id of range
+    int AddVertices(const VertexBlob& vertices);
+    int AddIndices(const IndexBlobPtr& indices);
+
+    void FreeVertices(int range);
+    void FreeIndices(int range);
+
+    int GetVerticesOffset(int range) const;
+    int GetIndicesOffset(int range) const;
+
+    /* Moves ranges into free space below them, highest ranges first,
+     * until maxMovedBytes are copied. Copies are done by GPU, so it may
+     * be called every frame to close gaps left by freed meshes.
+     * Returns copied bytes.
+     */
+    size_t Defragment(size_t maxMovedBytes);
+
+    // Makes changes of the buffers done by other threads visible to the calling one
+    void Sync();
+
+    // Binds VAO of the pool, the one shared by its format if supported, after Sync
+    void Bind();
+
+    /* Describes vertex fields and element buffer in currently bound VAO,
+     * for VAOs which read pool buffers along with other ones
+     */
+    void SetupAttributes() const;
+
+    VertexBlobField GetFields() const { return m_fields; }
+
+    int GetVerticesCapacity() const;
+    int GetIndicesCapacity() const;
+    int GetFreeRangesCount() const;
+
+private:
+    struct Range
+    {
+        int m_offset;
+        int m_size;
+    };
+
+    // GL buffer and its ranges, sizes are in elements
+    struct Storage
+    {
+        explicit Storage(int elementSize, int capacity);
+
+        GLuint m_buffer;
+        int m_elementSize;
+        RangeAllocator m_allocator;
+        std::vector<Range> m_ranges;
+        std::vector<int> m_freeIds;
+        // Something was freed since the last defragmentation
+        bool m_fragmented;
+    };
+
+    static int Add(Storage& storage, const void* data, int count);
+    static void Free(Storage& storage, int range);
+    static void Grow(Storage& storage, int capacity);
+    static size_t Defragment(Storage& storage, size_t maxMovedBytes);
+
+    // Callers hold the mutex
+    void WaitForOtherThreads();
+    void FenceChanges();
+
+    VertexBlobField m_fields;
+    // Own VAO without separate attribute format
+    GLuint m_VAO;
+    Storage m_vertices;
+    Storage m_indices;
+
+    mutable std::mutex m_mutex;
+    // Follows the last GL change of the buffers
+    GLsync m_fence;
+    std::thread::id m_fenceThread;
+    // Threads which already waited for the fence
+    std::vector<std::thread::id> m_fenceWaiters;
+};
+
+using MeshBufferPoolPtr = std::shared_ptr<MeshBufferPool>;
+
+// Vertices of one blob in pool, may be shared by meshes with different indices
+class PooledVertices
+{
+public:
+    explicit PooledVertices(const MeshBufferPoolPtr& pool, const VertexBlobPtr& vertices);
+    ~PooledVertices();
+
+    PooledVertices(const PooledVertices&) = delete;
+
+    int GetBaseVertex() const { return m_pool->GetVerticesOffset(m_range); }
+
+    const MeshBufferPoolPtr& GetPool() const { return m_pool; }
+    const VertexBlobPtr& GetVertexBlob() const { return m_vertexBlob; }
+
+private:
+    MeshBufferPoolPtr m_pool;
+    VertexBlobPtr m_vertexBlob;
+    int m_range;
+};
+
+using PooledVerticesPtr = std::shared_ptr<PooledVertices>;
+
+// Indices of mesh in pool drawn with base vertex of its vertices
+class MeshBuffer
+{
+public:
+    explicit MeshBuffer(const PooledVerticesPtr& vertices, const IndexBlobPtr& indices);
+    ~MeshBuffer();
+
+    MeshBuffer(const MeshBuffer&) = delete;
+
+    void Draw() const;
+
+    // Range of mesh indices
+    void Draw(const IndexRange& range) const;
+
+    int GetFirstIndex() const { return GetPool()->GetIndicesOffset(m_range); }
+    int GetIndicesCount() const { return m_indicesCount; }
+    int GetBaseVertex() const { return m_vertices->GetBaseVertex(); }
+
+    const MeshBufferPoolPtr& GetPool() const { return m_vertices->GetPool(); }
+    const PooledVerticesPtr& GetVertices() const { return m_vertices; }
+    const IndexBlobPtr& GetIndexBlob() const { return m_indexBlob; }
+
+private:
+    PooledVerticesPtr m_vertices;
+    IndexBlobPtr m_indexBlob;
+    int m_indicesCount;
+    int m_range;
+};
+
+using MeshBufferPtr = std::shared_ptr<MeshBuffer>;
\ No newline at end of file
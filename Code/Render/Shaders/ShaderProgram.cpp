@@ -1,6 +1,17 @@
+#include <algorithm>
 #include <cassert>
 
 #include "Render/Shaders/ShaderProgram.h"
+#include "Render/GLState.h"
+#include "Render/UniformBuffer.h"
+
+namespace
+{
+    static bool IsSamplerType(GLenum type)
+    {
+        return type != GL_INT && type != GL_BOOL && ShaderUniformTraits<int>::IsCompatible(type);
+    }
+}
 
 ShaderProgram::ShaderProgram(const VertexShaderPtr& vertexShader,
     const FragmentShaderPtr& fragmentShader, std::ostream* logstream) :
@@ -24,26 +35,38 @@ m_fragmentShader(fragmentShader)
 
 ShaderProgram::~ShaderProgram()
 {
-    glDeleteProgram(m_id);
+    XGLState::DeleteProgram(m_id);
 }
 
 bool ShaderProgram::Use() const
 {
-    glUseProgram(m_id);
+    XGLState::UseProgram(m_id);
     return true;
 }
 
 GLuint ShaderProgram::GetUniformLocation(const GLchar* uniformName) const
 {
-    const GLuint result = glGetUniformLocation(m_id, uniformName);
-    assert(result != -1);
+    const GLuint result = TryGetUniformLocation(uniformName);
+    assert(result != static_cast<GLuint>(-1));
     return result;
 }
 
 GLuint ShaderProgram::TryGetUniformLocation(const GLchar* uniformName) const
 {
-    const GLuint result = glGetUniformLocation(m_id, uniformName);
-    return result;
+    const ShaderUniformInfo* info = FindUniform(uniformName);
+    return static_cast<GLuint>(info != nullptr ? info->m_location : -1);
+}
+
+const ShaderUniformInfo* ShaderProgram::FindUniform(const GLchar* uniformName) const
+{
+    const auto it = m_uniforms.find(uniformName);
+    return it != m_uniforms.end() ? &it->second : nullptr;
+}
+
+const ShaderUniformBlockInfo* ShaderProgram::FindUniformBlock(const GLchar* blockName) const
+{
+    const auto it = m_uniformBlocks.find(blockName);
+    return it != m_uniformBlocks.end() ? &it->second : nullptr;
 }
 
 void ShaderProgram::RecompileShaderWithText(ShaderType type, const char* addtionalCode)
@@ -60,6 +83,9 @@ void ShaderProgram::RecompileShaderWithText(ShaderType type, const char* addtion
         assert(!"Not implemented here");
         break;
     }
+
+    // Recompiled shader takes effect after relink, uniform tables are rebuilt
+    Link();
 }
 
 bool ShaderProgram::Link(std::ostream* logstream)
@@ -81,5 +107,92 @@ bool ShaderProgram::Link(std::ostream* logstream)
         return false;
     }
 
+    Reflect();
+
     return true;
+}
+
+void ShaderProgram::Reflect()
+{
+    m_uniforms.clear();
+    m_uniformBlocks.clear();
+    m_samplers.clear();
+
+    GLint uniformsCount = 0;
+    GLint maxNameLength = 0;
+    glGetProgramiv(m_id, GL_ACTIVE_UNIFORMS, &uniformsCount);
+    glGetProgramiv(m_id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+    std::vector<GLchar> name(std::max(maxNameLength, 1));
+
+    for (GLuint index = 0; index < static_cast<GLuint>(uniformsCount); ++index)
+    {
+        GLsizei length = 0;
+        ShaderUniformInfo info;
+        glGetActiveUniform(m_id, index, static_cast<GLsizei>(name.size()), &length,
+            &info.m_size, &info.m_type, name.data());
+        glGetActiveUniformsiv(m_id, 1, &index, GL_UNIFORM_BLOCK_INDEX, &info.m_blockIndex);
+
+        const std::string uniformName(name.data(), length);
+        info.m_location = info.m_blockIndex < 0 ? glGetUniformLocation(m_id, uniformName.c_str()) : -1;
+
+        m_uniforms[uniformName] = info;
+
+        if (IsSamplerType(info.m_type) && info.m_location >= 0)
+        {
+            ShaderSamplerInfo sampler;
+            sampler.m_name = uniformName;
+            sampler.m_location = info.m_location;
+            sampler.m_type = info.m_type;
+            m_samplers.push_back(sampler);
+        }
+
+        // Arrays are reported as "name[0]", other elements are found by name too
+        const size_t arrayNameLength = uniformName.size() - 3;
+
+        if (uniformName.size() > 3 && uniformName.compare(arrayNameLength, 3, "[0]") == 0)
+        {
+            const std::string arrayName = uniformName.substr(0, arrayNameLength);
+            m_uniforms[arrayName] = info;
+
+            for (GLint element = 1; element < info.m_size; ++element)
+            {
+                const std::string elementName = arrayName + "[" + std::to_string(element) + "]";
+
+                ShaderUniformInfo elementInfo = info;
+                elementInfo.m_size = info.m_size - element;
+                elementInfo.m_location = info.m_blockIndex < 0 ?
+                    glGetUniformLocation(m_id, elementName.c_str()) : -1;
+
+                m_uniforms[elementName] = elementInfo;
+            }
+        }
+    }
+
+    GLint blocksCount = 0;
+    GLint maxBlockNameLength = 0;
+    glGetProgramiv(m_id, GL_ACTIVE_UNIFORM_BLOCKS, &blocksCount);
+    glGetProgramiv(m_id, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxBlockNameLength);
+
+    name.resize(std::max(maxBlockNameLength, 1));
+
+    for (GLuint index = 0; index < static_cast<GLuint>(blocksCount); ++index)
+    {
+        GLsizei length = 0;
+        glGetActiveUniformBlockName(m_id, index, static_cast<GLsizei>(name.size()), &length, name.data());
+
+        ShaderUniformBlockInfo block;
+        block.m_index = index;
+        glGetActiveUniformBlockiv(m_id, index, GL_UNIFORM_BLOCK_DATA_SIZE, &block.m_dataSize);
+
+        // Shared blocks read buffers bound once for all programs
+        const int binding = XUniformBlock::GetBinding(name.data());
+
+        if (binding >= 0)
+        {
+            glUniformBlockBinding(m_id, index, static_cast<GLuint>(binding));
+        }
+
+        m_uniformBlocks[std::string(name.data(), length)] = block;
+    }
 }
\ No newline at end of file
@@ -1,7 +1,38 @@
 #pragma once
 
+#include <cassert>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 #include "Render/Shaders/VertexShader.h"
 #include "Render/Shaders/FragmentShader.h"
+#include "Render/Shaders/ShaderUniform.h"
+
+// Active uniform found by program introspection
+struct ShaderUniformInfo
+{
+    // -1 for members of uniform blocks
+    GLint m_location;
+    GLenum m_type;
+    // Elements count of arrays
+    GLint m_size;
+    // -1 for uniforms out of blocks
+    GLint m_blockIndex;
+};
+
+struct ShaderUniformBlockInfo
+{
+    GLuint m_index;
+    GLint m_dataSize;
+};
+
+struct ShaderSamplerInfo
+{
+    std::string m_name;
+    GLint m_location;
+    GLenum m_type;
+};
 
 class ShaderProgram
 {
@@ -17,9 +48,42 @@ public:
 
     bool Use() const;
 
+    // Looked up in the table built on link, the driver is not called
     GLuint GetUniformLocation(const GLchar* uniformName) const;
     GLuint TryGetUniformLocation(const GLchar* uniformName) const;
 
+    // nullptr if program has no such active uniform
+    const ShaderUniformInfo* FindUniform(const GLchar* uniformName) const;
+    const ShaderUniformBlockInfo* FindUniformBlock(const GLchar* blockName) const;
+    const std::vector<ShaderSamplerInfo>& GetSamplers() const { return m_samplers; }
+
+    /* Handles are resolved once and used on draw path instead of names.
+     * They stay valid until the program is relinked.
+     */
+    template<typename T>
+    ShaderUniform<T> GetUniform(const GLchar* uniformName) const
+    {
+        const ShaderUniform<T> result = TryGetUniform<T>(uniformName);
+        assert(result.IsValid());
+        return result;
+    }
+
+    template<typename T>
+    ShaderUniform<T> TryGetUniform(const GLchar* uniformName) const
+    {
+        const ShaderUniformInfo* info = FindUniform(uniformName);
+
+        if (info == nullptr || info->m_location < 0)
+        {
+            return ShaderUniform<T>();
+        }
+
+        assert(ShaderUniformTraits<T>::IsCompatible(info->m_type) && "Uniform type mismatch");
+        return ShaderUniform<T>(info->m_location);
+    }
+
+    GLuint GetId() const { return m_id; }
+
     void RecompileShaderWithText(ShaderType type, const char* addtionalCode);
 
     const VertexShaderPtr& GetVertexShader() const { return m_vertexShader; }
@@ -28,9 +92,16 @@ protected:
     bool Link(std::ostream* logstream = nullptr);
 
 private:
+    // Fills tables of active uniforms, blocks and samplers
+    void Reflect();
+
     const GLuint m_id;
     VertexShaderPtr m_vertexShader;
     FragmentShaderPtr m_fragmentShader;
+
+    std::unordered_map<std::string, ShaderUniformInfo> m_uniforms;
+    std::unordered_map<std::string, ShaderUniformBlockInfo> m_uniformBlocks;
+    std::vector<ShaderSamplerInfo> m_samplers;
 };
 
 using ShaderProgramPtr = std::shared_ptr<ShaderProgram>;
\ No newline at end of file
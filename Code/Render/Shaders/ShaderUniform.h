@@ -0,0 +1,116 @@
+#pragma once
+
+#include "Base/Geom/Vector.h"
+
+// GLEW
+#ifndef GLEW_STATIC
+#define GLEW_STATIC
+#endif
+#include <GLEW/glew.h>
+
+// GLM
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+// Maps C++ type of uniform value to GL type and upload call
+template<typename T> struct ShaderUniformTraits {};
+
+template<> struct ShaderUniformTraits<int>
+{
+    // Samplers are set with texture unit index
+    static bool IsCompatible(GLenum type)
+    {
+        switch (type)
+        {
+        case GL_INT:
+        case GL_BOOL:
+        case GL_SAMPLER_1D:
+        case GL_SAMPLER_2D:
+        case GL_SAMPLER_3D:
+        case GL_SAMPLER_CUBE:
+        case GL_SAMPLER_2D_SHADOW:
+        case GL_SAMPLER_2D_ARRAY:
+        case GL_SAMPLER_BUFFER:
+        case GL_INT_SAMPLER_2D:
+        case GL_UNSIGNED_INT_SAMPLER_2D:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    static void Upload(GLint location, int value) { glUniform1i(location, value); }
+};
+
+template<> struct ShaderUniformTraits<float>
+{
+    static bool IsCompatible(GLenum type) { return type == GL_FLOAT; }
+    static void Upload(GLint location, float value) { glUniform1f(location, value); }
+};
+
+template<> struct ShaderUniformTraits<glm::vec2>
+{
+    static bool IsCompatible(GLenum type) { return type == GL_FLOAT_VEC2; }
+    static void Upload(GLint location, const glm::vec2& value) { glUniform2f(location, value.x, value.y); }
+};
+
+template<> struct ShaderUniformTraits<glm::vec3>
+{
+    static bool IsCompatible(GLenum type) { return type == GL_FLOAT_VEC3; }
+    static void Upload(GLint location, const glm::vec3& value) { glUniform3f(location, value.x, value.y, value.z); }
+};
+
+template<> struct ShaderUniformTraits<glm::vec4>
+{
+    static bool IsCompatible(GLenum type) { return type == GL_FLOAT_VEC4; }
+    static void Upload(GLint location, const glm::vec4& value) { glUniform4f(location, value.x, value.y, value.z, value.w); }
+};
+
+template<> struct ShaderUniformTraits<Vector3f>
+{
+    static bool IsCompatible(GLenum type) { return type == GL_FLOAT_VEC3; }
+    static void Upload(GLint location, const Vector3f& value) { glUniform3f(location, value.x(), value.y(), value.z()); }
+};
+
+template<> struct ShaderUniformTraits<glm::mat3>
+{
+    static bool IsCompatible(GLenum type) { return type == GL_FLOAT_MAT3; }
+    static void Upload(GLint location, const glm::mat3& value) { glUniformMatrix3fv(location, 1, GL_FALSE, glm::value_ptr(value)); }
+};
+
+template<> struct ShaderUniformTraits<glm::mat4>
+{
+    static bool IsCompatible(GLenum type) { return type == GL_FLOAT_MAT4; }
+    static void Upload(GLint location, const glm::mat4& value) { glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value)); }
+};
+
+/* Location of uniform resolved when program is linked. Invalid handle
+ * (uniform is not active in the program) ignores values. Program must
+ * be in use when value is set.
+ */
+template<typename T>
+class ShaderUniform
+{
+public:
+    ShaderUniform() :
+        m_location(-1)
+    {}
+
+    explicit ShaderUniform(GLint location) :
+        m_location(location)
+    {}
+
+    bool IsValid() const { return m_location >= 0; }
+    GLint GetLocation() const { return m_location; }
+
+    void Set(const T& value) const
+    {
+        if (m_location >= 0)
+        {
+            ShaderUniformTraits<T>::Upload(m_location, value);
+        }
+    }
+
+private:
+    GLint m_location;
+};
\ No newline at end of file
@@ -80,6 +80,13 @@ public:
     explicit Texture2D(const char* fileName, int slot,
         TextureDataType dataType = TextureDataType::Auto,
         std::ostream* logstream = nullptr);
+
+    /* Texture from pixels in memory, rows go from the first one in data
+     * like in loaded images. Pixels are not kept, GetData returns nullptr.
+     */
+    explicit Texture2D(int width, int height, int channelsCnt,
+        const unsigned char* data, int slot);
+
     Texture2D(const Texture2D&) = delete;
     ~Texture2D();
 
@@ -92,6 +99,14 @@ public:
     void SetClampBorderColor(const Vector4f& color);
     static void UnuseAny();
 
+    int GetWidth() const { return m_width; }
+    int GetHeight() const { return m_height; }
+    // Of pixels in GetData(), may differ from the file with forced data type
+    int GetChannelsCount() const { return m_channelsCnt; }
+
+    // Pixels of loaded image, nullptr if loading failed
+    const unsigned char* GetData() const { return m_data; }
+
 private:
     int m_channelsCnt;
     int m_width;
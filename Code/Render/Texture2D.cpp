@@ -8,6 +8,7 @@
 #include <SOIL/SOIL.h>
 
 #include "Render/Texture.h"
+#include "Render/GLState.h"
 
 namespace
 {
@@ -26,6 +27,20 @@ namespace
         }
     }
 
+    static int TextureDataTypeToChannelsCount(TextureDataType dataType)
+    {
+        switch (dataType)
+        {
+        case TextureDataType::L:        return 1;
+        case TextureDataType::LA:       return 2;
+        case TextureDataType::RGB:      return 3;
+        case TextureDataType::RGBA:     return 4;
+        default:
+            assert(!"Unrecognized type");
+            return -1;
+        }
+    }
+
     static GLenum TextureDataTypeToGLenum(TextureDataType dataType)
     {
         switch (dataType)
@@ -121,6 +136,12 @@ m_dataType(dataType)
         return;
     }
 
+    // SOIL reports channels of the file, data has the forced ones
+    if (dataType != TextureDataType::Auto)
+    {
+        m_channelsCnt = TextureDataTypeToChannelsCount(dataType);
+    }
+
     glGenTextures(1, &m_id);
 
     const GLenum format = dataType == TextureDataType::Auto ?
@@ -134,6 +155,31 @@ m_dataType(dataType)
     UnuseAny();
 }
 
+Texture2D::Texture2D(int width, int height, int channelsCnt,
+    const unsigned char* data, int slot) :
+m_channelsCnt(channelsCnt),
+m_width(width),
+m_height(height),
+m_slot(slot),
+m_data(nullptr),
+m_dataType(TextureDataType::Auto)
+{
+    assert(data != nullptr && width > 0 && height > 0);
+
+    glGenTextures(1, &m_id);
+
+    const GLenum format = ChannelsCountToGLenum(m_channelsCnt);
+
+    // Rows are tightly packed
+    Use();
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, format, m_width, m_height, 0,
+        format, GL_UNSIGNED_BYTE, data);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    UnuseAny();
+}
+
 bool Texture2D::SetFiltering(TextureFilteringType type, TextureFilteringMethod method)
 {
     const GLenum glMethod = TextureFilteringMethodToGLenum(method);
@@ -184,29 +230,15 @@ bool Texture2D::SetWrapping(Texture2DAxis axis, TextureWrappingType type)
 void Texture2D::Use()
 {
     assert(m_slot >= 0 && m_slot < 32 && "Invalid texture slot");
-    glActiveTexture(GL_TEXTURE0 + m_slot);
-    glBindTexture(GL_TEXTURE_2D, m_id);
+    XGLState::ActiveTexture(GL_TEXTURE0 + m_slot);
+    XGLState::BindTexture(GL_TEXTURE_2D, m_id);
 }
 
 void Texture2D::Use(int slot)
 {
-    const std::string msg("set texture " + std::to_string(m_id) +
-        " to slot " + std::to_string(slot));
-
-    //GLint currentTexture;
-    //glGetIntegerv(GL_TEXTURE_BINDING_2D, &currentTexture);
-    //if (currentTexture != static_cast<GLint>(m_id))
-    //{
-    //    glDebugMessageInsert(
-    //        GL_DEBUG_SOURCE_APPLICATION,
-    //        GL_DEBUG_TYPE_OTHER,
-    //        GL_NO_ERROR,
-    //        GL_DEBUG_SEVERITY_NOTIFICATION,
-    //        -1, msg.c_str());
-    //}
     assert(slot >= 0 && slot < 32 && "Invalid texture slot");
-    glActiveTexture(GL_TEXTURE0 + slot);
-    glBindTexture(GL_TEXTURE_2D, m_id);
+    XGLState::ActiveTexture(GL_TEXTURE0 + slot);
+    XGLState::BindTexture(GL_TEXTURE_2D, m_id);
 }
 
 void Texture2D::SetClampBorderColor(const Vector4f& color)
@@ -218,7 +250,7 @@ void Texture2D::SetClampBorderColor(const Vector4f& color)
 
 void Texture2D::UnuseAny()
 {
-    glBindTexture(GL_TEXTURE_2D, 0);
+    XGLState::BindTexture(GL_TEXTURE_2D, 0);
 }
 
 Texture2D::~Texture2D()
@@ -0,0 +1,57 @@
+#include <cassert>
+#include <cstring>
+
+#include "Render/UniformBuffer.h"
+#include "Render/GLState.h"
+
+namespace XUniformBlock {
+
+    int GetBinding(const char* blockName)
+    {
+        if (strcmp(blockName, "Camera") == 0)
+        {
+            return static_cast<int>(UniformBlockBinding::Camera);
+        }
+
+        if (strcmp(blockName, "Lights") == 0)
+        {
+            return static_cast<int>(UniformBlockBinding::Lights);
+        }
+
+        return -1;
+    }
+
+}
+
+UniformBuffer::UniformBuffer(size_t size) :
+    m_size(size),
+    m_uploadsCount(0)
+{
+    assert(size > 0);
+
+    glGenBuffers(1, &m_UBO);
+    XGLState::BindBuffer(GL_UNIFORM_BUFFER, m_UBO);
+    glBufferData(GL_UNIFORM_BUFFER, m_size, nullptr, GL_DYNAMIC_DRAW);
+    XGLState::BindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+UniformBuffer::~UniformBuffer()
+{
+    XGLState::DeleteBuffers(1, &m_UBO);
+}
+
+void UniformBuffer::Upload(const void* data, size_t size)
+{
+    assert(size <= m_size);
+
+    XGLState::BindBuffer(GL_UNIFORM_BUFFER, m_UBO);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, size, data);
+    XGLState::BindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    ++m_uploadsCount;
+}
+
+void UniformBuffer::Bind(UniformBlockBinding binding) const
+{
+    glBindBufferBase(GL_UNIFORM_BUFFER, static_cast<GLuint>(binding), m_UBO);
+}
\ No newline at end of file
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+
+// GLEW
+#ifndef GLEW_STATIC
+#define GLEW_STATIC
+#endif
+#include <GLEW/glew.h>
+
+/* Binding points of uniform blocks shared by all programs. Programs
+ * bind blocks with these names when linked, so a buffer bound to the
+ * point once is seen by every program.
+ */
+enum class UniformBlockBinding : GLuint
+{
+    Camera = 0,
+    Lights = 1
+};
+
+namespace XUniformBlock {
+
+    // -1 for blocks without shared binding point
+    int GetBinding(const char* blockName);
+
+}
+
+// Buffer backing std140 uniform block
+class UniformBuffer
+{
+public:
+    explicit UniformBuffer(size_t size);
+    ~UniformBuffer();
+
+    UniformBuffer(const UniformBuffer&) = delete;
+
+    void Upload(const void* data, size_t size);
+    void Bind(UniformBlockBinding binding) const;
+
+    size_t GetSize() const { return m_size; }
+    GLuint GetId() const { return m_UBO; }
+
+    // Number of Upload calls, shows how often block data changes
+    int GetUploadsCount() const { return m_uploadsCount; }
+
+private:
+    GLuint m_UBO;
+    size_t m_size;
+    int m_uploadsCount;
+};
+
+using UniformBufferPtr = std::shared_ptr<UniformBuffer>;
\ No newline at end of file
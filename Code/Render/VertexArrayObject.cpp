@@ -1,4 +1,5 @@
 #include "Render/VertexArrayObject.h"
+#include "Render/GLState.h"
 
 VertexArrayObject::VertexArrayObject()
 {
@@ -7,5 +8,5 @@ VertexArrayObject::VertexArrayObject()
 
 VertexArrayObject::~VertexArrayObject()
 {
-    glDeleteVertexArrays(1, &m_VAO);
+    XGLState::DeleteVertexArrays(1, &m_VAO);
 }
\ No newline at end of file
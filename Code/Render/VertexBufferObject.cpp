@@ -1,66 +1,58 @@
 #include "VertexBufferObject.h"
+#include "Render/GLState.h"
+#include "Render/VertexFormat.h"
 
-VertexBufferObject::VertexBufferObject(const VertexArrayObjectPtr& vao, const VertexBlobPtr& vertexBlob) :
-    m_vao(vao),
+VertexBufferObject::VertexBufferObject(const VertexBlobPtr& vertexBlob) :
+    m_wireframeMode(false),
     m_vertexBlob(vertexBlob)
 {
     glGenBuffers(1, &m_VBO);
-    glBindVertexArray(vao->GetIdentifier());
-    glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
+    XGLState::BindBuffer(GL_ARRAY_BUFFER, m_VBO);
     glBufferData(GL_ARRAY_BUFFER,
         m_vertexBlob->TotalSize(),
         m_vertexBlob->Data(),
         GL_STATIC_DRAW);
 
-    VertexBlobField fields = m_vertexBlob->GetFields();
-
-    const int elemSize = XPointBlob::GetPointSize(fields);
-
-    if ((fields & VertexBlobField::Pos) != VertexBlobField::Empty)
-    {
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, elemSize,
-            //(GLvoid*)(XPointBlob::GetFieldOffset(VertexBlobField::Pos, fields)));
-            (GLvoid*)(0 * sizeof(GLfloat)));
-        glEnableVertexAttribArray(0);
-    }
-
-    if ((fields & VertexBlobField::Norm) != VertexBlobField::Empty)
-    {
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, elemSize,
-            //(GLvoid*)(XPointBlob::GetFieldOffset(VertexBlobField::Norm, fields)));
-            (GLvoid*)(3 * sizeof(GLfloat)));
-        glEnableVertexAttribArray(1);
-    }
-
-    if ((fields & VertexBlobField::TexCoords) != VertexBlobField::Empty)
+    if (!XVertexFormat::IsSeparateFormatSupported())
     {
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, elemSize,
-            //(GLvoid*)(XPointBlob::GetFieldOffset(VertexBlobField::TexCoords, fields)));
-            (GLvoid*)(6 * sizeof(GLfloat)));
-        glEnableVertexAttribArray(2);
+        m_vao = std::make_shared<VertexArrayObject>();
+        XGLState::BindVertexArray(m_vao->GetIdentifier());
+        XVertexFormat::SetupPointers(m_vertexBlob->GetFields());
+        XGLState::BindVertexArray(0);
     }
 
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    XGLState::BindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
 VertexBufferObject::~VertexBufferObject()
 {
-    glDeleteBuffers(1, &m_VBO);
+    XGLState::DeleteBuffers(1, &m_VBO);
+}
+
+void VertexBufferObject::Bind() const
+{
+    if (m_vao != nullptr)
+    {
+        XGLState::BindVertexArray(m_vao->GetIdentifier());
+        return;
+    }
+
+    const VertexBlobField fields = m_vertexBlob->GetFields();
+    XGLState::BindVertexArray(XVertexFormat::GetSharedVertexArray(fields));
+    XVertexFormat::BindVertexBuffer(m_VBO, fields);
 }
 
 void VertexBufferObject::Draw()
 {
     if (m_wireframeMode)
     {
-        glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+        XGLState::PolygonMode(GL_FRONT_AND_BACK, GL_LINE);
     }
     else
     {
-        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+        XGLState::PolygonMode(GL_FRONT_AND_BACK, GL_FILL);
     }
 
-    glBindVertexArray(m_vao->GetIdentifier());
+    Bind();
     glDrawArrays(GL_TRIANGLES, 0, m_vertexBlob->Size());
-    glBindVertexArray(0);
 }
\ No newline at end of file
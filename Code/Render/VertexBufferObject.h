@@ -3,22 +3,28 @@
 #include "Base/Geom/VertexBlob.h"
 #include "Render/VertexArrayObject.h"
 
+/* Buffers with the same fields share VAO of their format if separate
+ * attribute format is supported, otherwise buffer gets its own VAO.
+ */
 class VertexBufferObject
 {
 public:
-    explicit VertexBufferObject(const VertexArrayObjectPtr& vao,
-        const VertexBlobPtr& vertexBlob);
+    explicit VertexBufferObject(const VertexBlobPtr& vertexBlob);
     ~VertexBufferObject();
 
     void Draw();
 
-    const VertexArrayObjectPtr& GetVAO() const { return m_vao; }
+    // Binds VAO which reads this buffer, element buffer must be bound after it
+    void Bind() const;
+
+    GLuint GetIdentifier() const { return m_VBO; }
     const VertexBlobPtr& GetVertexBlob() const { return m_vertexBlob; }
 
 private:
     GLuint m_VBO;
     bool m_wireframeMode;
     VertexBlobPtr m_vertexBlob;
+    // Only without separate attribute format
     VertexArrayObjectPtr m_vao;
 };
 
@@ -0,0 +1,129 @@
+#include <cassert>
+#include <map>
+
+#include "Render/VertexFormat.h"
+#include "Render/GLState.h"
+
+namespace
+{
+    // Attribute locations of vertex fields expected by shaders
+    struct FieldAttribute
+    {
+        VertexBlobField m_field;
+        GLuint m_location;
+        GLint m_components;
+    };
+
+    const FieldAttribute kFieldAttributes[] =
+    {
+        { VertexBlobField::Pos, 0, 3 },
+        { VertexBlobField::Norm, 1, 3 },
+        { VertexBlobField::TexCoords, 2, 2 },
+        { VertexBlobField::Tangent, 3, 4 },
+        { VertexBlobField::BakedLight, 4, 4 }
+    };
+
+    class SharedVertexArrays
+    {
+    public:
+        // Context is gone at static destruction, VAOs must be released before
+        ~SharedVertexArrays()
+        {
+            assert(m_vertexArrays.empty());
+        }
+
+        void Release()
+        {
+            for (auto& item : m_vertexArrays)
+            {
+                XGLState::DeleteVertexArrays(1, &item.second);
+            }
+
+            m_vertexArrays.clear();
+        }
+
+        GLuint Get(VertexBlobField fields)
+        {
+            GLuint& vertexArray = m_vertexArrays[fields];
+
+            if (vertexArray == 0)
+            {
+                glGenVertexArrays(1, &vertexArray);
+                XGLState::BindVertexArray(vertexArray);
+                XVertexFormat::SetupFormat(fields);
+                XGLState::BindVertexArray(0);
+            }
+
+            return vertexArray;
+        }
+
+    private:
+        std::map<VertexBlobField, GLuint> m_vertexArrays;
+    };
+
+    static SharedVertexArrays s_sharedVertexArrays;
+}
+
+namespace XVertexFormat {
+
+    bool IsSeparateFormatSupported()
+    {
+        return GLEW_ARB_vertex_attrib_binding != GL_FALSE;
+    }
+
+    void SetupPointers(VertexBlobField fields)
+    {
+        const int elemSize = XPointBlob::GetPointSize(fields);
+
+        for (const FieldAttribute& attribute : kFieldAttributes)
+        {
+            if ((fields & attribute.m_field) == VertexBlobField::Empty)
+            {
+                continue;
+            }
+
+            const size_t offset = static_cast<size_t>(XPointBlob::GetFieldOffset(attribute.m_field, fields));
+            glVertexAttribPointer(attribute.m_location, attribute.m_components,
+                GL_FLOAT, GL_FALSE, elemSize, (GLvoid*)offset);
+            glEnableVertexAttribArray(attribute.m_location);
+        }
+    }
+
+    void SetupFormat(VertexBlobField fields)
+    {
+        assert(IsSeparateFormatSupported());
+
+        const GLuint binding = static_cast<GLuint>(VertexBufferBinding::Vertices);
+
+        for (const FieldAttribute& attribute : kFieldAttributes)
+        {
+            if ((fields & attribute.m_field) == VertexBlobField::Empty)
+            {
+                continue;
+            }
+
+            const GLuint offset = static_cast<GLuint>(XPointBlob::GetFieldOffset(attribute.m_field, fields));
+            glVertexAttribFormat(attribute.m_location, attribute.m_components, GL_FLOAT, GL_FALSE, offset);
+            glVertexAttribBinding(attribute.m_location, binding);
+            glEnableVertexAttribArray(attribute.m_location);
+        }
+    }
+
+    void BindVertexBuffer(GLuint buffer, VertexBlobField fields)
+    {
+        glBindVertexBuffer(static_cast<GLuint>(VertexBufferBinding::Vertices),
+            buffer, 0, XPointBlob::GetPointSize(fields));
+    }
+
+    GLuint GetSharedVertexArray(VertexBlobField fields)
+    {
+        assert(IsSeparateFormatSupported());
+        return s_sharedVertexArrays.Get(fields);
+    }
+
+    void ReleaseSharedVertexArrays()
+    {
+        s_sharedVertexArrays.Release();
+    }
+
+}
\ No newline at end of file
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "Base/Geom/VertexBlob.h"
+
+// GLEW
+#ifndef GLEW_STATIC
+#define GLEW_STATIC
+#endif
+#include <GLEW/glew.h>
+
+// Buffer binding points of VAOs with separate attribute format
+enum class VertexBufferBinding : GLuint
+{
+    Vertices = 0,
+    Instances = 1
+};
+
+namespace XVertexFormat {
+
+    // glVertexAttribFormat and glBindVertexBuffer, core since GL 4.3
+    bool IsSeparateFormatSupported();
+
+    /* Describes interleaved fields of buffer bound to GL_ARRAY_BUFFER
+     * in currently bound VAO. Fallback when separate format is missing.
+     */
+    void SetupPointers(VertexBlobField fields);
+
+    /* Describes fields read from Vertices binding in currently bound VAO,
+     * buffer is attached later with BindVertexBuffer
+     */
+    void SetupFormat(VertexBlobField fields);
+
+    // Attaches buffer to Vertices binding of currently bound VAO
+    void BindVertexBuffer(GLuint buffer, VertexBlobField fields);
+
+    /* VAO with format of fields shared by all buffers of this layout.
+     * Switching meshes rebinds vertex and element buffers instead of VAO,
+     * so both must be bound before every draw. Requires separate format.
+     * VAOs are not shared between contexts, main context must be current.
+     */
+    GLuint GetSharedVertexArray(VertexBlobField fields);
+
+    /* Deletes shared VAOs, must be called while main context is alive,
+     * e.g. before glfwTerminate. GetSharedVertexArray creates them again.
+     */
+    void ReleaseSharedVertexArrays();
+
+}
\ No newline at end of file
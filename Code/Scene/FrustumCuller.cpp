@@ -0,0 +1,190 @@
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <xmmintrin.h>
+
+#include "Base/ParallelFor.h"
+#include "Scene/FrustumCuller.h"
+
+namespace
+{
+    const size_t kPacketSize = 4;
+    // Single thread handles up to a hundred thousand boxes faster than spawning threads
+    const size_t kMinPacketsPerThread = 8192;
+
+    // Plane coefficients broadcast to all lanes
+    struct PacketPlane
+    {
+        __m128 m_normal[3];
+        __m128 m_absNormal[3];
+        __m128 m_distance;
+    };
+
+    static int TestPacket(const PacketPlane* planes,
+        const float* const* centers, const float* const* extents,
+        size_t offset, uint8_t* failedPlane)
+    {
+        const __m128 zero = _mm_setzero_ps();
+
+        const __m128 cx = _mm_loadu_ps(centers[0] + offset);
+        const __m128 cy = _mm_loadu_ps(centers[1] + offset);
+        const __m128 cz = _mm_loadu_ps(centers[2] + offset);
+        const __m128 ex = _mm_loadu_ps(extents[0] + offset);
+        const __m128 ey = _mm_loadu_ps(extents[1] + offset);
+        const __m128 ez = _mm_loadu_ps(extents[2] + offset);
+
+        __m128 inside = _mm_cmpeq_ps(zero, zero);
+
+        for (int i = 0; i < Frustum::PlanesCount; ++i)
+        {
+            const int index = (*failedPlane + i) % Frustum::PlanesCount;
+            const PacketPlane& plane = planes[index];
+
+            __m128 distance = _mm_mul_ps(plane.m_normal[0], cx);
+            distance = _mm_add_ps(distance, _mm_mul_ps(plane.m_normal[1], cy));
+            distance = _mm_add_ps(distance, _mm_mul_ps(plane.m_normal[2], cz));
+            distance = _mm_add_ps(distance, plane.m_distance);
+
+            __m128 radius = _mm_mul_ps(plane.m_absNormal[0], ex);
+            radius = _mm_add_ps(radius, _mm_mul_ps(plane.m_absNormal[1], ey));
+            radius = _mm_add_ps(radius, _mm_mul_ps(plane.m_absNormal[2], ez));
+
+            inside = _mm_andnot_ps(_mm_cmplt_ps(_mm_add_ps(distance, radius), zero), inside);
+
+            if (_mm_movemask_ps(inside) == 0)
+            {
+                *failedPlane = static_cast<uint8_t>(index);
+                return 0;
+            }
+        }
+
+        return _mm_movemask_ps(inside);
+    }
+}
+
+void FrustumCuller::Cull(const Frustum& frustum, const std::vector<Model3dPtr>& models,
+    std::vector<int>* visible)
+{
+    Resize(models.size());
+
+    ParallelFor(models.size(), kMinPacketsPerThread * kPacketSize, [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            SetBox(i, models[i]->GetBoundingBox());
+        }
+    });
+
+    CullPrepared(frustum, visible);
+}
+
+void FrustumCuller::Cull(const Frustum& frustum, const std::vector<BoundingBox3f>& boxes,
+    std::vector<int>* visible)
+{
+    Resize(boxes.size());
+
+    ParallelFor(boxes.size(), kMinPacketsPerThread * kPacketSize, [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            SetBox(i, boxes[i]);
+        }
+    });
+
+    CullPrepared(frustum, visible);
+}
+
+void FrustumCuller::Resize(size_t count)
+{
+    const size_t packets = (count + kPacketSize - 1) / kPacketSize;
+
+    // Cached planes are meaningless for another set of boxes
+    if (packets != m_failedPlanes.size())
+    {
+        m_failedPlanes.assign(packets, 0);
+    }
+
+    m_masks.resize(packets);
+
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        m_centers[axis].resize(packets * kPacketSize);
+        m_extents[axis].resize(packets * kPacketSize);
+    }
+
+    // Padding boxes are never visible
+    for (size_t i = count; i < packets * kPacketSize; ++i)
+    {
+        SetBox(i, BoundingBox3f::kInvalid);
+    }
+}
+
+void FrustumCuller::SetBox(size_t index, const BoundingBox3f& box)
+{
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        if (box.IsValid())
+        {
+            m_centers[axis][index] = (box.min[axis] + box.max[axis]) * 0.5f;
+            m_extents[axis][index] = (box.max[axis] - box.min[axis]) * 0.5f;
+        }
+        else
+        {
+            // Negative radius puts box outside of every plane
+            m_centers[axis][index] = 0.0f;
+            m_extents[axis][index] = -FLT_MAX;
+        }
+    }
+}
+
+void FrustumCuller::CullPrepared(const Frustum& frustum, std::vector<int>* visible)
+{
+    assert(visible != nullptr);
+
+    PacketPlane planes[Frustum::PlanesCount];
+
+    for (int i = 0; i < Frustum::PlanesCount; ++i)
+    {
+        const Vector4f& plane = frustum.GetPlane(i);
+
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            planes[i].m_normal[axis] = _mm_set1_ps(plane[axis]);
+            planes[i].m_absNormal[axis] = _mm_set1_ps(std::abs(plane[axis]));
+        }
+
+        planes[i].m_distance = _mm_set1_ps(plane.w());
+    }
+
+    const float* const centers[3] = { m_centers[0].data(), m_centers[1].data(), m_centers[2].data() };
+    const float* const extents[3] = { m_extents[0].data(), m_extents[1].data(), m_extents[2].data() };
+
+    ParallelFor(m_masks.size(), kMinPacketsPerThread, [&](size_t begin, size_t end)
+    {
+        for (size_t packet = begin; packet < end; ++packet)
+        {
+            m_masks[packet] = static_cast<uint8_t>(TestPacket(planes, centers, extents,
+                packet * kPacketSize, &m_failedPlanes[packet]));
+        }
+    });
+
+    visible->clear();
+
+    for (size_t packet = 0; packet < m_masks.size(); ++packet)
+    {
+        const int mask = m_masks[packet];
+
+        if (mask == 0)
+        {
+            continue;
+        }
+
+        for (size_t lane = 0; lane < kPacketSize; ++lane)
+        {
+            if ((mask & (1 << lane)) != 0)
+            {
+                visible->push_back(static_cast<int>(packet * kPacketSize + lane));
+            }
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Base/Geom/BoundingBox.h"
+#include "Base/Geom/Frustum.h"
+#include "Scene/Model3d.h"
+
+/* Tests many bounding boxes against frustum. Boxes are kept in
+ * structure of arrays form and tested four at once with SSE.
+ * Plane which rejected a group of boxes last time is tested first
+ * next time, so culler should be reused between frames.
+ * Big inputs are split between threads.
+ */
+class FrustumCuller
+{
+public:
+    FrustumCuller() {}
+
+    FrustumCuller(const FrustumCuller&) = delete;
+
+    /* Fills visible with ascending indices of models intersecting frustum.
+     * World bounding boxes of models are updated here, so models must
+     * not repeat in the list.
+     */
+    void Cull(const Frustum& frustum, const std::vector<Model3dPtr>& models,
+        std::vector<int>* visible);
+
+    void Cull(const Frustum& frustum, const std::vector<BoundingBox3f>& boxes,
+        std::vector<int>* visible);
+
+private:
+    void Resize(size_t count);
+    void SetBox(size_t index, const BoundingBox3f& box);
+    void CullPrepared(const Frustum& frustum, std::vector<int>* visible);
+
+    // Box centers and half sizes per axis, padded to multiple of four
+    std::vector<float> m_centers[3];
+    std::vector<float> m_extents[3];
+
+    // Visibility bits and last failed plane per group of four boxes
+    std::vector<uint8_t> m_masks;
+    std::vector<uint8_t> m_failedPlanes;
+};
\ No newline at end of file
@@ -0,0 +1,110 @@
+#include <algorithm>
+#include <cassert>
+
+#include <SOIL/SOIL.h>
+
+#include "Scene/Heightmap.h"
+
+Heightmap::Heightmap() :
+    m_width(0),
+    m_height(0)
+{
+}
+
+bool Heightmap::OpenRaw(const std::string& fileName, int width, int height,
+    std::ostream* logstream)
+{
+    assert(width > 0 && height > 0);
+
+    m_image.clear();
+    m_file.close();
+    m_file.clear();
+    m_file.open(fileName, std::ifstream::binary | std::ifstream::ate);
+
+    const std::streamoff expectedSize = static_cast<std::streamoff>(width) * height * sizeof(uint16_t);
+
+    if (!m_file.good() || static_cast<std::streamoff>(m_file.tellg()) < expectedSize)
+    {
+        if (logstream != nullptr)
+        {
+            *logstream << "ERROR::HEIGHTMAP::" << fileName << "::CAN_NOT_READ" << std::endl;
+        }
+
+        m_file.close();
+        m_width = m_height = 0;
+        return false;
+    }
+
+    m_width = width;
+    m_height = height;
+
+    return true;
+}
+
+bool Heightmap::OpenImage(const std::string& fileName, std::ostream* logstream)
+{
+    m_file.close();
+
+    int channelsCnt = 0;
+    unsigned char* data = SOIL_load_image(fileName.c_str(), &m_width, &m_height,
+        &channelsCnt, SOIL_LOAD_L);
+
+    if (data == nullptr)
+    {
+        if (logstream != nullptr)
+        {
+            *logstream << "ERROR::HEIGHTMAP::" << fileName << "::CAN_NOT_READ" << std::endl;
+        }
+
+        m_width = m_height = 0;
+        return false;
+    }
+
+    // 255 * 257 = 65535
+    m_image.resize(static_cast<size_t>(m_width) * m_height);
+
+    for (size_t i = 0; i < m_image.size(); ++i)
+    {
+        m_image[i] = static_cast<uint16_t>(data[i] * 257);
+    }
+
+    SOIL_free_image_data(data);
+
+    return true;
+}
+
+void Heightmap::ReadRow(int y, int x, int count, int step, uint16_t* result)
+{
+    assert(m_width > 0 && count > 0 && step > 0);
+
+    y = std::min(std::max(y, 0), m_height - 1);
+
+    // Samples inside of the map are read with one call
+    const int first = std::min(std::max(x, 0), m_width - 1);
+    const int last = std::min(std::max(x + (count - 1) * step, 0), m_width - 1);
+    const uint16_t* row = nullptr;
+
+    if (!m_image.empty())
+    {
+        row = m_image.data() + static_cast<size_t>(y) * m_width + first;
+    }
+    else
+    {
+        m_row.resize(last - first + 1);
+        m_file.clear();
+        m_file.seekg((static_cast<std::streamoff>(y) * m_width + first) * sizeof(uint16_t));
+
+        if (!m_file.read(reinterpret_cast<char*>(m_row.data()), m_row.size() * sizeof(uint16_t)))
+        {
+            std::fill(m_row.begin(), m_row.end(), static_cast<uint16_t>(0));
+        }
+
+        row = m_row.data();
+    }
+
+    for (int i = 0; i < count; ++i)
+    {
+        const int sampleX = std::min(std::max(x + i * step, first), last);
+        result[i] = row[sampleX - first];
+    }
+}
\ No newline at end of file
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/* Grid of 16 bit height samples read row by row, so raw maps much
+ * larger than memory can be streamed. Images are decoded by SOIL,
+ * which gives 8 bits per channel, so they are loaded whole and
+ * scaled to 16 bits.
+ */
+class Heightmap
+{
+public:
+    Heightmap();
+
+    Heightmap(const Heightmap&) = delete;
+
+    // Little endian 16 bit samples without header, rows go one by one
+    bool OpenRaw(const std::string& fileName, int width, int height,
+        std::ostream* logstream = nullptr);
+
+    bool OpenImage(const std::string& fileName, std::ostream* logstream = nullptr);
+
+    int GetWidth() const { return m_width; }
+    int GetHeight() const { return m_height; }
+
+    /* Reads count samples of row y starting from x with given step.
+     * Coordinates outside of the map are clamped to the border.
+     * Not thread safe.
+     */
+    void ReadRow(int y, int x, int count, int step, uint16_t* result);
+
+private:
+    std::ifstream m_file;
+    std::vector<uint16_t> m_image;
+    std::vector<uint16_t> m_row;
+    int m_width;
+    int m_height;
+};
+
+using HeightmapPtr = std::shared_ptr<Heightmap>;
\ No newline at end of file
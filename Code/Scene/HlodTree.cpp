@@ -0,0 +1,472 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+
+#include "Base/ParallelFor.h"
+#include "Base/Geom/SpatialOrder.h"
+#include "Scene/HlodTree.h"
+
+namespace
+{
+    const int kMaxCellIndex = 0xffff;
+    const int kAtlasChannels = 3;
+
+    // Proxy data which can be built without GL context
+    struct ProxyData
+    {
+        VertexBlobPtr m_vertices;
+        std::vector<int> m_indices;
+        BoundingBox3f m_bounds;
+
+        int m_atlasWidth;
+        int m_atlasHeight;
+        std::vector<unsigned char> m_diffuse;
+        std::vector<unsigned char> m_specular;
+    };
+
+    struct Cluster
+    {
+        Cluster() :
+            m_position(Vector3f::Zero()),
+            m_normal(Vector3f::Zero()),
+            m_texCoords(Vector2f::Zero()),
+            m_count(0)
+        {}
+
+        Vector3f m_position;
+        Vector3f m_normal;
+        Vector2f m_texCoords;
+        int m_count;
+    };
+
+    static void CollectModels(const std::vector<HlodTree::Node>& nodes, int node,
+        std::vector<int>* models)
+    {
+        const HlodTree::Node& current = nodes[node];
+        models->insert(models->end(), current.m_models.begin(), current.m_models.end());
+
+        for (int child : current.m_children)
+        {
+            CollectModels(nodes, child, models);
+        }
+    }
+
+    static const Texture2D* GetTexture(const Model3d& model, bool specular)
+    {
+        const TexturedMaterial* material =
+            dynamic_cast<const TexturedMaterial*>(model.GetMaterial().get());
+
+        if (material == nullptr)
+        {
+            return nullptr;
+        }
+
+        return specular ? material->GetSpecular().get() : material->GetDiffuse().get();
+    }
+
+    // Shrinks texture into the tile with box filter, fills tile without texture
+    static void BakeTile(const Texture2D* texture, unsigned char fill, int tileSize,
+        int tileX, int tileY, int atlasWidth, std::vector<unsigned char>* atlas)
+    {
+        const unsigned char* source = texture != nullptr ? texture->GetData() : nullptr;
+
+        for (int y = 0; y < tileSize; ++y)
+        {
+            unsigned char* row = atlas->data() +
+                (static_cast<size_t>(tileY * tileSize + y) * atlasWidth + tileX * tileSize) * kAtlasChannels;
+
+            for (int x = 0; x < tileSize; ++x)
+            {
+                unsigned char* texel = row + x * kAtlasChannels;
+
+                if (source == nullptr)
+                {
+                    std::fill(texel, texel + kAtlasChannels, fill);
+                    continue;
+                }
+
+                const int width = texture->GetWidth();
+                const int height = texture->GetHeight();
+                const int channels = texture->GetChannelsCount();
+
+                const int x0 = x * width / tileSize;
+                const int x1 = std::max(x0 + 1, (x + 1) * width / tileSize);
+                const int y0 = y * height / tileSize;
+                const int y1 = std::max(y0 + 1, (y + 1) * height / tileSize);
+
+                int sum[kAtlasChannels] = { 0, 0, 0 };
+
+                for (int sy = y0; sy < y1; ++sy)
+                {
+                    for (int sx = x0; sx < x1; ++sx)
+                    {
+                        const unsigned char* pixel = source +
+                            (static_cast<size_t>(sy) * width + sx) * channels;
+
+                        for (int channel = 0; channel < kAtlasChannels; ++channel)
+                        {
+                            // Greyscale images have single color channel
+                            sum[channel] += pixel[channels < 3 ? 0 : channel];
+                        }
+                    }
+                }
+
+                const int count = (x1 - x0) * (y1 - y0);
+
+                for (int channel = 0; channel < kAtlasChannels; ++channel)
+                {
+                    texel[channel] = static_cast<unsigned char>(sum[channel] / count);
+                }
+            }
+        }
+    }
+
+    static ProxyData BuildProxy(const std::vector<Model3dPtr>& models,
+        const std::vector<int>& modelIndices, const BoundingBox3f& bounds,
+        float error, const HlodSettings& settings)
+    {
+        ProxyData result;
+
+        const int tilesCount = static_cast<int>(modelIndices.size());
+        const int columns = std::max(1, static_cast<int>(std::ceil(std::sqrt(static_cast<float>(tilesCount)))));
+        const int rows = std::max(1, (tilesCount + columns - 1) / columns);
+
+        // Upper nodes cover many models, their tiles get smaller
+        const int tileSize = std::max(1, std::min(settings.m_tileSize,
+            settings.m_maxAtlasSize / columns));
+
+        result.m_atlasWidth = columns * tileSize;
+        result.m_atlasHeight = rows * tileSize;
+        result.m_diffuse.resize(static_cast<size_t>(result.m_atlasWidth) * result.m_atlasHeight * kAtlasChannels);
+        result.m_specular.resize(result.m_diffuse.size());
+        result.m_bounds = BoundingBox3f::kInvalid;
+
+        std::vector<Cluster> clusters;
+        std::unordered_map<uint64_t, int> clusterIndices;
+        std::vector<int> vertexClusters;
+
+        for (int tile = 0; tile < tilesCount; ++tile)
+        {
+            const Model3d& model = *models[modelIndices[tile]];
+            const int tileX = tile % columns;
+            const int tileY = tile / columns;
+
+            // Untextured models look like textured with white texture
+            BakeTile(GetTexture(model, false), 255, tileSize, tileX, tileY, result.m_atlasWidth, &result.m_diffuse);
+            BakeTile(GetTexture(model, true), 0, tileSize, tileX, tileY, result.m_atlasWidth, &result.m_specular);
+
+            const VertexBlob& vertices = *model.GetMeshData()->GetVertexData();
+            const ArrayView<const Vector3f> positions = vertices.GetFieldView<VertexBlobField::Pos>();
+            const ArrayView<const Vector3f> normals = vertices.GetFieldView<VertexBlobField::Norm>();
+            const ArrayView<const Vector2f> texCoords = vertices.GetFieldView<VertexBlobField::TexCoords>();
+
+            const glm::mat4& matrix = model.GetMatrix();
+            const glm::mat3& normalMatrix = model.GetNormalMatrix();
+
+            // Half texel inset keeps filtering inside the tile
+            const Vector2f tileOrigin(
+                (tileX * tileSize + 0.5f) / result.m_atlasWidth,
+                (tileY * tileSize + 0.5f) / result.m_atlasHeight);
+            const Vector2f tileScale(
+                (tileSize - 1) / static_cast<float>(result.m_atlasWidth),
+                (tileSize - 1) / static_cast<float>(result.m_atlasHeight));
+
+            vertexClusters.resize(static_cast<size_t>(vertices.Size()));
+
+            // Models are clustered separately, so every vertex stays in its tile
+            clusterIndices.clear();
+
+            for (int vertex = 0; vertex < vertices.Size(); ++vertex)
+            {
+                const Vector3f& local = positions[vertex];
+                const glm::vec4 world = matrix * glm::vec4(local.x(), local.y(), local.z(), 1.0f);
+                const Vector3f position(world.x, world.y, world.z);
+
+                uint64_t key = 0;
+
+                for (int axis = 0; axis < 3; ++axis)
+                {
+                    const int cell = static_cast<int>((position[axis] - bounds.min[axis]) / error);
+                    key = (key << 16) | static_cast<uint64_t>(std::min(std::max(cell, 0), kMaxCellIndex));
+                }
+
+                const auto inserted = clusterIndices.emplace(key, static_cast<int>(clusters.size()));
+
+                if (inserted.second)
+                {
+                    clusters.emplace_back();
+                }
+
+                Cluster& cluster = clusters[inserted.first->second];
+                cluster.m_position += position;
+                ++cluster.m_count;
+
+                if (!normals.empty())
+                {
+                    const Vector3f& n = normals[vertex];
+                    const glm::vec3 worldNormal = normalMatrix * glm::vec3(n.x(), n.y(), n.z());
+                    cluster.m_normal += Vector3f(worldNormal.x, worldNormal.y, worldNormal.z);
+                }
+
+                if (!texCoords.empty())
+                {
+                    const Vector2f& uv = texCoords[vertex];
+                    cluster.m_texCoords += Vector2f(
+                        tileOrigin.x() + tileScale.x() * std::min(std::max(uv.x(), 0.0f), 1.0f),
+                        tileOrigin.y() + tileScale.y() * std::min(std::max(uv.y(), 0.0f), 1.0f));
+                }
+                else
+                {
+                    cluster.m_texCoords += tileOrigin;
+                }
+
+                vertexClusters[vertex] = inserted.first->second;
+            }
+
+            // Triangles collapsed by clustering are dropped
+            const std::vector<int>& indices = model.GetMeshData()->GetIndexData()->GetData();
+
+            for (size_t index = 0; index + 2 < indices.size(); index += 3)
+            {
+                const int a = vertexClusters[indices[index]];
+                const int b = vertexClusters[indices[index + 1]];
+                const int c = vertexClusters[indices[index + 2]];
+
+                if (a != b && b != c && a != c)
+                {
+                    result.m_indices.push_back(a);
+                    result.m_indices.push_back(b);
+                    result.m_indices.push_back(c);
+                }
+            }
+        }
+
+        result.m_vertices = std::make_shared<VertexBlob>(
+            VertexBlobField::Pos | VertexBlobField::Norm | VertexBlobField::TexCoords,
+            static_cast<int>(clusters.size()));
+
+        ArrayView<Vector3f> positions = result.m_vertices->GetFieldView<VertexBlobField::Pos>();
+        ArrayView<Vector3f> normals = result.m_vertices->GetFieldView<VertexBlobField::Norm>();
+        ArrayView<Vector2f> texCoords = result.m_vertices->GetFieldView<VertexBlobField::TexCoords>();
+
+        for (size_t i = 0; i < clusters.size(); ++i)
+        {
+            const Cluster& cluster = clusters[i];
+            const float weight = 1.0f / cluster.m_count;
+            const int vertex = static_cast<int>(i);
+
+            positions[vertex] = cluster.m_position * weight;
+            texCoords[vertex] = cluster.m_texCoords * weight;
+
+            const float normalLength = cluster.m_normal.norm();
+            normals[vertex] = normalLength > 0.0f ? Vector3f(cluster.m_normal / normalLength) : Vector3f::Zero();
+
+            result.m_bounds += positions[vertex];
+        }
+
+        return result;
+    }
+}
+
+HlodTree::HlodTree(const std::vector<Model3dPtr>& models, const HlodSettings& settings)
+{
+    assert(settings.m_modelsPerLeaf > 0 && settings.m_childrenPerNode > 1);
+
+    if (models.empty())
+    {
+        return;
+    }
+
+    std::vector<BoundingBox3f> boxes(models.size());
+
+    for (size_t i = 0; i < models.size(); ++i)
+    {
+        boxes[i] = models[i]->GetBoundingBox();
+    }
+
+    // Neighbours along the curve are close in space, so groups are compact
+    const std::vector<int> order = ComputeSpatialOrder(boxes);
+    std::vector<int> level;
+
+    for (size_t first = 0; first < order.size(); first += static_cast<size_t>(settings.m_modelsPerLeaf))
+    {
+        const size_t last = std::min(order.size(), first + static_cast<size_t>(settings.m_modelsPerLeaf));
+
+        Node node;
+        node.m_bounds = BoundingBox3f::kInvalid;
+        node.m_models.assign(order.begin() + first, order.begin() + last);
+
+        for (int model : node.m_models)
+        {
+            if (boxes[model].IsValid())
+            {
+                node.m_bounds += boxes[model];
+            }
+        }
+
+        level.push_back(static_cast<int>(m_nodes.size()));
+        m_nodes.push_back(std::move(node));
+    }
+
+    // Children go before parents, so root is the last node
+    while (level.size() > 1)
+    {
+        std::vector<int> nextLevel;
+
+        for (size_t first = 0; first < level.size(); first += static_cast<size_t>(settings.m_childrenPerNode))
+        {
+            const size_t last = std::min(level.size(), first + static_cast<size_t>(settings.m_childrenPerNode));
+
+            Node node;
+            node.m_bounds = BoundingBox3f::kInvalid;
+            node.m_children.assign(level.begin() + first, level.begin() + last);
+
+            for (int child : node.m_children)
+            {
+                if (m_nodes[child].m_bounds.IsValid())
+                {
+                    node.m_bounds += m_nodes[child].m_bounds;
+                }
+            }
+
+            nextLevel.push_back(static_cast<int>(m_nodes.size()));
+            m_nodes.push_back(std::move(node));
+        }
+
+        level.swap(nextLevel);
+    }
+
+    for (Node& node : m_nodes)
+    {
+        const float size = node.m_bounds.IsValid() ? (node.m_bounds.max - node.m_bounds.min).norm() : 0.0f;
+        node.m_error = std::max(size * settings.m_errorFraction, 1.0e-4f);
+
+        for (int child : node.m_children)
+        {
+            node.m_error = std::max(node.m_error, 2.0f * m_nodes[child].m_error);
+        }
+    }
+
+    // Normal matrices are lazily computed, so do it before threads start
+    for (const Model3dPtr& model : models)
+    {
+        model->GetNormalMatrix();
+    }
+
+    std::vector<ProxyData> proxies(m_nodes.size());
+
+    ParallelFor(m_nodes.size(), 1, [&](size_t begin, size_t end)
+    {
+        std::vector<int> nodeModels;
+
+        for (size_t i = begin; i < end; ++i)
+        {
+            nodeModels.clear();
+            CollectModels(m_nodes, static_cast<int>(i), &nodeModels);
+
+            proxies[i] = BuildProxy(models, nodeModels, m_nodes[i].m_bounds,
+                m_nodes[i].m_error, settings);
+        }
+    });
+
+    const ShaderProgramPtr& shader = models.front()->GetMaterial()->GetShaderProgram();
+
+    for (size_t i = 0; i < m_nodes.size(); ++i)
+    {
+        ProxyData& proxy = proxies[i];
+
+        if (proxy.m_indices.empty())
+        {
+            continue;
+        }
+
+        Texture2dPtr diffuse = std::make_shared<Texture2D>(proxy.m_atlasWidth,
+            proxy.m_atlasHeight, kAtlasChannels, proxy.m_diffuse.data(), 0);
+        Texture2dPtr specular = std::make_shared<Texture2D>(proxy.m_atlasWidth,
+            proxy.m_atlasHeight, kAtlasChannels, proxy.m_specular.data(), 0);
+
+        for (const Texture2dPtr& texture : { diffuse, specular })
+        {
+            texture->SetWrapping(Texture2DAxis::S, TextureWrappingType::ClampToEdge);
+            texture->SetWrapping(Texture2DAxis::T, TextureWrappingType::ClampToEdge);
+        }
+
+        TexturedMaterialPtr material = std::make_shared<TexturedMaterial>(shader);
+        material->SetAmbient(diffuse);
+        material->SetDiffuse(diffuse);
+        material->SetSpecular(specular);
+
+        // Vertices are in world space already, matrix stays identity
+        m_nodes[i].m_proxy = std::make_shared<Model3d>(
+            std::make_shared<MeshData>(proxy.m_vertices,
+                std::make_shared<IndexBlob>(std::move(proxy.m_indices)), proxy.m_bounds),
+            material);
+    }
+}
+
+void HlodTree::Select(const Camera& camera, float screenHeight, float maxPixelError,
+    std::vector<int>* proxies, std::vector<int>* models) const
+{
+    assert(proxies != nullptr && models != nullptr);
+
+    proxies->clear();
+    models->clear();
+
+    if (m_nodes.empty())
+    {
+        return;
+    }
+
+    // Pixels covered by unit length at unit distance
+    const float errorScale = screenHeight /
+        (2.0f * std::tan(glm::radians(camera.GetFOV()) * 0.5f));
+
+    // Threshold is folded into the scale
+    SelectNode(GetRoot(), camera.GetFrustum(), camera.GetPosition(),
+        errorScale / maxPixelError, proxies, models);
+}
+
+void HlodTree::SelectNode(int node, const Frustum& frustum, const glm::vec3& position,
+    float errorScale, std::vector<int>* proxies, std::vector<int>* models) const
+{
+    const Node& current = m_nodes[node];
+
+    if (!current.m_bounds.IsValid() || !frustum.Intersects(current.m_bounds))
+    {
+        return;
+    }
+
+    // Distance from camera to the closest point of the node
+    float distanceSquared = 0.0f;
+
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        const float outside = std::max(std::max(
+            current.m_bounds.min[axis] - position[axis],
+            position[axis] - current.m_bounds.max[axis]), 0.0f);
+
+        distanceSquared += outside * outside;
+    }
+
+    const float error = current.m_error * errorScale;
+
+    if (distanceSquared > 0.0f && error * error <= distanceSquared)
+    {
+        // Whole group collapsed into nothing
+        if (current.m_proxy != nullptr)
+        {
+            proxies->push_back(node);
+        }
+
+        return;
+    }
+
+    models->insert(models->end(), current.m_models.begin(), current.m_models.end());
+
+    for (int child : current.m_children)
+    {
+        SelectNode(child, frustum, position, errorScale, proxies, models);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <vector>
+
+#include "Base/Geom/BoundingBox.h"
+#include "Render/Camera.h"
+#include "Scene/Model3d.h"
+#include "Scene/Materials/TexturedMaterial.h"
+
+struct HlodSettings
+{
+    HlodSettings() :
+        m_modelsPerLeaf(16),
+        m_childrenPerNode(4),
+        m_errorFraction(0.02f),
+        m_tileSize(32),
+        m_maxAtlasSize(2048)
+    {}
+
+    // Source models merged by the lowest level proxy
+    int m_modelsPerLeaf;
+    int m_childrenPerNode;
+    /* Vertices are clustered in cells of this fraction of node size, at
+     * least twice as big as cells of children
+     */
+    float m_errorFraction;
+    // Texels per source model in proxy atlas side
+    int m_tileSize;
+    // Tiles are shrunk to keep atlas side below this
+    int m_maxAtlasSize;
+};
+
+/* Hierarchy of proxies for groups of static models. Models are ordered
+ * along Hilbert curve and split into leaf groups, groups are merged
+ * further up to single root. Every node gets one proxy model:
+ *  - meshes of all models below the node are moved to world space and
+ *    simplified by vertex clustering, cell size is the node error;
+ *  - diffuse and specular textures of every model are shrunk into
+ *    a tile of the node atlas and texture coordinates are remapped.
+ * Proxy is drawn instead of the whole group when its error projected
+ * on screen is small enough, so far away parts of scene cost one draw
+ * per node.
+ */
+class HlodTree
+{
+public:
+    struct Node
+    {
+        BoundingBox3f m_bounds;
+        // World space size of clustering cell
+        float m_error;
+        Model3dPtr m_proxy;
+        // Empty for leaves
+        std::vector<int> m_children;
+        // Source models of leaf
+        std::vector<int> m_models;
+    };
+
+    /* Models must use TexturedMaterial or have no textures at all, proxies
+     * use shader of the first model. Meshes and atlases are built on all
+     * cores, GL objects are created on calling thread.
+     */
+    explicit HlodTree(const std::vector<Model3dPtr>& models,
+        const HlodSettings& settings = HlodSettings());
+
+    HlodTree(const HlodTree&) = delete;
+
+    const std::vector<Node>& GetNodes() const { return m_nodes; }
+
+    // Negative for empty tree
+    int GetRoot() const { return static_cast<int>(m_nodes.size()) - 1; }
+
+    /* Finds the coarsest nodes whose error is below maxPixelError on screen
+     * of given height. Outputs proxies to draw and source models of leaves
+     * which are still too close. Nodes outside of camera frustum are skipped.
+     */
+    void Select(const Camera& camera, float screenHeight, float maxPixelError,
+        std::vector<int>* proxies, std::vector<int>* models) const;
+
+private:
+    void SelectNode(int node, const Frustum& frustum, const glm::vec3& position,
+        float errorScale, std::vector<int>* proxies, std::vector<int>* models) const;
+
+    std::vector<Node> m_nodes;
+};
\ No newline at end of file
@@ -0,0 +1,149 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#include "Scene/Impostor.h"
+#include "Render/CameraUniformBlock.h"
+
+// GLM
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace
+{
+    static glm::vec2 SignNotZero(const glm::vec2& v)
+    {
+        return glm::vec2(v.x >= 0.0f ? 1.0f : -1.0f, v.y >= 0.0f ? 1.0f : -1.0f);
+    }
+
+    // Folds lower hemisphere over diamond edges, the same operation unfolds it
+    static glm::vec2 Fold(const glm::vec2& p)
+    {
+        return glm::vec2(1.0f - std::abs(p.y), 1.0f - std::abs(p.x)) * SignNotZero(p);
+    }
+}
+
+namespace XImpostor {
+
+    glm::vec2 EncodeDirection(const glm::vec3& direction)
+    {
+        const glm::vec3 d = direction /
+            (std::abs(direction.x) + std::abs(direction.y) + std::abs(direction.z));
+
+        glm::vec2 p(d.x, d.z);
+
+        if (d.y < 0.0f)
+        {
+            p = Fold(p);
+        }
+
+        return p * 0.5f + 0.5f;
+    }
+
+    glm::vec3 DecodeDirection(const glm::vec2& coords)
+    {
+        glm::vec2 p = coords * 2.0f - 1.0f;
+        const float y = 1.0f - std::abs(p.x) - std::abs(p.y);
+
+        if (y < 0.0f)
+        {
+            p = Fold(p);
+        }
+
+        return glm::normalize(glm::vec3(p.x, y, p.y));
+    }
+
+    glm::vec3 GetViewUp(const glm::vec3& direction)
+    {
+        return std::abs(direction.y) > 0.99f ?
+            glm::vec3(0.0f, 0.0f, -1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    }
+
+    float GetMaxScale(const glm::mat4& matrix)
+    {
+        return std::sqrt(std::max(std::max(
+            glm::dot(glm::vec3(matrix[0]), glm::vec3(matrix[0])),
+            glm::dot(glm::vec3(matrix[1]), glm::vec3(matrix[1]))),
+            glm::dot(glm::vec3(matrix[2]), glm::vec3(matrix[2]))));
+    }
+
+}
+
+Impostor::Impostor(const Model3d& model, const ImpostorSettings& settings) :
+    m_framesPerSide(settings.m_framesPerSide),
+    m_center(0.0f),
+    m_radius(0.0f)
+{
+    assert(settings.m_framesPerSide > 0 && settings.m_frameSize > 0);
+
+    const BoundingBox3f& bounds = model.GetMeshData()->GetBoundingBox();
+
+    if (bounds.IsValid())
+    {
+        const Vector3f center = bounds.GetCenter();
+        m_center = glm::vec3(center.x(), center.y(), center.z());
+        m_radius = (bounds.max - bounds.min).norm() * 0.5f;
+    }
+
+    const int atlasSize = m_framesPerSide * settings.m_frameSize;
+    m_atlas = std::make_shared<FrameBufferObject>(atlasSize, atlasSize);
+
+    // Capture must not change state seen by the rest of the frame
+    GLint viewport[4];
+    GLfloat clearColor[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    glGetFloatv(GL_COLOR_CLEAR_VALUE, clearColor);
+
+    m_atlas->Bind();
+
+    // Zero alpha marks pixels not covered by the model
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    // Views of the atlas go through own camera block, frame camera is restored after
+    GLint frameCameraBuffer = 0;
+    glGetIntegeri_v(GL_UNIFORM_BUFFER_BINDING,
+        static_cast<GLuint>(UniformBlockBinding::Camera), &frameCameraBuffer);
+
+    CameraUniformBlock cameraBlock;
+    cameraBlock.Bind();
+
+    const glm::mat4& matrix = model.GetMatrix();
+    const glm::mat3 linear(matrix);
+    const glm::vec3 worldCenter(matrix * glm::vec4(m_center, 1.0f));
+    const float worldRadius = std::max(m_radius * XImpostor::GetMaxScale(matrix), 1.0e-4f);
+
+    // Camera is outside of bounding sphere, depth range covers it
+    const glm::mat4 projection = glm::ortho(-worldRadius, worldRadius,
+        -worldRadius, worldRadius, worldRadius, 3.0f * worldRadius);
+
+    for (int y = 0; y < m_framesPerSide; ++y)
+    {
+        for (int x = 0; x < m_framesPerSide; ++x)
+        {
+            const glm::vec3 direction = XImpostor::DecodeDirection(glm::vec2(
+                (x + 0.5f) / m_framesPerSide, (y + 0.5f) / m_framesPerSide));
+
+            const glm::vec3 worldDirection = glm::normalize(linear * direction);
+            const glm::vec3 worldUp = glm::normalize(linear * XImpostor::GetViewUp(direction));
+            const glm::vec3 eye = worldCenter + worldDirection * (2.0f * worldRadius);
+
+            const glm::mat4 view = glm::lookAt(eye, worldCenter, worldUp);
+
+            cameraBlock.Update(view, projection, eye);
+
+            glViewport(x * settings.m_frameSize, y * settings.m_frameSize,
+                settings.m_frameSize, settings.m_frameSize);
+
+            model.Draw();
+        }
+    }
+
+    glBindBufferBase(GL_UNIFORM_BUFFER, static_cast<GLuint>(UniformBlockBinding::Camera),
+        static_cast<GLuint>(frameCameraBuffer));
+
+    FrameBufferObject::UnbindAny();
+    m_atlas->GenerateMipmaps();
+
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    glClearColor(clearColor[0], clearColor[1], clearColor[2], clearColor[3]);
+}
\ No newline at end of file
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <memory>
+
+#include "Render/FrameBufferObject.h"
+#include "Scene/Model3d.h"
+
+// GLM
+#include <glm/glm.hpp>
+
+struct ImpostorSettings
+{
+    ImpostorSettings() :
+        m_framesPerSide(8),
+        m_frameSize(64)
+    {}
+
+    // Atlas has framesPerSide x framesPerSide views
+    int m_framesPerSide;
+    // Pixels per view side
+    int m_frameSize;
+};
+
+namespace XImpostor {
+
+    /* Octahedral mapping of unit direction to [0, 1] square,
+     * upper hemisphere (y > 0) goes to the inner diamond
+     */
+    glm::vec2 EncodeDirection(const glm::vec3& direction);
+    glm::vec3 DecodeDirection(const glm::vec2& coords);
+
+    // Up vector of the view looking along -direction, same for capture and draw
+    glm::vec3 GetViewUp(const glm::vec3& direction);
+
+    // Longest axis of matrix, scales model space radius to world space
+    float GetMaxScale(const glm::mat4& matrix);
+
+}
+
+/* Views of a model captured from directions spread over the sphere and
+ * stored in octahedral atlas. Directions are in model space, so the
+ * impostor fits all models with the same mesh and material, models
+ * should be scaled uniformly. Lighting at capture time is baked in.
+ */
+class Impostor
+{
+public:
+    /* Draws the model into offscreen buffer with its own material, so
+     * lights must be prepared. Must be called with GL context.
+     */
+    explicit Impostor(const Model3d& model,
+        const ImpostorSettings& settings = ImpostorSettings());
+
+    Impostor(const Impostor&) = delete;
+
+    int GetFramesPerSide() const { return m_framesPerSide; }
+    GLuint GetAtlas() const { return m_atlas->GetColorTexture(); }
+
+    // Bounding sphere in model space
+    const glm::vec3& GetCenter() const { return m_center; }
+    float GetRadius() const { return m_radius; }
+
+private:
+    int m_framesPerSide;
+    glm::vec3 m_center;
+    float m_radius;
+    FrameBufferObjectPtr m_atlas;
+};
+
+using ImpostorPtr = std::shared_ptr<Impostor>;
\ No newline at end of file
@@ -0,0 +1,170 @@
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+
+#include "Render/GLState.h"
+#include "Scene/ImpostorRenderer.h"
+
+// GLM
+#include <glm/gtc/type_ptr.hpp>
+
+ImpostorRenderer::ImpostorRenderer(const ShaderProgramPtr& shader) :
+    m_shader(shader),
+    m_quadsCapacity(0)
+{
+    assert(m_shader != nullptr);
+
+    m_viewProjectionLoc = m_shader->GetUniformLocation("viewProjection");
+    m_atlasLoc = m_shader->GetUniformLocation("atlas");
+    m_framesPerSideLoc = m_shader->GetUniformLocation("framesPerSide");
+
+    glGenVertexArrays(1, &m_VAO);
+    glGenBuffers(1, &m_VBO);
+    glGenBuffers(1, &m_EBO);
+
+    XGLState::BindVertexArray(m_VAO);
+    XGLState::BindBuffer(GL_ARRAY_BUFFER, m_VBO);
+
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(QuadVertex),
+        (GLvoid*)(offsetof(QuadVertex, m_position)));
+    glEnableVertexAttribArray(0);
+
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(QuadVertex),
+        (GLvoid*)(offsetof(QuadVertex, m_viewDirection)));
+    glEnableVertexAttribArray(1);
+
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(QuadVertex),
+        (GLvoid*)(offsetof(QuadVertex, m_corner)));
+    glEnableVertexAttribArray(2);
+
+    // Element buffer binding is stored in vertex array
+    XGLState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
+
+    XGLState::BindVertexArray(0);
+    XGLState::BindBuffer(GL_ARRAY_BUFFER, 0);
+    XGLState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+ImpostorRenderer::~ImpostorRenderer()
+{
+    XGLState::DeleteBuffers(1, &m_EBO);
+    XGLState::DeleteBuffers(1, &m_VBO);
+    XGLState::DeleteVertexArrays(1, &m_VAO);
+}
+
+int ImpostorRenderer::Draw(const Impostor& impostor, const Camera& camera,
+    const std::vector<Model3dPtr>& models, const std::vector<int>& candidates,
+    float minDistance)
+{
+    m_vertices.clear();
+
+    const glm::vec3& cameraPosition = camera.GetPosition();
+
+    for (int modelIndex : candidates)
+    {
+        const Model3d& model = *models[modelIndex];
+        const glm::mat4& matrix = model.GetMatrix();
+
+        const glm::vec3 center(matrix * glm::vec4(impostor.GetCenter(), 1.0f));
+        const glm::vec3 toCamera = cameraPosition - center;
+        const float distance = glm::length(toCamera);
+
+        if (distance < minDistance || !(distance > 0.0f))
+        {
+            model.Draw();
+            continue;
+        }
+
+        // Inverse of linear part is transposed normal matrix
+        const glm::vec3 viewDirection = glm::normalize(
+            glm::transpose(model.GetNormalMatrix()) * toCamera);
+
+        // Basis of glm::lookAt used for capture
+        const glm::vec3 front = -toCamera / distance;
+        const glm::vec3 up = glm::mat3(matrix) * XImpostor::GetViewUp(viewDirection);
+        const glm::vec3 right = glm::normalize(glm::cross(front, up));
+        const float radius = impostor.GetRadius() * XImpostor::GetMaxScale(matrix);
+
+        const glm::vec3 axisX = right * radius;
+        const glm::vec3 axisY = glm::cross(right, front) * radius;
+
+        for (int corner = 0; corner < 4; ++corner)
+        {
+            const glm::vec2 cornerCoords(
+                static_cast<float>(corner & 1), static_cast<float>(corner >> 1));
+
+            QuadVertex vertex;
+            vertex.m_position = center +
+                axisX * (2.0f * cornerCoords.x - 1.0f) +
+                axisY * (2.0f * cornerCoords.y - 1.0f);
+            vertex.m_viewDirection = viewDirection;
+            vertex.m_corner = cornerCoords;
+
+            m_vertices.push_back(vertex);
+        }
+    }
+
+    const size_t quadsCount = m_vertices.size() / 4;
+
+    if (quadsCount == 0)
+    {
+        return 0;
+    }
+
+    ReserveQuads(quadsCount);
+
+    // Orphaning lets driver keep the previous frame data in flight
+    XGLState::BindBuffer(GL_ARRAY_BUFFER, m_VBO);
+    glBufferData(GL_ARRAY_BUFFER, m_quadsCapacity * 4 * sizeof(QuadVertex), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, m_vertices.size() * sizeof(QuadVertex), m_vertices.data());
+    XGLState::BindBuffer(GL_ARRAY_BUFFER, 0);
+
+    const glm::mat4 viewProjection = camera.GetProjection() * camera.GetViewMatrix();
+
+    m_shader->Use();
+    glUniformMatrix4fv(m_viewProjectionLoc, 1, GL_FALSE, glm::value_ptr(viewProjection));
+    glUniform1f(m_framesPerSideLoc, static_cast<float>(impostor.GetFramesPerSide()));
+    glUniform1i(m_atlasLoc, 0);
+
+    XGLState::ActiveTexture(GL_TEXTURE0);
+    XGLState::BindTexture(GL_TEXTURE_2D, impostor.GetAtlas());
+
+    XGLState::BindVertexArray(m_VAO);
+    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(quadsCount * 6), GL_UNSIGNED_INT, 0);
+    XGLState::BindVertexArray(0);
+
+    XGLState::BindTexture(GL_TEXTURE_2D, 0);
+
+    return static_cast<int>(quadsCount);
+}
+
+void ImpostorRenderer::ReserveQuads(size_t count)
+{
+    if (count <= m_quadsCapacity)
+    {
+        return;
+    }
+
+    m_quadsCapacity = std::max(count, m_quadsCapacity * 2);
+
+    // Two triangles per quad, corners go in x then y order
+    std::vector<unsigned int> indices(m_quadsCapacity * 6);
+
+    for (size_t quad = 0; quad < m_quadsCapacity; ++quad)
+    {
+        const unsigned int first = static_cast<unsigned int>(quad * 4);
+        unsigned int* quadIndices = &indices[quad * 6];
+
+        quadIndices[0] = first;
+        quadIndices[1] = first + 1;
+        quadIndices[2] = first + 2;
+        quadIndices[3] = first + 2;
+        quadIndices[4] = first + 1;
+        quadIndices[5] = first + 3;
+    }
+
+    XGLState::BindVertexArray(m_VAO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int),
+        indices.data(), GL_STATIC_DRAW);
+    XGLState::BindVertexArray(0);
+}
\ No newline at end of file
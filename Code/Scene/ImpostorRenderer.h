@@ -0,0 +1,54 @@
+#pragma once
+
+#include <vector>
+
+#include "Render/Camera.h"
+#include "Render/Shaders/ShaderProgram.h"
+#include "Scene/Impostor.h"
+
+/* Draws far models as camera facing quads textured with impostor views.
+ * Quads of all far models go to one stream buffer and are drawn with
+ * single call, four vertices per model. Quad is oriented the same way
+ * as the capture view, so views blended in shader line up.
+ */
+class ImpostorRenderer
+{
+public:
+    /* Shader takes position, model space view direction and quad corner
+     * at locations 0, 1 and 2 and has "viewProjection", "atlas" and
+     * "framesPerSide" uniforms
+     */
+    explicit ImpostorRenderer(const ShaderProgramPtr& shader);
+    ~ImpostorRenderer();
+
+    ImpostorRenderer(const ImpostorRenderer&) = delete;
+
+    /* Models[candidates] closer than minDistance are drawn as usual,
+     * the others as impostors. Returns number of impostors drawn.
+     */
+    int Draw(const Impostor& impostor, const Camera& camera,
+        const std::vector<Model3dPtr>& models, const std::vector<int>& candidates,
+        float minDistance);
+
+private:
+    struct QuadVertex
+    {
+        glm::vec3 m_position;
+        glm::vec3 m_viewDirection;
+        glm::vec2 m_corner;
+    };
+
+    void ReserveQuads(size_t count);
+
+    ShaderProgramPtr m_shader;
+    GLuint m_viewProjectionLoc;
+    GLuint m_atlasLoc;
+    GLuint m_framesPerSideLoc;
+
+    GLuint m_VAO;
+    GLuint m_VBO;
+    GLuint m_EBO;
+    size_t m_quadsCapacity;
+
+    std::vector<QuadVertex> m_vertices;
+};
\ No newline at end of file
@@ -0,0 +1,252 @@
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
+#include "Render/GLState.h"
+#include "Scene/IndirectRenderer.h"
+
+namespace
+{
+    template<typename T>
+    static void UploadStream(GLenum target, GLuint buffer, const std::vector<T>& data, size_t* capacity)
+    {
+        const size_t dataSize = data.size() * sizeof(T);
+
+        XGLState::BindBuffer(target, buffer);
+
+        // Buffer is orphaned every frame, so GPU may still read the previous one
+        if (dataSize > *capacity)
+        {
+            *capacity = dataSize * 2;
+        }
+
+        glBufferData(target, *capacity, nullptr, GL_STREAM_DRAW);
+        glBufferSubData(target, 0, dataSize, data.data());
+        XGLState::BindBuffer(target, 0);
+    }
+}
+
+IndirectRenderer::IndirectRenderer() :
+    m_commandsCapacity(0),
+    m_instancesCapacity(0)
+{
+    m_multiDrawIndirect = GLEW_ARB_multi_draw_indirect && GLEW_ARB_base_instance;
+
+    glGenBuffers(1, &m_commandsBuffer);
+    glGenBuffers(1, &m_instancesBuffer);
+}
+
+IndirectRenderer::~IndirectRenderer()
+{
+    ReleasePools();
+
+    XGLState::DeleteBuffers(1, &m_instancesBuffer);
+    XGLState::DeleteBuffers(1, &m_commandsBuffer);
+}
+
+void IndirectRenderer::SetModels(const std::vector<Model3dPtr>& models)
+{
+    ReleasePools();
+    m_batches.clear();
+    m_models = models;
+    m_modelBatches.resize(m_models.size());
+
+    for (size_t i = 0; i < m_models.size(); ++i)
+    {
+        const Model3d& model = *m_models[i];
+        const int pool = GetPool(model.GetMeshBuffer()->GetPool());
+
+        auto batch = std::find_if(m_batches.begin(), m_batches.end(), [&](const Batch& b)
+        {
+            return b.m_pool == pool && b.m_material == model.GetMaterial();
+        });
+
+        if (batch == m_batches.end())
+        {
+            const ShaderProgramPtr& shader = model.GetMaterial()->GetShaderProgram();
+
+            Batch newBatch;
+            newBatch.m_pool = pool;
+            newBatch.m_material = model.GetMaterial();
+            newBatch.m_instancedUniform = shader->TryGetUniform<int>("instanced");
+            newBatch.m_modelUniform = shader->TryGetUniform<glm::mat4>("model");
+            newBatch.m_normalMatrixUniform = shader->TryGetUniform<glm::mat3>("normalMatrix");
+            newBatch.m_firstCommand = 0;
+
+            m_batches.push_back(std::move(newBatch));
+            batch = m_batches.end() - 1;
+        }
+
+        m_modelBatches[i] = static_cast<int>(batch - m_batches.begin());
+    }
+}
+
+int IndirectRenderer::GetPool(const MeshBufferPoolPtr& pool)
+{
+    for (size_t i = 0; i < m_pools.size(); ++i)
+    {
+        if (m_pools[i].m_pool == pool)
+        {
+            return static_cast<int>(i);
+        }
+    }
+
+    // Instance attributes of all pools read the same buffer
+    Pool newPool;
+    newPool.m_pool = pool;
+    glGenVertexArrays(1, &newPool.m_VAO);
+
+    XGLState::BindVertexArray(newPool.m_VAO);
+    pool->SetupAttributes();
+
+    // Buffer gets no storage without multi draw, enabled arrays would be read out of it
+    if (m_multiDrawIndirect)
+    {
+        XGLState::BindBuffer(GL_ARRAY_BUFFER, m_instancesBuffer);
+        XInstanceData::SetupAttributes();
+    }
+
+    XGLState::BindVertexArray(0);
+    XGLState::BindBuffer(GL_ARRAY_BUFFER, 0);
+
+    m_pools.push_back(newPool);
+
+    return static_cast<int>(m_pools.size() - 1);
+}
+
+void IndirectRenderer::ReleasePools()
+{
+    for (const Pool& pool : m_pools)
+    {
+        XGLState::DeleteVertexArrays(1, &pool.m_VAO);
+    }
+
+    m_pools.clear();
+}
+
+void IndirectRenderer::Draw()
+{
+    for (size_t i = 0; i < m_models.size(); ++i)
+    {
+        Add(static_cast<int>(i));
+    }
+
+    Submit();
+}
+
+void IndirectRenderer::Draw(const std::vector<int>& indices)
+{
+    for (int index : indices)
+    {
+        Add(index);
+    }
+
+    Submit();
+}
+
+void IndirectRenderer::Add(int modelIndex)
+{
+    const Model3d& model = *m_models[modelIndex];
+    const MeshBuffer& mesh = *model.GetMeshBuffer();
+    Batch& batch = m_batches[m_modelBatches[modelIndex]];
+
+    // Offsets are read every frame, pools may move meshes
+    DrawCommand command;
+    command.m_count = static_cast<GLuint>(mesh.GetIndicesCount());
+    command.m_instanceCount = 1;
+    command.m_firstIndex = static_cast<GLuint>(mesh.GetFirstIndex());
+    command.m_baseVertex = mesh.GetBaseVertex();
+    command.m_baseInstance = 0;
+
+    InstanceData instance;
+    instance.m_model = model.GetMatrix();
+    instance.m_normalMatrix = model.GetNormalMatrix();
+
+    batch.m_commands.push_back(command);
+    batch.m_instances.push_back(instance);
+}
+
+void IndirectRenderer::Submit()
+{
+    m_stats = IndirectRendererStats();
+    m_commands.clear();
+    m_instances.clear();
+
+    // Commands of a batch are contiguous, base instance points to own matrices
+    for (Batch& batch : m_batches)
+    {
+        batch.m_firstCommand = m_commands.size();
+
+        for (size_t i = 0; i < batch.m_commands.size(); ++i)
+        {
+            DrawCommand command = batch.m_commands[i];
+            command.m_baseInstance = static_cast<GLuint>(m_instances.size());
+
+            m_commands.push_back(command);
+            m_instances.push_back(batch.m_instances[i]);
+        }
+    }
+
+    if (m_commands.empty())
+    {
+        return;
+    }
+
+    if (m_multiDrawIndirect)
+    {
+        UploadStream(GL_DRAW_INDIRECT_BUFFER, m_commandsBuffer, m_commands, &m_commandsCapacity);
+        UploadStream(GL_ARRAY_BUFFER, m_instancesBuffer, m_instances, &m_instancesCapacity);
+    }
+
+    for (Batch& batch : m_batches)
+    {
+        if (batch.m_commands.empty())
+        {
+            continue;
+        }
+
+        m_stats.m_commands += static_cast<int>(batch.m_commands.size());
+
+        batch.m_material->GetShaderProgram()->Use();
+        batch.m_material->PrepareContext();
+        m_pools[batch.m_pool].m_pool->Sync();
+        XGLState::BindVertexArray(m_pools[batch.m_pool].m_VAO);
+
+        if (m_multiDrawIndirect && batch.m_instancedUniform.IsValid())
+        {
+            batch.m_instancedUniform.Set(1);
+
+            XGLState::BindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandsBuffer);
+            glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+                (GLvoid*)(batch.m_firstCommand * sizeof(DrawCommand)),
+                static_cast<GLsizei>(batch.m_commands.size()), 0);
+            XGLState::BindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+            batch.m_instancedUniform.Set(0);
+            ++m_stats.m_submits;
+        }
+        else
+        {
+            SubmitOneByOne(batch);
+        }
+
+        batch.m_commands.clear();
+        batch.m_instances.clear();
+    }
+}
+
+void IndirectRenderer::SubmitOneByOne(const Batch& batch)
+{
+    for (size_t i = 0; i < batch.m_commands.size(); ++i)
+    {
+        const DrawCommand& command = batch.m_commands[i];
+
+        batch.m_modelUniform.Set(batch.m_instances[i].m_model);
+        batch.m_normalMatrixUniform.Set(batch.m_instances[i].m_normalMatrix);
+
+        glDrawElementsBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(command.m_count),
+            GL_UNSIGNED_INT, (GLvoid*)(command.m_firstIndex * sizeof(int)), command.m_baseVertex);
+
+        ++m_stats.m_submits;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "Scene/InstancedRenderer.h"
+#include "Scene/Model3d.h"
+
+struct IndirectRendererStats
+{
+    IndirectRendererStats() :
+        m_commands(0),
+        m_submits(0)
+    {}
+
+    // Visible models, every one is a draw command
+    int m_commands;
+    // glMultiDrawElementsIndirect calls, or draw calls without it
+    int m_submits;
+};
+
+/* Draws models from pooled mesh buffers. Every frame commands of
+ * visible models are written into GL_DRAW_INDIRECT_BUFFER and every
+ * pool and material pair goes out with one glMultiDrawElementsIndirect.
+ *
+ * Command index is passed as base instance, so per instance attributes
+ * of the draw (InstanceData, like InstancedRenderer) hold its matrices.
+ * Without ARB_multi_draw_indirect and ARB_base_instance commands are
+ * issued one by one with "model" and "normalMatrix" uniforms, instance
+ * attributes stay disabled then.
+ */
+class IndirectRenderer
+{
+public:
+    IndirectRenderer();
+    ~IndirectRenderer();
+
+    IndirectRenderer(const IndirectRenderer&) = delete;
+
+    // Draw takes indices in this array
+    void SetModels(const std::vector<Model3dPtr>& models);
+
+    void Draw();
+    void Draw(const std::vector<int>& indices);
+
+    // Of the last Draw call
+    const IndirectRendererStats& GetStats() const { return m_stats; }
+
+private:
+    // Layout is defined by GL
+    struct DrawCommand
+    {
+        GLuint m_count;
+        GLuint m_instanceCount;
+        GLuint m_firstIndex;
+        GLint m_baseVertex;
+        GLuint m_baseInstance;
+    };
+
+    static_assert(sizeof(DrawCommand) == 20, "DrawCommand must match GL layout");
+
+    // Models of one pool with one material
+    struct Batch
+    {
+        int m_pool;
+        IMaterialPtr m_material;
+        ShaderUniform<int> m_instancedUniform;
+        ShaderUniform<glm::mat4> m_modelUniform;
+        ShaderUniform<glm::mat3> m_normalMatrixUniform;
+
+        std::vector<DrawCommand> m_commands;
+        std::vector<InstanceData> m_instances;
+        size_t m_firstCommand;
+    };
+
+    // VAO of pool buffers and instance buffer of the renderer
+    struct Pool
+    {
+        MeshBufferPoolPtr m_pool;
+        GLuint m_VAO;
+    };
+
+    int GetPool(const MeshBufferPoolPtr& pool);
+    void Add(int modelIndex);
+    void Submit();
+    void SubmitOneByOne(const Batch& batch);
+
+    void ReleasePools();
+
+    bool m_multiDrawIndirect;
+
+    std::vector<Pool> m_pools;
+    std::vector<Batch> m_batches;
+    std::vector<Model3dPtr> m_models;
+    // Batch of every model
+    std::vector<int> m_modelBatches;
+
+    GLuint m_commandsBuffer;
+    GLuint m_instancesBuffer;
+    size_t m_commandsCapacity;
+    size_t m_instancesCapacity;
+
+    std::vector<DrawCommand> m_commands;
+    std::vector<InstanceData> m_instances;
+    IndirectRendererStats m_stats;
+};
+
+using IndirectRendererPtr = std::shared_ptr<IndirectRenderer>;
\ No newline at end of file
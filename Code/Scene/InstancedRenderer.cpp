@@ -0,0 +1,295 @@
+#include <cassert>
+#include <functional>
+
+#include "Render/GLState.h"
+#include "Render/VertexFormat.h"
+#include "Scene/InstancedRenderer.h"
+
+namespace
+{
+    // Locations of per instance attributes, mat4 and mat3 take a location per column
+    static const GLuint kModelLocation = 5;
+    static const GLuint kNormalMatrixLocation = 9;
+
+    // Draw calls without models after which group is released
+    static const int kMaxUnusedDraws = 16;
+}
+
+namespace XInstanceData {
+
+    void SetupAttributes()
+    {
+        const GLsizei stride = sizeof(InstanceData);
+
+        for (GLuint column = 0; column < 4; ++column)
+        {
+            const size_t offset = column * sizeof(glm::vec4);
+            glVertexAttribPointer(kModelLocation + column, 4, GL_FLOAT, GL_FALSE, stride, (GLvoid*)offset);
+            glVertexAttribDivisor(kModelLocation + column, 1);
+            glEnableVertexAttribArray(kModelLocation + column);
+        }
+
+        for (GLuint column = 0; column < 3; ++column)
+        {
+            const size_t offset = sizeof(glm::mat4) + column * sizeof(glm::vec3);
+            glVertexAttribPointer(kNormalMatrixLocation + column, 3, GL_FLOAT, GL_FALSE, stride, (GLvoid*)offset);
+            glVertexAttribDivisor(kNormalMatrixLocation + column, 1);
+            glEnableVertexAttribArray(kNormalMatrixLocation + column);
+        }
+    }
+
+    void SetupFormat()
+    {
+        const GLuint binding = static_cast<GLuint>(VertexBufferBinding::Instances);
+
+        for (GLuint column = 0; column < 4; ++column)
+        {
+            const GLuint offset = static_cast<GLuint>(column * sizeof(glm::vec4));
+            glVertexAttribFormat(kModelLocation + column, 4, GL_FLOAT, GL_FALSE, offset);
+            glVertexAttribBinding(kModelLocation + column, binding);
+            glEnableVertexAttribArray(kModelLocation + column);
+        }
+
+        for (GLuint column = 0; column < 3; ++column)
+        {
+            const GLuint offset = static_cast<GLuint>(sizeof(glm::mat4) + column * sizeof(glm::vec3));
+            glVertexAttribFormat(kNormalMatrixLocation + column, 3, GL_FLOAT, GL_FALSE, offset);
+            glVertexAttribBinding(kNormalMatrixLocation + column, binding);
+            glEnableVertexAttribArray(kNormalMatrixLocation + column);
+        }
+
+        glVertexBindingDivisor(binding, 1);
+    }
+
+}
+
+size_t InstancedRenderer::GroupKeyHash::operator() (const GroupKey& key) const
+{
+    const size_t mesh = std::hash<const void*>()(key.m_mesh);
+    const size_t material = std::hash<const void*>()(key.m_material);
+    return mesh ^ (material + 0x9e3779b9 + (mesh << 6) + (mesh >> 2));
+}
+
+InstancedRenderer::InstancedRenderer() :
+    m_separateFormat(XVertexFormat::IsSeparateFormatSupported())
+{
+}
+
+InstancedRenderer::~InstancedRenderer()
+{
+    for (auto& item : m_groups)
+    {
+        ReleaseGroup(item.second);
+    }
+}
+
+void InstancedRenderer::Draw(const std::vector<Model3dPtr>& models)
+{
+    for (const Model3dPtr& model : models)
+    {
+        Add(*model);
+    }
+
+    DrawGroups();
+}
+
+void InstancedRenderer::Draw(const std::vector<Model3dPtr>& models, const std::vector<int>& indices)
+{
+    for (int index : indices)
+    {
+        Add(*models[index]);
+    }
+
+    DrawGroups();
+}
+
+void InstancedRenderer::DrawGroups()
+{
+    m_stats = InstancedRendererStats();
+
+    for (auto it = m_groups.begin(); it != m_groups.end();)
+    {
+        Group& group = it->second;
+
+        if (!group.m_models.empty())
+        {
+            group.m_unusedDraws = 0;
+            DrawGroup(group);
+        }
+        else if (++group.m_unusedDraws > kMaxUnusedDraws)
+        {
+            ReleaseGroup(group);
+            it = m_groups.erase(it);
+            continue;
+        }
+
+        ++it;
+    }
+}
+
+void InstancedRenderer::Add(const Model3d& model)
+{
+    const GroupKey key{ model.GetMeshBuffer().get(), model.GetMaterial().get() };
+    Group& group = m_groups[key];
+
+    if (group.m_mesh == nullptr)
+    {
+        InitGroup(model, &group);
+    }
+
+    InstanceData instance;
+    instance.m_model = model.GetMatrix();
+    instance.m_normalMatrix = model.GetNormalMatrix();
+
+    group.m_models.push_back(&model);
+    group.m_instances.push_back(instance);
+}
+
+void InstancedRenderer::InitGroup(const Model3d& model, Group* group)
+{
+    group->m_mesh = model.GetMeshBuffer();
+    group->m_material = model.GetMaterial();
+    group->m_instancedUniform =
+        group->m_material->GetShaderProgram()->TryGetUniform<int>("instanced");
+
+    if (!group->m_instancedUniform.IsValid())
+    {
+        return;
+    }
+
+    glGenBuffers(1, &group->m_instanceBuffer);
+
+    if (m_separateFormat)
+    {
+        group->m_VAO = AcquirePoolVertexArray(group->m_mesh->GetPool());
+        return;
+    }
+
+    // Own VAO, so VAO of the pool is not changed by instance attributes
+    glGenVertexArrays(1, &group->m_VAO);
+    XGLState::BindVertexArray(group->m_VAO);
+    group->m_mesh->GetPool()->SetupAttributes();
+
+    XGLState::BindBuffer(GL_ARRAY_BUFFER, group->m_instanceBuffer);
+
+    XInstanceData::SetupAttributes();
+
+    XGLState::BindVertexArray(0);
+    XGLState::BindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void InstancedRenderer::DrawGroup(Group& group)
+{
+    if (group.m_instances.empty())
+    {
+        return;
+    }
+
+    if (!group.m_instancedUniform.IsValid())
+    {
+        for (const Model3d* model : group.m_models)
+        {
+            model->Draw();
+        }
+
+        m_stats.m_drawCalls += static_cast<int>(group.m_models.size());
+        m_stats.m_instances += static_cast<int>(group.m_models.size());
+
+        group.m_models.clear();
+        group.m_instances.clear();
+        return;
+    }
+
+    const size_t dataSize = group.m_instances.size() * sizeof(InstanceData);
+
+    XGLState::BindBuffer(GL_ARRAY_BUFFER, group.m_instanceBuffer);
+
+    // Buffer is orphaned every frame, so GPU may still read the previous one
+    if (dataSize > group.m_capacity)
+    {
+        group.m_capacity = dataSize * 2;
+    }
+
+    glBufferData(GL_ARRAY_BUFFER, group.m_capacity, nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, dataSize, group.m_instances.data());
+    XGLState::BindBuffer(GL_ARRAY_BUFFER, 0);
+
+    group.m_material->GetShaderProgram()->Use();
+    group.m_material->PrepareContext();
+    group.m_instancedUniform.Set(1);
+
+    // Mesh may be moved by pool defragmentation, offsets are read on every draw
+    const size_t firstIndex = static_cast<size_t>(group.m_mesh->GetFirstIndex());
+
+    group.m_mesh->GetPool()->Sync();
+    XGLState::BindVertexArray(group.m_VAO);
+
+    if (m_separateFormat)
+    {
+        glBindVertexBuffer(static_cast<GLuint>(VertexBufferBinding::Instances),
+            group.m_instanceBuffer, 0, sizeof(InstanceData));
+    }
+
+    glDrawElementsInstancedBaseVertex(GL_TRIANGLES,
+        static_cast<GLsizei>(group.m_mesh->GetIndicesCount()),
+        GL_UNSIGNED_INT, (GLvoid*)(firstIndex * sizeof(int)),
+        static_cast<GLsizei>(group.m_instances.size()), group.m_mesh->GetBaseVertex());
+
+    group.m_instancedUniform.Set(0);
+
+    ++m_stats.m_drawCalls;
+    m_stats.m_instances += static_cast<int>(group.m_instances.size());
+
+    group.m_models.clear();
+    group.m_instances.clear();
+}
+
+void InstancedRenderer::ReleaseGroup(Group& group)
+{
+    // Groups drawn per model have no GL objects
+    if (!group.m_instancedUniform.IsValid())
+    {
+        return;
+    }
+
+    XGLState::DeleteBuffers(1, &group.m_instanceBuffer);
+
+    if (m_separateFormat)
+    {
+        ReleasePoolVertexArray(group.m_mesh->GetPool().get());
+    }
+    else
+    {
+        XGLState::DeleteVertexArrays(1, &group.m_VAO);
+    }
+}
+
+GLuint InstancedRenderer::AcquirePoolVertexArray(const MeshBufferPoolPtr& pool)
+{
+    PoolVertexArray& vertexArray = m_poolVertexArrays[pool.get()];
+
+    if (vertexArray.m_VAO == 0)
+    {
+        glGenVertexArrays(1, &vertexArray.m_VAO);
+        XGLState::BindVertexArray(vertexArray.m_VAO);
+        pool->SetupAttributes();
+        XInstanceData::SetupFormat();
+        XGLState::BindVertexArray(0);
+    }
+
+    ++vertexArray.m_groupsCount;
+
+    return vertexArray.m_VAO;
+}
+
+void InstancedRenderer::ReleasePoolVertexArray(const MeshBufferPool* pool)
+{
+    auto it = m_poolVertexArrays.find(pool);
+    assert(it != m_poolVertexArrays.end());
+
+    if (--it->second.m_groupsCount == 0)
+    {
+        XGLState::DeleteVertexArrays(1, &it->second.m_VAO);
+        m_poolVertexArrays.erase(it);
+    }
+}
\ No newline at end of file
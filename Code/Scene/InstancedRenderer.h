@@ -0,0 +1,139 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "Scene/Model3d.h"
+
+// Per instance attributes read by VS.glsl, matrices are read by columns
+struct InstanceData
+{
+    glm::mat4 m_model;
+    glm::mat3 m_normalMatrix;
+};
+
+static_assert(sizeof(InstanceData) == 100, "InstanceData must be tightly packed");
+
+namespace XInstanceData {
+
+    /* Describes InstanceData array of buffer bound to GL_ARRAY_BUFFER
+     * in currently bound VAO, at locations 5-8 and 9-11
+     */
+    void SetupAttributes();
+
+    /* Describes InstanceData array read from Instances binding in
+     * currently bound VAO, for VAOs with separate attribute format
+     */
+    void SetupFormat();
+
+}
+
+struct InstancedRendererStats
+{
+    InstancedRendererStats() :
+        m_drawCalls(0),
+        m_instances(0)
+    {}
+
+    int m_drawCalls;
+    int m_instances;
+};
+
+/* Draws models sharing mesh and material with one glDrawElementsInstanced
+ * per group. Model and normal matrices are written into per instance
+ * attributes 5-8 and 9-11, shader picks them instead of "model" and
+ * "normalMatrix" uniforms while "instanced" uniform is set, like VS.glsl
+ * does. Shaders without "instanced" uniform get a draw per model.
+ * Groups are kept between calls and released with their buffers after
+ * several Draw calls without models, so meshes and materials gone from
+ * the scene are not held.
+ */
+class InstancedRenderer
+{
+public:
+    InstancedRenderer();
+    ~InstancedRenderer();
+
+    InstancedRenderer(const InstancedRenderer&) = delete;
+
+    void Draw(const std::vector<Model3dPtr>& models);
+
+    // Draws models[indices], e.g. frustum culling result
+    void Draw(const std::vector<Model3dPtr>& models, const std::vector<int>& indices);
+
+    // Of the last Draw call
+    const InstancedRendererStats& GetStats() const { return m_stats; }
+
+private:
+    struct GroupKey
+    {
+        const MeshBuffer* m_mesh;
+        const IMaterial* m_material;
+
+        bool operator== (const GroupKey& other) const
+        {
+            return m_mesh == other.m_mesh && m_material == other.m_material;
+        }
+    };
+
+    struct GroupKeyHash
+    {
+        size_t operator() (const GroupKey& key) const;
+    };
+
+    /* VAO reads pool buffers of the mesh and instance buffer of the group.
+     * With separate attribute format groups of one pool share VAO and
+     * instance buffer is attached before draw.
+     */
+    struct Group
+    {
+        Group() :
+            m_VAO(0),
+            m_instanceBuffer(0),
+            m_capacity(0),
+            m_unusedDraws(0)
+        {}
+
+        GLuint m_VAO;
+        GLuint m_instanceBuffer;
+        size_t m_capacity;
+        // Draw calls in a row without models of the group
+        int m_unusedDraws;
+        MeshBufferPtr m_mesh;
+        IMaterialPtr m_material;
+        ShaderUniform<int> m_instancedUniform;
+        std::vector<const Model3d*> m_models;
+        std::vector<InstanceData> m_instances;
+    };
+
+    void Add(const Model3d& model);
+    void DrawGroups();
+    void InitGroup(const Model3d& model, Group* group);
+    void DrawGroup(Group& group);
+    void ReleaseGroup(Group& group);
+    GLuint AcquirePoolVertexArray(const MeshBufferPoolPtr& pool);
+    void ReleasePoolVertexArray(const MeshBufferPool* pool);
+
+    struct PoolVertexArray
+    {
+        PoolVertexArray() :
+            m_VAO(0),
+            m_groupsCount(0)
+        {}
+
+        GLuint m_VAO;
+        int m_groupsCount;
+    };
+
+    std::unordered_map<GroupKey, Group, GroupKeyHash> m_groups;
+    /* Groups using VAO keep its pool alive, so pool address is not reused.
+     * VAO is deleted along with the last of them.
+     */
+    std::unordered_map<const MeshBufferPool*, PoolVertexArray> m_poolVertexArrays;
+    bool m_separateFormat;
+    InstancedRendererStats m_stats;
+};
+
+using InstancedRendererPtr = std::shared_ptr<InstancedRenderer>;
\ No newline at end of file
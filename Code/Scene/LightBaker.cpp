@@ -0,0 +1,331 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+
+#include "Base/ParallelFor.h"
+#include "Base/Geom/TriangleBVH.h"
+#include "Scene/LightBaker.h"
+
+namespace
+{
+    const size_t kMinVerticesPerThread = 256;
+
+    // Model vertices moved to world space
+    struct WorldMesh
+    {
+        std::vector<Vector3f> m_positions;
+        std::vector<Vector3f> m_normals;
+    };
+
+    static Vector3f Transform(const glm::mat4& matrix, const Vector3f& v, float w)
+    {
+        const glm::vec4 result = matrix * glm::vec4(v.x(), v.y(), v.z(), w);
+        return Vector3f(result.x, result.y, result.z);
+    }
+
+    static float RadicalInverse(uint32_t bits)
+    {
+        bits = (bits << 16) | (bits >> 16);
+        bits = ((bits & 0x55555555u) << 1) | ((bits & 0xAAAAAAAAu) >> 1);
+        bits = ((bits & 0x33333333u) << 2) | ((bits & 0xCCCCCCCCu) >> 2);
+        bits = ((bits & 0x0F0F0F0Fu) << 4) | ((bits & 0xF0F0F0F0u) >> 4);
+        bits = ((bits & 0x00FF00FFu) << 8) | ((bits & 0xFF00FF00u) >> 8);
+        return static_cast<float>(bits) * 2.3283064365386963e-10f;
+    }
+
+    // Per vertex pseudo random value to decorrelate sample patterns
+    static float HashToUnit(uint32_t value)
+    {
+        value ^= value >> 16;
+        value *= 0x7feb352du;
+        value ^= value >> 15;
+        value *= 0x846ca68bu;
+        value ^= value >> 16;
+        return static_cast<float>(value >> 8) * (1.0f / 16777216.0f);
+    }
+
+    // Orthonormal basis around unit vector n (Duff et al.)
+    static void BuildBasis(const Vector3f& n, Vector3f* tangent, Vector3f* bitangent)
+    {
+        const float sign = n.z() >= 0.0f ? 1.0f : -1.0f;
+        const float a = -1.0f / (sign + n.z());
+        const float b = n.x() * n.y() * a;
+
+        *tangent = Vector3f(1.0f + sign * n.x() * n.x() * a, sign * b, -sign * n.x());
+        *bitangent = Vector3f(b, sign + n.y() * n.y() * a, -n.y());
+    }
+
+    static float ComputeOcclusion(const TriangleBVH& bvh, const Vector3f& origin,
+        const Vector3f& normal, uint32_t seed, const LightBakeSettings& settings)
+    {
+        if (settings.m_occlusionSamples <= 0 || settings.m_occlusionDistance <= 0.0f)
+        {
+            return 1.0f;
+        }
+
+        Vector3f tangent;
+        Vector3f bitangent;
+        BuildBasis(normal, &tangent, &bitangent);
+
+        // Hammersley set shifted by random offset per vertex
+        const float shiftU = HashToUnit(seed);
+        const float shiftV = HashToUnit(seed ^ 0x9e3779b9u);
+        const float invSamples = 1.0f / settings.m_occlusionSamples;
+
+        int visible = 0;
+
+        for (int sample = 0; sample < settings.m_occlusionSamples; ++sample)
+        {
+            float u = (sample + 0.5f) * invSamples + shiftU;
+            float v = RadicalInverse(static_cast<uint32_t>(sample)) + shiftV;
+            u -= std::floor(u);
+            v -= std::floor(v);
+
+            // Cosine weighted direction in hemisphere
+            const float radius = std::sqrt(u);
+            const float angle = 6.28318530718f * v;
+            const Vector3f direction =
+                tangent * (radius * std::cos(angle)) +
+                bitangent * (radius * std::sin(angle)) +
+                normal * std::sqrt(std::max(0.0f, 1.0f - u));
+
+            if (!bvh.IsOccluded(Ray(origin, direction), settings.m_occlusionDistance))
+            {
+                ++visible;
+            }
+        }
+
+        return visible * invSamples;
+    }
+
+    class LightEvaluator
+    {
+    public:
+        LightEvaluator(const TriangleBVH& bvh, const LightsArray& lights,
+            const LightBakeSettings& settings) :
+            m_bvh(bvh),
+            m_lights(lights),
+            m_settings(settings)
+        {
+            // Directional lights are infinitely far, scene size is enough
+            const BoundingBox3f& bounds = bvh.GetBoundingBox();
+            m_sceneSize = bounds.IsValid() ? (bounds.max - bounds.min).norm() : 0.0f;
+        }
+
+        Vector3f Compute(const Vector3f& position, const Vector3f& normal,
+            bool hasNormal, float occlusion) const
+        {
+            const Vector3f origin = position + normal * m_settings.m_bias;
+            Vector3f result = Vector3f::Zero();
+
+            for (const auto& light : m_lights.GetPointLights())
+            {
+                const Vector3f toLight = light->GetPosition() - position;
+                const float distance = toLight.norm();
+                const Attenuation& attenuation = light->GetAttenuation();
+
+                const float factor = 1.0f / (
+                    attenuation.GetConstantRate() +
+                    attenuation.GetLinearRate() * distance +
+                    attenuation.GetQuadraticRate() * distance * distance);
+
+                result += light->GetAmbient() * (factor * occlusion);
+
+                if (distance > 0.0f)
+                {
+                    const Vector3f direction = toLight / distance;
+
+                    result += light->GetDiffuse() * (factor *
+                        GetDiffuseFactor(origin, normal, hasNormal, direction, distance));
+                }
+            }
+
+            for (const auto& light : m_lights.GetDirectionalLights())
+            {
+                const Vector3f direction = -light->GetDirection().normalized();
+
+                result += light->GetAmbient() * occlusion;
+                result += light->GetDiffuse() *
+                    GetDiffuseFactor(origin, normal, hasNormal, direction, m_sceneSize);
+            }
+
+            for (const auto& light : m_lights.GetSpotLights())
+            {
+                const Vector3f toLight = light->GetPosition() - position;
+                const float distance = toLight.norm();
+
+                if (!(distance > 0.0f))
+                {
+                    continue;
+                }
+
+                const Vector3f direction = toLight / distance;
+
+                // Same cone falloff as in the fragment shader
+                const float cosAngle = direction.dot(light->GetDirection().normalized());
+
+                if (cosAngle < light->GetOuterAngleCos())
+                {
+                    continue;
+                }
+
+                const float range = light->GetInnerAngleCos() - light->GetOuterAngleCos();
+                const float portion = range > 0.0f ?
+                    std::min(1.0f, (cosAngle - light->GetOuterAngleCos()) / range) : 1.0f;
+
+                result += light->GetAmbient() * (portion * occlusion);
+                result += light->GetDiffuse() * (portion *
+                    GetDiffuseFactor(origin, normal, hasNormal, direction, distance));
+            }
+
+            return result;
+        }
+
+    private:
+        float GetDiffuseFactor(const Vector3f& origin, const Vector3f& normal, bool hasNormal,
+            const Vector3f& direction, float distance) const
+        {
+            const float factor = hasNormal ? std::max(0.0f, normal.dot(direction)) : 1.0f;
+
+            if (factor <= 0.0f || !m_settings.m_shadows)
+            {
+                return factor;
+            }
+
+            const float rayLength = distance - m_settings.m_bias;
+
+            if (rayLength > 0.0f && m_bvh.IsOccluded(Ray(origin, direction), rayLength))
+            {
+                return 0.0f;
+            }
+
+            return factor;
+        }
+
+        const TriangleBVH& m_bvh;
+        const LightsArray& m_lights;
+        const LightBakeSettings& m_settings;
+        float m_sceneSize;
+    };
+}
+
+std::vector<Model3dPtr> BakeVertexLighting(
+    const std::vector<Model3dPtr>& models,
+    const LightsArray& lights,
+    const LightBakeSettings& settings)
+{
+    std::vector<WorldMesh> worldMeshes(models.size());
+    std::vector<size_t> vertexOffsets(models.size() + 1, 0);
+
+    std::vector<Vector3f> scenePositions;
+    std::vector<int> sceneIndices;
+
+    for (size_t i = 0; i < models.size(); ++i)
+    {
+        const Model3d& model = *models[i];
+        const VertexBlob& vertices = *model.GetMeshData()->GetVertexData();
+        const std::vector<int>& indices = model.GetMeshData()->GetIndexData()->GetData();
+
+        const ArrayView<const Vector3f> positions = vertices.GetFieldView<VertexBlobField::Pos>();
+        const ArrayView<const Vector3f> normals = vertices.GetFieldView<VertexBlobField::Norm>();
+
+        const glm::mat4& matrix = model.GetMatrix();
+        const glm::mat4 normalMatrix(model.GetNormalMatrix());
+
+        WorldMesh& worldMesh = worldMeshes[i];
+        worldMesh.m_positions.resize(static_cast<size_t>(vertices.Size()));
+
+        for (int vertex = 0; vertex < vertices.Size(); ++vertex)
+        {
+            worldMesh.m_positions[vertex] = Transform(matrix, positions[vertex], 1.0f);
+        }
+
+        if (!normals.empty())
+        {
+            worldMesh.m_normals.resize(static_cast<size_t>(vertices.Size()));
+
+            for (int vertex = 0; vertex < vertices.Size(); ++vertex)
+            {
+                worldMesh.m_normals[vertex] = Transform(normalMatrix, normals[vertex], 0.0f).normalized();
+            }
+        }
+
+        const int baseVertex = static_cast<int>(scenePositions.size());
+        scenePositions.insert(scenePositions.end(),
+            worldMesh.m_positions.begin(), worldMesh.m_positions.end());
+
+        for (int index : indices)
+        {
+            sceneIndices.push_back(baseVertex + index);
+        }
+
+        vertexOffsets[i + 1] = vertexOffsets[i] + static_cast<size_t>(vertices.Size());
+    }
+
+    const TriangleBVH bvh(ArrayView<const Vector3f>(scenePositions.data(),
+        static_cast<int>(scenePositions.size())), sceneIndices);
+
+    const LightEvaluator evaluator(bvh, lights, settings);
+
+    std::vector<VertexBlobPtr> bakedBlobs(models.size());
+
+    for (size_t i = 0; i < models.size(); ++i)
+    {
+        const VertexBlob& source = *models[i]->GetMeshData()->GetVertexData();
+        bakedBlobs[i] = std::make_shared<VertexBlob>(
+            source.GetFields() | VertexBlobField::BakedLight, source.Size());
+    }
+
+    // Vertices of all models in one range, so big meshes don't stall single thread
+    ParallelFor(vertexOffsets.back(), kMinVerticesPerThread, [&](size_t begin, size_t end)
+    {
+        size_t model = static_cast<size_t>(std::upper_bound(
+            vertexOffsets.begin(), vertexOffsets.end(), begin) - vertexOffsets.begin()) - 1;
+
+        for (size_t sceneVertex = begin; sceneVertex < end; ++sceneVertex)
+        {
+            while (sceneVertex >= vertexOffsets[model + 1])
+            {
+                ++model;
+            }
+
+            const int vertex = static_cast<int>(sceneVertex - vertexOffsets[model]);
+            const WorldMesh& worldMesh = worldMeshes[model];
+            VertexBlob& baked = *bakedBlobs[model];
+
+            baked.CopyPoint(vertex, *models[model]->GetMeshData()->GetVertexData(), vertex);
+
+            const Vector3f& position = worldMesh.m_positions[vertex];
+            const bool hasNormal = !worldMesh.m_normals.empty();
+            const Vector3f normal = hasNormal ? worldMesh.m_normals[vertex] : Vector3f::Zero();
+
+            const float occlusion = hasNormal ? ComputeOcclusion(bvh,
+                position + normal * settings.m_bias, normal,
+                static_cast<uint32_t>(sceneVertex), settings) : 1.0f;
+
+            const Vector3f irradiance = evaluator.Compute(position, normal, hasNormal, occlusion);
+
+            baked.GetFieldView<VertexBlobField::BakedLight>()[vertex] =
+                Vector4f(irradiance.x(), irradiance.y(), irradiance.z(), occlusion);
+        }
+    });
+
+    std::vector<Model3dPtr> result;
+    result.reserve(models.size());
+
+    for (size_t i = 0; i < models.size(); ++i)
+    {
+        const MeshDataPtr& meshData = models[i]->GetMeshData();
+
+        Model3dPtr model = std::make_shared<Model3d>(
+            std::make_shared<MeshData>(bakedBlobs[i], meshData->GetIndexData(),
+                meshData->GetBoundingBox()),
+            models[i]->GetMaterial());
+
+        model->SetMatrix(models[i]->GetMatrix());
+        result.push_back(model);
+    }
+
+    return result;
+}
\ No newline at end of file
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <vector>
+
+#include "Scene/Model3d.h"
+#include "Scene/Lights/LightsArray.h"
+
+struct LightBakeSettings
+{
+    LightBakeSettings() :
+        m_occlusionSamples(64),
+        m_occlusionDistance(1.0f),
+        m_shadows(true),
+        m_bias(1.0e-3f)
+    {}
+
+    // Rays per vertex for ambient occlusion, zero disables it
+    int m_occlusionSamples;
+    // Geometry farther than this does not occlude
+    float m_occlusionDistance;
+    // Trace rays from every vertex to every light
+    bool m_shadows;
+    // Offset of ray origins along vertex normal to avoid self intersections
+    float m_bias;
+};
+
+/* Bakes ambient occlusion and diffuse lighting from static lights into
+ * VertexBlobField::BakedLight. All models are occluders for each other.
+ * Specular term stays view dependent and is not baked.
+ * Returns new models in the same order, with the same materials and
+ * matrices. Every model gets own mesh because baked data depends on
+ * placement. Vertices are processed on all cores.
+ */
+std::vector<Model3dPtr> BakeVertexLighting(
+    const std::vector<Model3dPtr>& models,
+    const LightsArray& lights,
+    const LightBakeSettings& settings = LightBakeSettings());
\ No newline at end of file
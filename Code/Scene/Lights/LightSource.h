@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <memory>
 #include "Base/Geom/Vector.h"
 
@@ -13,9 +14,12 @@ public:
     const Vector3f& GetDiffuse() const { return m_diffuse; }
     const Vector3f& GetSpecular() const { return m_specular; }
 
-    void SetAmbient(const Vector3f& value) { m_ambient = value; }
-    void SetDiffuse(const Vector3f& value) { m_diffuse = value; }
-    void SetSpecular(const Vector3f& value) { m_specular = value; }
+    void SetAmbient(const Vector3f& value) { m_ambient = value; MarkChanged(); }
+    void SetDiffuse(const Vector3f& value) { m_diffuse = value; MarkChanged(); }
+    void SetSpecular(const Vector3f& value) { m_specular = value; MarkChanged(); }
+
+    // Incremented by every setter, lets uniform data be uploaded only on change
+    uint32_t GetRevision() const { return m_revision; }
 
 protected:
     explicit LightSource(const Vector3f& ambient,
@@ -23,8 +27,11 @@ protected:
     LightSource(const LightSource&) = default;
     LightSource& operator= (const LightSource&) = default;
 
+    void MarkChanged() { ++m_revision; }
+
 private:
     Vector3f m_ambient;
     Vector3f m_diffuse;
     Vector3f m_specular;
+    uint32_t m_revision;
 };
\ No newline at end of file
@@ -1,76 +1,69 @@
+#include <cassert>
+#include <cstring>
+
 #include "Scene/Lights/LightsArray.h"
 
 namespace
 {
-    static void PrepareColorContext(std::string& prefix,
-        const ShaderProgramPtr& shader,
-        const LightSource* light)
-    {
-        assert(light != nullptr && shader != nullptr);
-
-        const size_t prevSize = prefix.size();
-
-        prefix += "color.";
-        const size_t colorConstSize = prefix.size();
-
-        prefix.resize(colorConstSize);
-        prefix += "ambient";
-        glUniform3f(
-            shader->GetUniformLocation(prefix.c_str()),
-            light->GetAmbient().x(),
-            light->GetAmbient().y(),
-            light->GetAmbient().z());
-
-        prefix.resize(colorConstSize);
-        prefix += "diffuse";
-        glUniform3f(
-            shader->GetUniformLocation(prefix.c_str()),
-            light->GetDiffuse().x(),
-            light->GetDiffuse().y(),
-            light->GetDiffuse().z());
-
-        prefix.resize(colorConstSize);
-        prefix += "specular";
-        glUniform3f(
-            shader->GetUniformLocation(prefix.c_str()),
-            light->GetSpecular().x(),
-            light->GetSpecular().y(),
-            light->GetSpecular().z());
-
-        prefix.resize(prevSize);
-    }
-
-    static void PrepareAttenuationContext(std::string prefix,
-        const ShaderProgramPtr& shader,
-        const Attenuation& attenuation)
+    // std140 layouts of Lights block members, vec3 takes 16 bytes
+    struct ColorData
     {
-        assert(shader != nullptr);
-
-        const size_t prevSize = prefix.size();
-
-        prefix += "attenuation.";
-
-        const size_t constSize = prefix.size();
+        float m_ambient[4];
+        float m_diffuse[4];
+        float m_specular[4];
+    };
 
-        prefix.resize(constSize);
-        prefix += "constant";
-        glUniform1f(
-            shader->GetUniformLocation(prefix.c_str()),
-            attenuation.GetConstantRate());
+    struct CountsData
+    {
+        int m_pointLightsCount;
+        int m_directionalLightsCount;
+        int m_spotLightsCount;
+        int m_padding;
+    };
 
-        prefix.resize(constSize);
-        prefix += "linear";
-        glUniform1f(
-            shader->GetUniformLocation(prefix.c_str()),
-            attenuation.GetLinearRate());
+    struct PointLightData
+    {
+        float m_position[4];
+        float m_constant;
+        float m_linear;
+        float m_quadratic;
+        float m_padding;
+        ColorData m_color;
+    };
+
+    struct DirectionalLightData
+    {
+        float m_direction[4];
+        ColorData m_color;
+    };
 
-        prefix.resize(constSize);
-        prefix += "quadratic";
-        glUniform1f(
-            shader->GetUniformLocation(prefix.c_str()),
-            attenuation.GetQuadraticRate());
+    struct SpotLightData
+    {
+        float m_direction[4];
+        float m_position[3];
+        float m_cosInnerAngle;
+        float m_cosOuterAngle;
+        float m_padding[3];
+        ColorData m_color;
+    };
+
+    static_assert(sizeof(CountsData) == 16, "CountsData must match std140 layout");
+    static_assert(sizeof(PointLightData) == 80, "PointLightData must match std140 layout");
+    static_assert(sizeof(DirectionalLightData) == 64, "DirectionalLightData must match std140 layout");
+    static_assert(sizeof(SpotLightData) == 96, "SpotLightData must match std140 layout");
+
+    static void WriteVector(const Vector3f& v, float* result)
+    {
+        result[0] = v.x();
+        result[1] = v.y();
+        result[2] = v.z();
+    }
 
-        prefix.resize(prevSize);
+    static void WriteColor(const LightSource& light, ColorData* color)
+    {
+        WriteVector(light.GetAmbient(), color->m_ambient);
+        WriteVector(light.GetDiffuse(), color->m_diffuse);
+        WriteVector(light.GetSpecular(), color->m_specular);
     }
 }
 
@@ -79,7 +72,8 @@ LightsArray::LightsArray(
     std::vector<DirectionalLightPtr> directionalLights,
     std::vector<SpotLightPtr> spotLights,
     const char* VS, const char* FS,
-    std::ostream* logstream) :
+    std::ostream* logstream,
+    bool bakedLighting) :
     m_pointLights(std::move(pointLights)),
     m_directionalLights(std::move(directionalLights)),
     m_spotLights(std::move(spotLights))
@@ -115,112 +109,129 @@ LightsArray::LightsArray(
     additionalCode += std::to_string(m_spotLightsCapacity);
     additionalCode += "\r\n";
 
+    // Models baked with BakeVertexLighting, static lights may be removed from array
+    if (bakedLighting)
+    {
+        additionalCode += "#define BAKED_LIGHTING\r\n";
+    }
+
     VertexShaderPtr vertexShader = std::make_shared<VertexShader>(VS, nullptr, logstream);
     FragmentShaderPtr texturedMatFS = std::make_shared<FragmentShader>(FS, additionalCode.c_str(), logstream);
     m_shader = std::make_shared<ShaderProgram>(vertexShader, texturedMatFS, logstream);
+
+    // Arrays follow counts in the order of declaration in the block
+    const size_t dataSize = sizeof(CountsData) +
+        m_pointLightsCapacity * sizeof(PointLightData) +
+        m_directionalLightsCapacity * sizeof(DirectionalLightData) +
+        m_spotLightsCapacity * sizeof(SpotLightData);
+
+    const ShaderUniformBlockInfo* block = m_shader->FindUniformBlock("Lights");
+    assert(block == nullptr || static_cast<size_t>(block->m_dataSize) == dataSize);
+    (void)block;
+
+    m_uniformBuffer = std::make_shared<UniformBuffer>(dataSize);
+    m_uniformData.resize(dataSize, 0);
+
+    UploadLights();
 }
 
-void LightsArray::PrepareContext()
+void LightsArray::CollectLights(std::vector<UploadedLight>* lights) const
 {
-    m_shader->Use();
+    lights->clear();
 
-    glUniform1i(m_shader->GetUniformLocation("pointLightsCount"),
-        static_cast<int>(m_pointLights.size()));
+    // Lights of different kinds are different objects, so equal lists mean equal counts
+    for (const PointLightPtr& light : m_pointLights)
+    {
+        lights->push_back(UploadedLight{ light.get(), light->GetRevision() });
+    }
 
-    for (size_t i = 0; i < m_pointLights.size(); ++i)
+    for (const DirectionalLightPtr& light : m_directionalLights)
     {
-        const auto& pointLight = m_pointLights[i];
+        lights->push_back(UploadedLight{ light.get(), light->GetRevision() });
+    }
 
-        m_cachedUniformName = "pointLights[";
-        m_cachedUniformName += std::to_string(i);
-        m_cachedUniformName += "].";
+    for (const SpotLightPtr& light : m_spotLights)
+    {
+        lights->push_back(UploadedLight{ light.get(), light->GetRevision() });
+    }
+}
 
-        const size_t constSize = m_cachedUniformName.size();
+void LightsArray::UploadLights()
+{
+    uint8_t* data = m_uniformData.data();
 
-        m_cachedUniformName += "position";
-        glUniform3f(
-            m_shader->GetUniformLocation(m_cachedUniformName.c_str()),
-            pointLight->GetPosition().x(),
-            pointLight->GetPosition().y(),
-            pointLight->GetPosition().z());
+    CountsData counts;
+    counts.m_pointLightsCount = static_cast<int>(m_pointLights.size());
+    counts.m_directionalLightsCount = static_cast<int>(m_directionalLights.size());
+    counts.m_spotLightsCount = static_cast<int>(m_spotLights.size());
+    counts.m_padding = 0;
+    memcpy(data, &counts, sizeof(CountsData));
 
-        m_cachedUniformName.resize(constSize);
-        PrepareAttenuationContext(m_cachedUniformName, m_shader, pointLight->GetAttenuation());
-        PrepareColorContext(m_cachedUniformName, m_shader, pointLight.get());
+    PointLightData* pointLights = reinterpret_cast<PointLightData*>(data + sizeof(CountsData));
+
+    for (size_t i = 0; i < m_pointLights.size(); ++i)
+    {
+        const PointLight& pointLight = *m_pointLights[i];
+        PointLightData& lightData = pointLights[i];
+
+        WriteVector(pointLight.GetPosition(), lightData.m_position);
+        lightData.m_constant = pointLight.GetAttenuation().GetConstantRate();
+        lightData.m_linear = pointLight.GetAttenuation().GetLinearRate();
+        lightData.m_quadratic = pointLight.GetAttenuation().GetQuadraticRate();
+        WriteColor(pointLight, &lightData.m_color);
     }
 
-    glUniform1i(m_shader->GetUniformLocation("directionalLightsCount"),
-        static_cast<int>(m_directionalLights.size()));
+    DirectionalLightData* directionalLights =
+        reinterpret_cast<DirectionalLightData*>(pointLights + m_pointLightsCapacity);
 
     for (size_t i = 0; i < m_directionalLights.size(); ++i)
     {
-        const auto& directionalLight = m_directionalLights[i];
+        const DirectionalLight& directionalLight = *m_directionalLights[i];
+        DirectionalLightData& lightData = directionalLights[i];
+
+        WriteVector(directionalLight.GetDirection(), lightData.m_direction);
+        WriteColor(directionalLight, &lightData.m_color);
+    }
+
+    SpotLightData* spotLights =
+        reinterpret_cast<SpotLightData*>(directionalLights + m_directionalLightsCapacity);
+
+    for (size_t i = 0; i < m_spotLights.size(); ++i)
+    {
+        const SpotLight& spotLight = *m_spotLights[i];
+        SpotLightData& lightData = spotLights[i];
+
+        WriteVector(spotLight.GetDirection(), lightData.m_direction);
+        WriteVector(spotLight.GetPosition(), lightData.m_position);
+        lightData.m_cosInnerAngle = spotLight.GetInnerAngleCos();
+        lightData.m_cosOuterAngle = spotLight.GetOuterAngleCos();
+        WriteColor(spotLight, &lightData.m_color);
+    }
 
-        m_cachedUniformName = "directionalLights[";
-        m_cachedUniformName += std::to_string(i);
-        m_cachedUniformName += "].";
+    m_uniformBuffer->Upload(m_uniformData.data(), m_uniformData.size());
 
-        const size_t constSize = m_cachedUniformName.size();
+    CollectLights(&m_uploadedLights);
+}
 
-        m_cachedUniformName += "direction";
-        glUniform3f(
-            m_shader->GetUniformLocation(m_cachedUniformName.c_str()),
-            directionalLight->GetDirection().x(),
-            directionalLight->GetDirection().y(),
-            directionalLight->GetDirection().z());
+void LightsArray::PrepareContext()
+{
+    CollectLights(&m_currentLights);
 
-        m_cachedUniformName.resize(constSize);
+    bool changed = m_currentLights.size() != m_uploadedLights.size();
 
-        PrepareColorContext(m_cachedUniformName, m_shader, directionalLight.get());
+    for (size_t i = 0; !changed && i < m_currentLights.size(); ++i)
+    {
+        changed =
+            m_currentLights[i].m_light != m_uploadedLights[i].m_light ||
+            m_currentLights[i].m_revision != m_uploadedLights[i].m_revision;
     }
 
-    glUniform1i(m_shader->GetUniformLocation("spotLightsCount"),
-        static_cast<int>(m_spotLights.size()));
-
-    for (size_t i = 0; i < m_spotLights.size(); ++i)
+    if (changed)
     {
-        const auto& spotLight = m_spotLights[i];
-
-        m_cachedUniformName = "spotLights[";
-        m_cachedUniformName += std::to_string(i);
-        m_cachedUniformName += "].";
-
-        const size_t constSize = m_cachedUniformName.size();
-
-        m_cachedUniformName.resize(constSize);
-        m_cachedUniformName += "cosInnerAngle";
-        glUniform1f(
-            m_shader->GetUniformLocation(m_cachedUniformName.c_str()),
-            spotLight->GetInnerAngleCos());
-
-        m_cachedUniformName.resize(constSize);
-        m_cachedUniformName += "cosOuterAngle";
-        glUniform1f(
-            m_shader->GetUniformLocation(m_cachedUniformName.c_str()),
-            spotLight->GetOuterAngleCos());
-
-        m_cachedUniformName.resize(constSize);
-        m_cachedUniformName += "direction";
-        glUniform3f(
-            m_shader->GetUniformLocation(m_cachedUniformName.c_str()),
-            spotLight->GetDirection().x(),
-            spotLight->GetDirection().y(),
-            spotLight->GetDirection().z());
-
-        m_cachedUniformName.resize(constSize);
-        m_cachedUniformName += "position";
-        glUniform3f(
-            m_shader->GetUniformLocation(m_cachedUniformName.c_str()),
-            spotLight->GetPosition().x(),
-            spotLight->GetPosition().y(),
-            spotLight->GetPosition().z());
-
-        m_cachedUniformName.resize(constSize);
-
-        PrepareColorContext(m_cachedUniformName, m_shader, spotLight.get());
+        UploadLights();
     }
 
-    m_cachedUniformName.clear();
+    m_uniformBuffer->Bind(UniformBlockBinding::Lights);
 }
 
 void LightsArray::AddSpotLight(const SpotLightPtr& spotlight)
@@ -1,10 +1,12 @@
 #pragma once
 
+#include <cstdint>
 #include <vector>
 #include "Scene/Lights/PointLight.h"
 #include "Scene/Lights/DirectionalLight.h"
 #include "Scene/Lights/SpotLight.h"
 #include "Render/Shaders/ShaderProgram.h"
+#include "Render/UniformBuffer.h"
 
 class LightsArray
 {
@@ -14,10 +16,14 @@ public:
         std::vector<DirectionalLightPtr> directionalLights,
         std::vector<SpotLightPtr> spotLights,
         const char* VS, const char* FS,
-        std::ostream* ostream = nullptr);
+        std::ostream* ostream = nullptr,
+        bool bakedLighting = false);
 
     const ShaderProgramPtr& GetShader() const { return m_shader; }
 
+    /* Uploads Lights uniform block if any light changed since the last
+     * call and binds it to UniformBlockBinding::Lights.
+     */
     void PrepareContext();
 
     const std::vector<PointLightPtr>& GetPointLights() const { return m_pointLights; }
@@ -28,6 +34,15 @@ public:
     void ClearSpotLights();
 
 private:
+    // Light and its revision at the moment of upload
+    struct UploadedLight
+    {
+        const LightSource* m_light;
+        uint32_t m_revision;
+    };
+
+    void CollectLights(std::vector<UploadedLight>* lights) const;
+    void UploadLights();
 
     size_t m_pointLightsCapacity;
     std::vector<PointLightPtr> m_pointLights;
@@ -40,7 +55,11 @@ private:
 
     ShaderProgramPtr m_shader;
 
-    mutable std::string m_cachedUniformName;
+    // Lights block is uploaded only when lights or their counts change
+    UniformBufferPtr m_uniformBuffer;
+    std::vector<uint8_t> m_uniformData;
+    std::vector<UploadedLight> m_uploadedLights;
+    std::vector<UploadedLight> m_currentLights;
 };
 
 using LightsArrayPtr = std::shared_ptr<LightsArray>;
\ No newline at end of file
@@ -4,7 +4,8 @@ LightSource::LightSource(const Vector3f& ambient,
     const Vector3f& diffuse, const Vector3f& specular) :
 m_ambient(ambient),
 m_diffuse(diffuse),
-m_specular(specular)
+m_specular(specular),
+m_revision(0)
 {
 
 }
\ No newline at end of file
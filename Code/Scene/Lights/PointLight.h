@@ -38,9 +38,11 @@ public:
         float m_distance);
 
     const Attenuation& GetAttenuation() const { return m_attenuation; }
-    Attenuation& SetAttenuation() { return m_attenuation; }
+    // Counts as change of the light
+    Attenuation& SetAttenuation() { MarkChanged(); return m_attenuation; }
 
     const Vector3f& GetPosition() const { return m_position; }
+    void SetPosition(const Vector3f& value) { m_position = value; MarkChanged(); }
 
 private:
     Vector3f m_position;
@@ -38,10 +38,12 @@ void SpotLight::SetInnerAngle(float angle)
 {
     m_innerAngle = angle;
     m_flag |= UpdateFlag::InnerAngleCos;
+    MarkChanged();
 }
 
 void SpotLight::SetOuterAngle(float angle)
 {
     m_outerAngle = angle;
     m_flag |= UpdateFlag::OuterAngleCos;
+    MarkChanged();
 }
\ No newline at end of file
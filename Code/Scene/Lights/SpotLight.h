@@ -13,9 +13,9 @@ public:
         const Vector3f& diffuse, const Vector3f& specular);
 
     const Vector3f& GetDirection() const { return m_direction; }
-    void SetDirection(const Vector3f& value) { m_direction = value; }
+    void SetDirection(const Vector3f& value) { m_direction = value; MarkChanged(); }
     const Vector3f& GetPosition() const { return m_position; }
-    void SetPosition(const Vector3f& value) { m_position = value; }
+    void SetPosition(const Vector3f& value) { m_position = value; MarkChanged(); }
 
     void SetInnerAngle(float angle);
     void SetOuterAngle(float angle);
@@ -2,7 +2,12 @@
 
 ColoredMaterial::ColoredMaterial(const ShaderProgramPtr& shader) :
     Material(shader)
-{}
+{
+    if (shader != nullptr)
+    {
+        m_colorUniform = shader->GetUniform<Vector3f>("inputColor");
+    }
+}
 
 void ColoredMaterial::PrepareContext() const
 {
@@ -15,8 +20,5 @@ void ColoredMaterial::PrepareContext() const
         return;
     }
 
-    glUniform3f(shader->GetUniformLocation("inputColor"),
-        m_color.x(), m_color.y(), m_color.z());
-
-    glPolygonMode(GetGlFacetSide(), GetGlPolygonMode());
+    m_colorUniform.Set(m_color);
 }
\ No newline at end of file
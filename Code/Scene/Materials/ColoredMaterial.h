@@ -17,6 +17,7 @@ public:
 
 private:
     Vector3f m_color;
+    ShaderUniform<Vector3f> m_colorUniform;
 };
 
 using ColoredMaterialPtr = std::shared_ptr<ColoredMaterial>;
\ No newline at end of file
@@ -29,6 +29,10 @@ public:
     virtual void SetFacetSide(FacetSide facetSide) = 0;
     virtual FacetSide GetFacetSide() const = 0;
 
+    // Transparent models are blended after opaque ones, farthest first
+    virtual void SetTransparent(bool transparent) = 0;
+    virtual bool IsTransparent() const = 0;
+
     virtual const ShaderProgramPtr& GetShaderProgram() const = 0;
 
     virtual ~IMaterial() {};
@@ -1,5 +1,6 @@
 #include <cassert>
 
+#include "Render/GLState.h"
 #include "Scene/Materials/Material.h"
 
 namespace
@@ -35,6 +36,7 @@ Material::Material(const ShaderProgramPtr& shader) :
     m_flag(UpdateFlag::FacetSide | UpdateFlag::PolygonMode),
     m_facetSide(FacetSide::FrontAndBack),
     m_polygonMode(PolygonMode::Face),
+    m_transparent(false),
     m_pointSize(2.f),
     m_lineWidth(2.f),
     m_shader(shader)
@@ -49,15 +51,15 @@ void Material::PrepareContext() const
 
     m_shader->Use();
 
-    glPolygonMode(GetGlFacetSide(), GetGlPolygonMode());
+    XGLState::PolygonMode(GetGlFacetSide(), GetGlPolygonMode());
 
     switch (m_polygonMode)
     {
     case PolygonMode::Point:
-        glPointSize(m_pointSize);
+        XGLState::PointSize(m_pointSize);
         break;
     case PolygonMode::Line:
-        glLineWidth(m_lineWidth);
+        XGLState::LineWidth(m_lineWidth);
         break;
     }
 }
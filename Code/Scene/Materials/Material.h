@@ -20,6 +20,9 @@ public:
     void SetPolygonMode(PolygonMode mode) override;
     PolygonMode GetPolygonMode() const override { return m_polygonMode; }
 
+    void SetTransparent(bool transparent) override { m_transparent = transparent; }
+    bool IsTransparent() const override { return m_transparent; }
+
     virtual const ShaderProgramPtr& GetShaderProgram() const override
     {
         return m_shader;
@@ -50,6 +53,7 @@ private:
 
     FacetSide m_facetSide;
     PolygonMode m_polygonMode;
+    bool m_transparent;
 
     ShaderProgramPtr m_shader;
 };
\ No newline at end of file
@@ -3,7 +3,15 @@
 TexturedMaterial::TexturedMaterial(const ShaderProgramPtr& shader) :
     Material(shader),
     m_shininess(128.f)
-{}
+{
+    if (shader != nullptr)
+    {
+        m_ambientUniform = shader->TryGetUniform<int>("material.ambient");
+        m_diffuseUniform = shader->TryGetUniform<int>("material.diffuse");
+        m_specularUniform = shader->TryGetUniform<int>("material.specular");
+        m_shininessUniform = shader->TryGetUniform<float>("material.shininess");
+    }
+}
 
 void TexturedMaterial::PrepareContext() const
 {
@@ -20,22 +28,22 @@ void TexturedMaterial::PrepareContext() const
 
     if (m_ambient != nullptr)
     {
-        glUniform1i(shader->GetUniformLocation("material.ambient"), uniformIndex);
+        m_ambientUniform.Set(uniformIndex);
         m_ambient->Use(uniformIndex++);
     }
 
     if (m_diffuse != nullptr)
     {
-        glUniform1i(shader->GetUniformLocation("material.diffuse"), uniformIndex);
+        m_diffuseUniform.Set(uniformIndex);
         m_diffuse->Use(uniformIndex++);
     }
 
     if (m_specular != nullptr)
     {
-        glUniform1i(shader->GetUniformLocation("material.specular"), uniformIndex);
+        m_specularUniform.Set(uniformIndex);
         m_specular->Use(uniformIndex++);
     }
 
-    glUniform1f(shader->GetUniformLocation("material.shininess"), m_shininess);
+    m_shininessUniform.Set(m_shininess);
 
 }
\ No newline at end of file
@@ -17,11 +17,20 @@ public:
     void SetDiffuse(const Texture2dPtr& diffuse) { m_diffuse = diffuse; }
     void SetSpecular(const Texture2dPtr& specular) { m_specular = specular; }
 
+    const Texture2dPtr& GetAmbient() const { return m_ambient; }
+    const Texture2dPtr& GetDiffuse() const { return m_diffuse; }
+    const Texture2dPtr& GetSpecular() const { return m_specular; }
+
 private:
     float m_shininess;
     Texture2dPtr m_ambient;
     Texture2dPtr m_diffuse;
     Texture2dPtr m_specular;
+
+    ShaderUniform<int> m_ambientUniform;
+    ShaderUniform<int> m_diffuseUniform;
+    ShaderUniform<int> m_specularUniform;
+    ShaderUniform<float> m_shininessUniform;
 };
 
 using TexturedMaterialPtr = std::shared_ptr<TexturedMaterial>;
\ No newline at end of file
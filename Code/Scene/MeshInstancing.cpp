@@ -0,0 +1,248 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+
+#include "Eigen/Geometry"
+
+#include "Base/ParallelFor.h"
+#include "Scene/MeshInstancing.h"
+
+namespace
+{
+    // Vertices used to build transform invariant part of the key
+    const int kKeyVerticesCount = 8;
+    const float kKeyQuantization = 1024.0f;
+    const float kAttributeTolerance = 1.0e-3f;
+
+    struct MeshSignature
+    {
+        uint64_t key;
+        Vector3f centroid;
+        float radius;
+    };
+
+    static uint64_t HashCombine(uint64_t hash, uint64_t value)
+    {
+        // FNV-1a over 64 bit words
+        hash ^= value;
+        hash *= 1099511628211ull;
+        return hash;
+    }
+
+    static MeshSignature ComputeSignature(const MeshData& mesh)
+    {
+        const VertexBlob& vertices = *mesh.GetVertexData();
+        const std::vector<int>& indices = mesh.GetIndexData()->GetData();
+        const ArrayView<const Vector3f> positions =
+            vertices.GetFieldView<VertexBlobField::Pos>();
+
+        MeshSignature signature;
+        signature.key = 14695981039346656037ull;
+        signature.key = HashCombine(signature.key, static_cast<uint64_t>(vertices.GetFields()));
+        signature.key = HashCombine(signature.key, static_cast<uint64_t>(positions.size()));
+        signature.key = HashCombine(signature.key, static_cast<uint64_t>(indices.size()));
+
+        for (int index : indices)
+        {
+            signature.key = HashCombine(signature.key, static_cast<uint64_t>(index));
+        }
+
+        signature.centroid = Vector3f(0.0f, 0.0f, 0.0f);
+        signature.radius = 0.0f;
+
+        if (positions.empty())
+        {
+            return signature;
+        }
+
+        for (int i = 0; i < positions.size(); ++i)
+        {
+            signature.centroid += positions[i];
+        }
+
+        signature.centroid /= static_cast<float>(positions.size());
+
+        for (int i = 0; i < positions.size(); ++i)
+        {
+            signature.radius += (positions[i] - signature.centroid).squaredNorm();
+        }
+
+        signature.radius = std::sqrt(signature.radius / static_cast<float>(positions.size()));
+
+        if (signature.radius <= std::numeric_limits<float>::min())
+        {
+            return signature;
+        }
+
+        // Distances to centroid do not depend on rotation, translation and scale
+        const int keyVertices = std::min(kKeyVerticesCount, positions.size());
+
+        for (int i = 0; i < keyVertices; ++i)
+        {
+            const float distance = (positions[i] - signature.centroid).norm() / signature.radius;
+            signature.key = HashCombine(signature.key,
+                static_cast<uint64_t>(std::lround(distance * kKeyQuantization)));
+        }
+
+        return signature;
+    }
+
+    template<VertexBlobField F>
+    static bool FieldsEqual(const VertexBlob& a, const VertexBlob& b)
+    {
+        const auto viewA = a.GetFieldView<F>();
+        const auto viewB = b.GetFieldView<F>();
+
+        for (int i = 0; i < viewA.size(); ++i)
+        {
+            if ((viewA[i] - viewB[i]).norm() > kAttributeTolerance)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    /* Solves transform which moves prototype onto mesh.
+     * Returns false if meshes are not the same up to such transform.
+     */
+    static bool SolveTransform(const MeshData& prototype, const MeshSignature& prototypeSignature,
+        const MeshData& mesh, const MeshSignature& meshSignature,
+        float tolerance, glm::mat4* matrix)
+    {
+        const VertexBlob& source = *prototype.GetVertexData();
+        const VertexBlob& target = *mesh.GetVertexData();
+
+        if (source.GetFields() != target.GetFields() ||
+            source.Size() != target.Size() ||
+            prototype.GetIndexData()->GetData() != mesh.GetIndexData()->GetData())
+        {
+            return false;
+        }
+
+        const ArrayView<const Vector3f> sourcePositions =
+            source.GetFieldView<VertexBlobField::Pos>();
+        const ArrayView<const Vector3f> targetPositions =
+            target.GetFieldView<VertexBlobField::Pos>();
+
+        Eigen::Matrix3Xd sourcePoints(3, sourcePositions.size());
+        Eigen::Matrix3Xd targetPoints(3, targetPositions.size());
+
+        // Points are centered to keep precision for far away objects
+        for (int i = 0; i < sourcePositions.size(); ++i)
+        {
+            sourcePoints.col(i) = (sourcePositions[i] - prototypeSignature.centroid).cast<double>();
+            targetPoints.col(i) = (targetPositions[i] - meshSignature.centroid).cast<double>();
+        }
+
+        const Eigen::Matrix4d transform = Eigen::umeyama(sourcePoints, targetPoints, true);
+        const Eigen::Matrix3d linear = transform.block<3, 3>(0, 0);
+        const Eigen::Vector3d translation = transform.block<3, 1>(0, 3);
+
+        const double maxError = static_cast<double>(tolerance) *
+            std::max(static_cast<double>(meshSignature.radius), 1.0e-6);
+
+        for (int i = 0; i < sourcePositions.size(); ++i)
+        {
+            const Eigen::Vector3d point = linear * sourcePoints.col(i) + translation;
+
+            if ((point - targetPoints.col(i)).norm() > maxError)
+            {
+                return false;
+            }
+        }
+
+        if (!FieldsEqual<VertexBlobField::TexCoords>(source, target) ||
+            !FieldsEqual<VertexBlobField::Color>(source, target))
+        {
+            return false;
+        }
+
+        const ArrayView<const Vector3f> sourceNormals =
+            source.GetFieldView<VertexBlobField::Norm>();
+        const ArrayView<const Vector3f> targetNormals =
+            target.GetFieldView<VertexBlobField::Norm>();
+
+        const double scale = linear.col(0).norm();
+
+        for (int i = 0; i < sourceNormals.size(); ++i)
+        {
+            const Eigen::Vector3d normal = linear * sourceNormals[i].cast<double>() / scale;
+
+            if ((normal - targetNormals[i].cast<double>()).norm() > kAttributeTolerance)
+            {
+                return false;
+            }
+        }
+
+        // Full transform: move prototype to origin, apply solved one, move to mesh
+        const Eigen::Vector3d sourceCentroid = prototypeSignature.centroid.cast<double>();
+        const Eigen::Vector3d targetCentroid = meshSignature.centroid.cast<double>();
+        const Eigen::Vector3d offset = targetCentroid + translation - linear * sourceCentroid;
+
+        *matrix = glm::mat4();
+
+        for (int column = 0; column < 3; ++column)
+        {
+            for (int row = 0; row < 3; ++row)
+            {
+                (*matrix)[column][row] = static_cast<float>(linear(row, column));
+            }
+
+            (*matrix)[3][column] = static_cast<float>(offset(column));
+        }
+
+        return true;
+    }
+}
+
+std::vector<MeshInstances> DetectInstances(
+    const std::vector<MeshDataPtr>& meshes, float tolerance)
+{
+    std::vector<MeshSignature> signatures(meshes.size());
+
+    ParallelFor(meshes.size(), 64, [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            signatures[i] = ComputeSignature(*meshes[i]);
+        }
+    });
+
+    std::vector<MeshInstances> result;
+    std::vector<size_t> prototypes;
+    std::unordered_multimap<uint64_t, size_t> prototypesByKey;
+
+    for (size_t i = 0; i < meshes.size(); ++i)
+    {
+        bool found = false;
+        glm::mat4 matrix;
+
+        const auto range = prototypesByKey.equal_range(signatures[i].key);
+
+        for (auto it = range.first; it != range.second && !found; ++it)
+        {
+            const size_t prototype = prototypes[it->second];
+
+            if (SolveTransform(*meshes[prototype], signatures[prototype],
+                *meshes[i], signatures[i], tolerance, &matrix))
+            {
+                result[it->second].m_matrices.push_back(matrix);
+                found = true;
+            }
+        }
+
+        if (!found)
+        {
+            prototypesByKey.emplace(signatures[i].key, result.size());
+            prototypes.push_back(i);
+            result.emplace_back(meshes[i], i);
+            result.back().m_matrices.push_back(glm::mat4());
+        }
+    }
+
+    return result;
+}
\ No newline at end of file
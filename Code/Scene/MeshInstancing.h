@@ -0,0 +1,34 @@
+#pragma once
+
+#include <vector>
+
+#include "Scene/MeshData.h"
+
+// GLM
+#include <glm/glm.hpp>
+
+// Mesh which is stored once and placed in the scene several times
+class MeshInstances
+{
+public:
+    explicit MeshInstances(const MeshDataPtr& meshData, size_t sourceIndex) :
+        m_meshData(meshData),
+        m_sourceIndex(sourceIndex)
+    {}
+
+    MeshDataPtr m_meshData;
+    // Index of the first occurrence in DetectInstances input
+    size_t m_sourceIndex;
+    std::vector<glm::mat4> m_matrices;
+};
+
+/* Collapses geometrically identical meshes. Meshes are compared by
+ * topology and by positions canonicalized around their centroid, then
+ * the rotation, uniform scale and translation between them is solved.
+ * Mesh is considered an instance if every transformed vertex is closer
+ * than tolerance (relative to mesh radius) to the matching one.
+ * Result keeps order of first occurrence, every first occurrence gets
+ * identity matrix.
+ */
+std::vector<MeshInstances> DetectInstances(
+    const std::vector<MeshDataPtr>& meshes, float tolerance = 1.0e-4f);
\ No newline at end of file
@@ -1,96 +1,80 @@
-#include <set>
+#include <cmath>
 #include "Scene/Model3d.h"
-#include "Render/VertexBufferObject.h"
 
 namespace
 {
+    static RenderCache s_renderCache;
+}
 
-class RenderCache
+Model3d::Model3d(
+    const MeshDataPtr& meshData,
+    const IMaterialPtr& material) :
+    m_flag(UpdateFlag::NormalMatrix | UpdateFlag::BoundingBox),
+    m_matrixRevision(0),
+    m_meshData(meshData),
+    m_material(material)
 {
-public:
-    ElementBufferObjectPtr GetEBO_For(const MeshDataPtr& md)
-    {
-        const IndexBlobPtr& idxBlob = md->GetIndexData();
-
-        for (auto& ebo : m_ebo)
-        {
-            if (ebo->GetIndexBlob() == idxBlob)
-            {
-                return ebo;
-            }
-        }
-
-        VertexBufferObjectPtr vbo = GetVBO_For(md->GetVertexData());
+    assert(m_meshData != nullptr && material != nullptr);
+    m_meshBuffer = s_renderCache.GetMeshBuffer(m_meshData);
 
-        ElementBufferObjectPtr ebo = std::make_shared<ElementBufferObject>(
-            vbo, idxBlob);
+    const ShaderProgramPtr& shader = m_material->GetShaderProgram();
+    m_modelUniform = shader->TryGetUniform<glm::mat4>("model");
+    m_normalMatrixUniform = shader->TryGetUniform<glm::mat3>("normalMatrix");
+}
 
-        m_ebo.insert(ebo);
+void Model3d::Draw() const
+{
+    PrepareContext();
+    m_meshBuffer->Draw();
+}
 
-        return ebo;
-    }
+void Model3d::Draw(const std::vector<IndexRange>& ranges) const
+{
+    PrepareContext();
 
-    VertexBufferObjectPtr GetVBO_For(const VertexBlobPtr& vertBlob)
+    for (const IndexRange& range : ranges)
     {
-        for (auto& vbo : m_vbo)
-        {
-            if (vbo->GetVertexBlob() == vertBlob)
-            {
-                return vbo;
-            }
-        }
-
-        VertexBufferObjectPtr result = std::make_shared<VertexBufferObject>(
-            std::make_shared<VertexArrayObject>(), vertBlob);
-
-        m_vbo.insert(result);
-
-        return result;
+        m_meshBuffer->Draw(range);
     }
+}
 
-private:
-    std::set<ElementBufferObjectPtr> m_ebo;
-    std::set<VertexBufferObjectPtr> m_vbo;
-};
-
-static RenderCache s_renderCache;
+void Model3d::DrawPrepared() const
+{
+    UploadMatrices();
+    m_meshBuffer->Draw();
+}
 
+size_t Model3d::DefragmentBuffers(size_t maxMovedBytes)
+{
+    return s_renderCache.Defragment(maxMovedBytes);
 }
 
-Model3d::Model3d(
-    const MeshDataPtr& meshData,
-    const IMaterialPtr& material) :
-    m_flag(UpdateFlag::NormalMatrix),
-    m_meshData(meshData),
-    m_material(material)
+RenderCacheStats Model3d::GetRenderCacheStats()
 {
-    assert(m_meshData != nullptr && material != nullptr);
-    m_elemBuffer = s_renderCache.GetEBO_For(m_meshData);
+    return s_renderCache.GetStats();
 }
 
-void Model3d::Draw() const
+void Model3d::SetContentDeduplication(bool enabled)
 {
-    m_material->GetShaderProgram()->Use();
+    s_renderCache.SetContentHashing(enabled);
+}
 
-    const GLuint modelLoc =
-        m_material->GetShaderProgram()->TryGetUniformLocation("model");
+void Model3d::PrepareContext() const
+{
+    UploadMatrices();
+    m_material->PrepareContext();
+}
 
-    if (modelLoc != 0)
-    {
-        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(GetMatrix()));
-    }
+void Model3d::UploadMatrices() const
+{
+    m_material->GetShaderProgram()->Use();
 
-    const GLuint normalMatrixLoc =
-        m_material->GetShaderProgram()->TryGetUniformLocation("normalMatrix");
+    m_modelUniform.Set(GetMatrix());
 
-    if (normalMatrixLoc != 0)
+    if (m_normalMatrixUniform.IsValid())
     {
-        glUniformMatrix3fv(normalMatrixLoc,
-            1, GL_FALSE, glm::value_ptr(GetNormalMatrix()));
+        m_normalMatrixUniform.Set(GetNormalMatrix());
     }
-
-    m_material->PrepareContext();
-    m_elemBuffer->Draw();
 }
 
 const glm::vec3 Model3d::GetPosition() const
@@ -100,8 +84,9 @@ const glm::vec3 Model3d::GetPosition() const
 
 void Model3d::SetMatrix(const glm::mat4& value)
 {
-    m_flag &= UpdateFlag::NormalMatrix;
+    m_flag |= UpdateFlag::NormalMatrix | UpdateFlag::BoundingBox;
     m_modelMatrix = value;
+    ++m_matrixRevision;
 }
 
 const glm::mat3& Model3d::GetNormalMatrix() const
@@ -114,8 +99,51 @@ const glm::mat3& Model3d::GetNormalMatrix() const
     return m_normalMatrix;
 }
 
+const BoundingBox3f& Model3d::GetBoundingBox() const
+{
+    if ((m_flag & UpdateFlag::BoundingBox) != UpdateFlag::Empty)
+    {
+        RecomputeBoundingBox();
+    }
+
+    return m_boundingBox;
+}
+
 void Model3d::RecomputeNormalMatrix() const
 {
-    m_flag &= (UpdateFlag::NormalMatrix);
+    m_flag &= (~UpdateFlag::NormalMatrix);
     m_normalMatrix = glm::mat3(glm::transpose(glm::inverse(m_modelMatrix)));
+}
+
+void Model3d::RecomputeBoundingBox() const
+{
+    m_flag &= (~UpdateFlag::BoundingBox);
+
+    const BoundingBox3f& local = m_meshData->GetBoundingBox();
+
+    if (!local.IsValid())
+    {
+        m_boundingBox = local;
+        return;
+    }
+
+    // Transformed center with extents projected onto world axes
+    const Vector3f localCenter = (local.min + local.max) * 0.5f;
+    const Vector3f localExtent = (local.max - local.min) * 0.5f;
+
+    const glm::vec4 center = m_modelMatrix *
+        glm::vec4(localCenter.x(), localCenter.y(), localCenter.z(), 1.0f);
+
+    Vector3f extent;
+
+    for (int row = 0; row < 3; ++row)
+    {
+        extent[row] =
+            std::abs(m_modelMatrix[0][row]) * localExtent.x() +
+            std::abs(m_modelMatrix[1][row]) * localExtent.y() +
+            std::abs(m_modelMatrix[2][row]) * localExtent.z();
+    }
+
+    const Vector3f worldCenter(center.x, center.y, center.z);
+    m_boundingBox = BoundingBox3f(worldCenter - extent, worldCenter + extent);
 }
\ No newline at end of file
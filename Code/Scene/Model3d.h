@@ -3,7 +3,8 @@
 #include "Scene/MeshData.h"
 #include "Scene/Materials/IMaterial.h"
 
-#include "Render/ElementBufferObject.h"
+#include "Render/MeshBufferPool.h"
+#include "Scene/RenderCache.h"
 
 // GLM
 #include <glm/glm.hpp>
@@ -19,10 +20,21 @@ public:
 
     void Draw() const;
 
+    // Draws only given parts of mesh indices
+    void Draw(const std::vector<IndexRange>& ranges) const;
+
+    /* Material must be prepared by caller, lets models with the same
+     * material be drawn in a row without preparing it again
+     */
+    void DrawPrepared() const;
+
     const MeshDataPtr& GetMeshData() const { return m_meshData; }
 
     const IMaterialPtr& GetMaterial() const { return m_material; }
 
+    // Shared by all models with the same mesh
+    const MeshBufferPtr& GetMeshBuffer() const { return m_meshBuffer; }
+
     const glm::vec3 GetPosition() const;
 
     const glm::mat4& GetMatrix() const
@@ -32,26 +44,56 @@ public:
 
     void SetMatrix(const glm::mat4& value);
 
+    // Incremented by every SetMatrix call, lets spatial structures find moved models
+    uint32_t GetMatrixRevision() const { return m_matrixRevision; }
+
     const glm::mat3& GetNormalMatrix() const;
 
+    // Mesh bounding box in world space
+    const BoundingBox3f& GetBoundingBox() const;
+
+    /* Closes gaps left in pooled mesh buffers by destroyed meshes,
+     * copies up to maxMovedBytes per call. Returns copied bytes.
+     */
+    static size_t DefragmentBuffers(size_t maxMovedBytes);
+
+    // Mesh buffers shared by all models
+    static RenderCacheStats GetRenderCacheStats();
+
+    /* Models created after this call share buffers with any model which
+     * has identical vertex and index data, not only the same blobs.
+     */
+    static void SetContentDeduplication(bool enabled);
+
 private:
     enum class UpdateFlag : uint8_t
     {
         Empty        = 0,
         NormalMatrix = 1,
+        BoundingBox  = 2
     };
 
     void RecomputeNormalMatrix() const;
+    void RecomputeBoundingBox() const;
+
+    // Uploads matrices and prepares material
+    void PrepareContext() const;
+    void UploadMatrices() const;
 
     ENUM_FLAG_OPERATORS_CLASS(UpdateFlag);
 
     mutable UpdateFlag m_flag;
     mutable glm::mat3 m_normalMatrix;
+    mutable BoundingBox3f m_boundingBox;
 
     glm::mat4 m_modelMatrix;
+    uint32_t m_matrixRevision;
     MeshDataPtr m_meshData;
     IMaterialPtr m_material;
-    ElementBufferObjectPtr m_elemBuffer;
+    MeshBufferPtr m_meshBuffer;
+
+    ShaderUniform<glm::mat4> m_modelUniform;
+    ShaderUniform<glm::mat3> m_normalMatrixUniform;
 };
 
 using Model3dPtr = std::shared_ptr<Model3d>;
\ No newline at end of file
@@ -0,0 +1,318 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <xmmintrin.h>
+
+#include "Scene/OcclusionBuffer.h"
+
+namespace
+{
+    const float kFarDepth = 1.0f;
+    // Vertices closer to the eye than this (clip w) are treated as crossing near plane
+    const float kMinW = 1.0e-5f;
+}
+
+OcclusionBuffer::OcclusionBuffer(int width, int height) :
+    m_width((std::max(width, 1) + kTileSize - 1) / kTileSize * kTileSize),
+    m_height((std::max(height, 1) + kTileSize - 1) / kTileSize * kTileSize),
+    m_tilesPerRow(m_width / kTileSize)
+{
+    m_depth.assign(static_cast<size_t>(m_width) * m_height, kFarDepth);
+    m_tileMaxDepth.assign(static_cast<size_t>(m_tilesPerRow) * GetTileRowsCount(), kFarDepth);
+}
+
+void OcclusionBuffer::SetupTriangles(const MeshData& mesh, const glm::mat4& modelViewProjection,
+    std::vector<Triangle>* triangles) const
+{
+    assert(triangles != nullptr);
+
+    const ArrayView<const Vector3f> positions =
+        static_cast<const VertexBlob&>(*mesh.GetVertexData()).GetFieldView<VertexBlobField::Pos>();
+    const std::vector<int>& indices = mesh.GetIndexData()->GetData();
+
+    std::vector<glm::vec4> screen(static_cast<size_t>(positions.size()));
+
+    for (int i = 0; i < positions.size(); ++i)
+    {
+        const Vector3f& p = positions[i];
+        const glm::vec4 clip = modelViewProjection * glm::vec4(p.x(), p.y(), p.z(), 1.0f);
+
+        // Behind the eye or between the eye and near plane, GPU clips such parts away
+        if (clip.w <= kMinW || clip.z < -clip.w)
+        {
+            // Mark as invalid by w
+            screen[i] = glm::vec4(0.0f, 0.0f, 0.0f, -1.0f);
+            continue;
+        }
+
+        const float invW = 1.0f / clip.w;
+
+        screen[i] = glm::vec4(
+            (clip.x * invW * 0.5f + 0.5f) * m_width,
+            (clip.y * invW * 0.5f + 0.5f) * m_height,
+            clip.z * invW,
+            1.0f);
+    }
+
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        const glm::vec4& a = screen[indices[i]];
+        const glm::vec4& b = screen[indices[i + 1]];
+        const glm::vec4& c = screen[indices[i + 2]];
+
+        if (a.w < 0.0f || b.w < 0.0f || c.w < 0.0f)
+        {
+            continue;
+        }
+
+        // Counter clockwise triangles are front facing, same as in OpenGL
+        const float area = (b.x - a.x) * (c.y - a.y) - (c.x - a.x) * (b.y - a.y);
+
+        if (!(area > 0.0f))
+        {
+            continue;
+        }
+
+        Triangle triangle;
+        triangle.m_x[0] = a.x; triangle.m_y[0] = a.y; triangle.m_z[0] = a.z;
+        triangle.m_x[1] = b.x; triangle.m_y[1] = b.y; triangle.m_z[1] = b.z;
+        triangle.m_x[2] = c.x; triangle.m_y[2] = c.y; triangle.m_z[2] = c.z;
+
+        triangles->push_back(triangle);
+    }
+}
+
+void OcclusionBuffer::Clear(int firstTileRow, int endTileRow)
+{
+    std::fill(
+        m_depth.begin() + static_cast<size_t>(firstTileRow) * kTileSize * m_width,
+        m_depth.begin() + static_cast<size_t>(endTileRow) * kTileSize * m_width,
+        kFarDepth);
+
+    std::fill(
+        m_tileMaxDepth.begin() + static_cast<size_t>(firstTileRow) * m_tilesPerRow,
+        m_tileMaxDepth.begin() + static_cast<size_t>(endTileRow) * m_tilesPerRow,
+        kFarDepth);
+}
+
+void OcclusionBuffer::Rasterize(const std::vector<Triangle>& triangles, int firstTileRow, int endTileRow)
+{
+    const int firstRow = firstTileRow * kTileSize;
+    const int endRow = endTileRow * kTileSize;
+
+    for (const Triangle& triangle : triangles)
+    {
+        RasterizeTriangle(triangle, firstRow, endRow);
+    }
+
+    UpdateTiles(firstTileRow, endTileRow);
+}
+
+void OcclusionBuffer::RasterizeTriangle(const Triangle& t, int firstRow, int endRow)
+{
+    const float minX = std::min(t.m_x[0], std::min(t.m_x[1], t.m_x[2]));
+    const float maxX = std::max(t.m_x[0], std::max(t.m_x[1], t.m_x[2]));
+    const float minY = std::min(t.m_y[0], std::min(t.m_y[1], t.m_y[2]));
+    const float maxY = std::max(t.m_y[0], std::max(t.m_y[1], t.m_y[2]));
+
+    // Pixels which centers can be covered
+    const int x0 = std::max(0, static_cast<int>(std::ceil(minX - 0.5f)));
+    const int x1 = std::min(m_width - 1, static_cast<int>(std::floor(maxX - 0.5f)));
+    const int y0 = std::max(firstRow, static_cast<int>(std::ceil(minY - 0.5f)));
+    const int y1 = std::min(endRow - 1, static_cast<int>(std::floor(maxY - 0.5f)));
+
+    if (x0 > x1 || y0 > y1)
+    {
+        return;
+    }
+
+    // Edge functions are positive inside of counter clockwise triangle
+    float edgeA[3];
+    float edgeB[3];
+    float edgeC[3];
+
+    for (int i = 0; i < 3; ++i)
+    {
+        const int j = (i + 1) % 3;
+
+        edgeA[i] = t.m_y[i] - t.m_y[j];
+        edgeB[i] = t.m_x[j] - t.m_x[i];
+        edgeC[i] = t.m_x[i] * t.m_y[j] - t.m_x[j] * t.m_y[i];
+    }
+
+    // Depth plane z = zx * x + zy * y + z0
+    const float area = edgeC[0] + edgeC[1] + edgeC[2];
+    const float invArea = 1.0f / area;
+
+    // Barycentric weight of vertex k is edge function of opposite edge
+    const float zx = (edgeA[1] * t.m_z[0] + edgeA[2] * t.m_z[1] + edgeA[0] * t.m_z[2]) * invArea;
+    const float zy = (edgeB[1] * t.m_z[0] + edgeB[2] * t.m_z[1] + edgeB[0] * t.m_z[2]) * invArea;
+    const float zc = (edgeC[1] * t.m_z[0] + edgeC[2] * t.m_z[1] + edgeC[0] * t.m_z[2]) * invArea;
+
+    const __m128 laneOffsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+    const __m128 zero = _mm_setzero_ps();
+
+    const __m128 a0 = _mm_set1_ps(edgeA[0]);
+    const __m128 a1 = _mm_set1_ps(edgeA[1]);
+    const __m128 a2 = _mm_set1_ps(edgeA[2]);
+    const __m128 depthX = _mm_set1_ps(zx);
+
+    const int firstColumn = x0 & ~3;
+
+    for (int y = y0; y <= y1; ++y)
+    {
+        const float py = y + 0.5f;
+        float* const row = &m_depth[static_cast<size_t>(y) * m_width];
+
+        const __m128 rowE0 = _mm_set1_ps(edgeB[0] * py + edgeC[0]);
+        const __m128 rowE1 = _mm_set1_ps(edgeB[1] * py + edgeC[1]);
+        const __m128 rowE2 = _mm_set1_ps(edgeB[2] * py + edgeC[2]);
+        const __m128 rowDepth = _mm_set1_ps(zy * py + zc);
+
+        for (int x = firstColumn; x <= x1; x += 4)
+        {
+            const __m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), laneOffsets);
+
+            const __m128 e0 = _mm_add_ps(_mm_mul_ps(a0, px), rowE0);
+            const __m128 e1 = _mm_add_ps(_mm_mul_ps(a1, px), rowE1);
+            const __m128 e2 = _mm_add_ps(_mm_mul_ps(a2, px), rowE2);
+
+            // Lanes out of triangle bounds fail edge tests as well
+            const __m128 mask = _mm_and_ps(_mm_cmpge_ps(e0, zero),
+                _mm_and_ps(_mm_cmpge_ps(e1, zero), _mm_cmpge_ps(e2, zero)));
+
+            if (_mm_movemask_ps(mask) == 0)
+            {
+                continue;
+            }
+
+            const __m128 depth = _mm_add_ps(_mm_mul_ps(depthX, px), rowDepth);
+            const __m128 current = _mm_loadu_ps(row + x);
+            const __m128 closest = _mm_min_ps(current, depth);
+
+            _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(mask, closest), _mm_andnot_ps(mask, current)));
+        }
+    }
+}
+
+void OcclusionBuffer::UpdateTiles(int firstTileRow, int endTileRow)
+{
+    for (int tileY = firstTileRow; tileY < endTileRow; ++tileY)
+    {
+        for (int tileX = 0; tileX < m_tilesPerRow; ++tileX)
+        {
+            __m128 farthest = _mm_setzero_ps();
+
+            for (int y = 0; y < kTileSize; ++y)
+            {
+                const float* const pixels = &m_depth[
+                    static_cast<size_t>(tileY * kTileSize + y) * m_width + tileX * kTileSize];
+
+                farthest = _mm_max_ps(farthest, _mm_loadu_ps(pixels));
+                farthest = _mm_max_ps(farthest, _mm_loadu_ps(pixels + 4));
+            }
+
+            float lanes[4];
+            _mm_storeu_ps(lanes, farthest);
+
+            m_tileMaxDepth[static_cast<size_t>(tileY) * m_tilesPerRow + tileX] =
+                std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+        }
+    }
+}
+
+bool OcclusionBuffer::IsVisible(const BoundingBox3f& box, const glm::mat4& viewProjection) const
+{
+    if (!box.IsValid())
+    {
+        return false;
+    }
+
+    float minX = static_cast<float>(m_width);
+    float maxX = 0.0f;
+    float minY = static_cast<float>(m_height);
+    float maxY = 0.0f;
+    float minZ = kFarDepth;
+
+    // Depth is monotonic with view distance, so the nearest point of box is one of corners
+    for (int corner = 0; corner < 8; ++corner)
+    {
+        const glm::vec4 point(
+            (corner & 1) != 0 ? box.max.x() : box.min.x(),
+            (corner & 2) != 0 ? box.max.y() : box.min.y(),
+            (corner & 4) != 0 ? box.max.z() : box.min.z(),
+            1.0f);
+
+        const glm::vec4 clip = viewProjection * point;
+
+        // Box crosses near plane, camera may be inside
+        if (clip.w <= kMinW)
+        {
+            return true;
+        }
+
+        const float invW = 1.0f / clip.w;
+        const float x = (clip.x * invW * 0.5f + 0.5f) * m_width;
+        const float y = (clip.y * invW * 0.5f + 0.5f) * m_height;
+
+        minX = std::min(minX, x);
+        maxX = std::max(maxX, x);
+        minY = std::min(minY, y);
+        maxY = std::max(maxY, y);
+        minZ = std::min(minZ, clip.z * invW);
+    }
+
+    // Conservative pixel rectangle
+    const int x0 = std::max(0, static_cast<int>(std::floor(minX)));
+    const int x1 = std::min(m_width - 1, static_cast<int>(std::floor(maxX)));
+    const int y0 = std::max(0, static_cast<int>(std::floor(minY)));
+    const int y1 = std::min(m_height - 1, static_cast<int>(std::floor(maxY)));
+
+    if (x0 > x1 || y0 > y1)
+    {
+        return false;
+    }
+
+    const __m128 boxDepth = _mm_set1_ps(minZ);
+
+    for (int tileY = y0 / kTileSize; tileY <= y1 / kTileSize; ++tileY)
+    {
+        for (int tileX = x0 / kTileSize; tileX <= x1 / kTileSize; ++tileX)
+        {
+            // Whole tile is closer than the box
+            if (minZ > m_tileMaxDepth[static_cast<size_t>(tileY) * m_tilesPerRow + tileX])
+            {
+                continue;
+            }
+
+            const int rowBegin = std::max(y0, tileY * kTileSize);
+            const int rowEnd = std::min(y1, tileY * kTileSize + kTileSize - 1);
+            const int columnBegin = std::max(x0, tileX * kTileSize);
+            const int columnEnd = std::min(x1, tileX * kTileSize + kTileSize - 1);
+
+            for (int y = rowBegin; y <= rowEnd; ++y)
+            {
+                const float* const row = &m_depth[static_cast<size_t>(y) * m_width];
+                int x = columnBegin;
+
+                for (; x + 3 <= columnEnd; x += 4)
+                {
+                    if (_mm_movemask_ps(_mm_cmpge_ps(_mm_loadu_ps(row + x), boxDepth)) != 0)
+                    {
+                        return true;
+                    }
+                }
+
+                for (; x <= columnEnd; ++x)
+                {
+                    if (row[x] >= minZ)
+                    {
+                        return true;
+                    }
+                }
+            }
+        }
+    }
+
+    return false;
+}
\ No newline at end of file
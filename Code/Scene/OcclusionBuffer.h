@@ -0,0 +1,65 @@
+#pragma once
+
+#include <vector>
+
+#include "Base/Geom/BoundingBox.h"
+#include "Scene/MeshData.h"
+
+// GLM
+#include <glm/glm.hpp>
+
+/* Small software depth buffer for occlusion culling. Occluder triangles
+ * are rasterized with SSE, four pixels at a time. Buffer is split into
+ * 8x8 tiles, farthest depth of every tile is kept to reject boxes
+ * without touching pixels (hierarchical Z).
+ * Rows can be rasterized and tested by different threads, each thread
+ * must own a range of tile rows.
+ */
+class OcclusionBuffer
+{
+public:
+    static const int kTileSize = 8;
+
+    // Size is rounded up to whole tiles
+    explicit OcclusionBuffer(int width, int height);
+
+    OcclusionBuffer(const OcclusionBuffer&) = delete;
+
+    int GetWidth() const { return m_width; }
+    int GetHeight() const { return m_height; }
+    int GetTileRowsCount() const { return m_height / kTileSize; }
+
+    // Triangle in buffer pixel coordinates with normalized device depth
+    struct Triangle
+    {
+        float m_x[3];
+        float m_y[3];
+        float m_z[3];
+    };
+
+    /* Appends front facing triangles of mesh to the list. Triangles crossing
+     * near plane are skipped, so occluders never hide more than they should.
+     */
+    void SetupTriangles(const MeshData& mesh, const glm::mat4& modelViewProjection,
+        std::vector<Triangle>* triangles) const;
+
+    // Sets far depth in tile rows [firstTileRow, endTileRow)
+    void Clear(int firstTileRow, int endTileRow);
+
+    // Rasterizes triangles into tile rows [firstTileRow, endTileRow) and updates tiles depth
+    void Rasterize(const std::vector<Triangle>& triangles, int firstTileRow, int endTileRow);
+
+    // Conservative test of world box, false only if box is hidden or out of screen
+    bool IsVisible(const BoundingBox3f& box, const glm::mat4& viewProjection) const;
+
+private:
+    void RasterizeTriangle(const Triangle& triangle, int firstRow, int endRow);
+    void UpdateTiles(int firstTileRow, int endTileRow);
+
+    int m_width;
+    int m_height;
+    int m_tilesPerRow;
+
+    std::vector<float> m_depth;
+    std::vector<float> m_tileMaxDepth;
+};
\ No newline at end of file
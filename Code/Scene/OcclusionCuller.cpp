@@ -0,0 +1,171 @@
+#include <cassert>
+
+#include "Base/ParallelFor.h"
+#include "Scene/OcclusionCuller.h"
+
+namespace
+{
+    const size_t kMinBoxesPerThread = 512;
+}
+
+OcclusionCuller::OcclusionCuller(int width, int height) :
+    m_buffer(width, height),
+    m_hasJob(false),
+    m_jobDone(false),
+    m_exit(false)
+{
+    // Worker starts after all members are initialized
+    m_worker = std::thread([this]() { WorkerLoop(); });
+}
+
+OcclusionCuller::~OcclusionCuller()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_exit = true;
+    }
+
+    m_condition.notify_all();
+    m_worker.join();
+}
+
+void OcclusionCuller::Start(const glm::mat4& viewProjection,
+    const std::vector<Model3dPtr>& occluders,
+    const std::vector<Model3dPtr>& models,
+    const std::vector<int>& candidates)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    // Previous job must be finished
+    assert(!m_hasJob);
+
+    m_viewProjection = viewProjection;
+
+    m_occluders.resize(occluders.size());
+
+    for (size_t i = 0; i < occluders.size(); ++i)
+    {
+        m_occluders[i].m_mesh = occluders[i]->GetMeshData();
+        m_occluders[i].m_modelViewProjection = viewProjection * occluders[i]->GetMatrix();
+    }
+
+    m_candidates = candidates;
+    m_boxes.resize(candidates.size());
+
+    for (size_t i = 0; i < candidates.size(); ++i)
+    {
+        m_boxes[i] = models[candidates[i]]->GetBoundingBox();
+    }
+
+    m_hasJob = true;
+    m_jobDone = false;
+
+    lock.unlock();
+    m_condition.notify_all();
+}
+
+void OcclusionCuller::Finish(std::vector<int>* visible)
+{
+    assert(visible != nullptr);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_condition.wait(lock, [this]() { return m_jobDone || !m_hasJob; });
+
+    visible->clear();
+
+    if (!m_hasJob)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < m_candidates.size(); ++i)
+    {
+        if (m_visibility[i] != 0)
+        {
+            visible->push_back(m_candidates[i]);
+        }
+    }
+
+    m_stats = m_jobStats;
+    m_hasJob = false;
+    m_jobDone = false;
+}
+
+void OcclusionCuller::WorkerLoop()
+{
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [this]() { return m_exit || (m_hasJob && !m_jobDone); });
+
+            if (m_exit)
+            {
+                return;
+            }
+        }
+
+        Process();
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_jobDone = true;
+        }
+
+        m_condition.notify_all();
+    }
+}
+
+void OcclusionCuller::Process()
+{
+    // Occluders to screen space, one list per occluder to avoid locking
+    m_triangles.resize(m_occluders.size());
+
+    ParallelFor(m_occluders.size(), 1, [this](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            m_triangles[i].clear();
+            m_buffer.SetupTriangles(*m_occluders[i].m_mesh, m_occluders[i].m_modelViewProjection,
+                &m_triangles[i]);
+        }
+    });
+
+    m_allTriangles.clear();
+
+    for (const auto& triangles : m_triangles)
+    {
+        m_allTriangles.insert(m_allTriangles.end(), triangles.begin(), triangles.end());
+    }
+
+    // Every thread owns a band of tile rows
+    const int tileRows = m_buffer.GetTileRowsCount();
+
+    ParallelFor(static_cast<size_t>(tileRows), 1, [this](size_t begin, size_t end)
+    {
+        m_buffer.Clear(static_cast<int>(begin), static_cast<int>(end));
+        m_buffer.Rasterize(m_allTriangles, static_cast<int>(begin), static_cast<int>(end));
+    });
+
+    m_visibility.resize(m_boxes.size());
+
+    ParallelFor(m_boxes.size(), kMinBoxesPerThread, [this](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            m_visibility[i] = m_buffer.IsVisible(m_boxes[i], m_viewProjection) ? 1 : 0;
+        }
+    });
+
+    OcclusionStats stats;
+    stats.m_occluders = static_cast<int>(m_occluders.size());
+    stats.m_occluderTriangles = static_cast<int>(m_allTriangles.size());
+    stats.m_tested = static_cast<int>(m_boxes.size());
+
+    for (uint8_t visible : m_visibility)
+    {
+        stats.m_rejected += visible != 0 ? 0 : 1;
+    }
+
+    m_jobStats = stats;
+}
\ No newline at end of file
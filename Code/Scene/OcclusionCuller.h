@@ -0,0 +1,87 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Scene/Model3d.h"
+#include "Scene/OcclusionBuffer.h"
+
+struct OcclusionStats
+{
+    OcclusionStats() :
+        m_occluders(0),
+        m_occluderTriangles(0),
+        m_tested(0),
+        m_rejected(0)
+    {}
+
+    int m_occluders;
+    // Front facing triangles in front of near plane
+    int m_occluderTriangles;
+    int m_tested;
+    int m_rejected;
+};
+
+/* Culls models hidden behind occluders using software depth buffer.
+ * Work is done on a worker thread which spreads rasterization and
+ * tests across cores, so the caller can do other work between
+ * Start and Finish.
+ */
+class OcclusionCuller
+{
+public:
+    explicit OcclusionCuller(int width = 256, int height = 128);
+    ~OcclusionCuller();
+
+    OcclusionCuller(const OcclusionCuller&) = delete;
+
+    /* Begins culling of models[candidates] (usually frustum culling result)
+     * against occluders. World boxes and matrices are copied here, models
+     * can be changed before Finish, but their meshes must stay alive.
+     */
+    void Start(const glm::mat4& viewProjection,
+        const std::vector<Model3dPtr>& occluders,
+        const std::vector<Model3dPtr>& models,
+        const std::vector<int>& candidates);
+
+    // Waits for worker and writes visible subset of candidates
+    void Finish(std::vector<int>* visible);
+
+    // Stats of the last finished frame
+    const OcclusionStats& GetStats() const { return m_stats; }
+
+    const OcclusionBuffer& GetBuffer() const { return m_buffer; }
+
+private:
+    struct Occluder
+    {
+        MeshDataPtr m_mesh;
+        glm::mat4 m_modelViewProjection;
+    };
+
+    void WorkerLoop();
+    void Process();
+
+    OcclusionBuffer m_buffer;
+    OcclusionStats m_stats;
+    OcclusionStats m_jobStats;
+
+    // Job data, owned by worker between Start and Finish
+    glm::mat4 m_viewProjection;
+    std::vector<Occluder> m_occluders;
+    std::vector<BoundingBox3f> m_boxes;
+    std::vector<int> m_candidates;
+    std::vector<uint8_t> m_visibility;
+    std::vector<std::vector<OcclusionBuffer::Triangle>> m_triangles;
+    std::vector<OcclusionBuffer::Triangle> m_allTriangles;
+
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_hasJob;
+    bool m_jobDone;
+    bool m_exit;
+    std::thread m_worker;
+};
\ No newline at end of file
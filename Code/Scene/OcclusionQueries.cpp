@@ -0,0 +1,267 @@
+#include <cassert>
+
+#include "Scene/OcclusionQueries.h"
+
+namespace
+{
+    // Visible models are queried once per this number of frames
+    const uint32_t kVisibleQueryInterval = 4;
+
+    // Hidden results in a row needed to hide visible model
+    const int kHiddenResultsToHide = 2;
+
+    static ElementBufferObjectPtr CreateUnitCube()
+    {
+        VertexBlobPtr vertexBlob = std::make_shared<VertexBlob>(VertexBlobField::Pos, 8);
+        ArrayView<Vector3f> positions = vertexBlob->GetFieldView<VertexBlobField::Pos>();
+
+        for (int i = 0; i < 8; ++i)
+        {
+            positions[i] = Vector3f(
+                static_cast<float>(i & 1),
+                static_cast<float>((i >> 1) & 1),
+                static_cast<float>((i >> 2) & 1));
+        }
+
+        // Winding does not matter, color and depth writes are off
+        std::vector<int> indices
+        {
+            0, 2, 1,  1, 2, 3, // z = 0
+            4, 5, 6,  5, 7, 6, // z = 1
+            0, 1, 4,  1, 5, 4, // y = 0
+            2, 6, 3,  3, 6, 7, // y = 1
+            0, 4, 2,  2, 4, 6, // x = 0
+            1, 3, 5,  3, 7, 5  // x = 1
+        };
+
+        VertexBufferObjectPtr vbo = std::make_shared<VertexBufferObject>(vertexBlob);
+
+        return std::make_shared<ElementBufferObject>(vbo, std::make_shared<IndexBlob>(indices));
+    }
+
+    /* Box query fails when camera is inside the box or the box is clipped
+     * by near plane, such models are always drawn
+     */
+    static bool CrossesNearPlane(const BoundingBox3f& box, const glm::mat4& viewProjection)
+    {
+        for (int corner = 0; corner < 8; ++corner)
+        {
+            const glm::vec4 clip = viewProjection * glm::vec4(
+                (corner & 1) != 0 ? box.max.x() : box.min.x(),
+                (corner & 2) != 0 ? box.max.y() : box.min.y(),
+                (corner & 4) != 0 ? box.max.z() : box.min.z(),
+                1.0f);
+
+            if (clip.z < -clip.w)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+}
+
+OcclusionQueries::OcclusionQueries(const ShaderProgramPtr& boxShader) :
+    m_boxShader(boxShader),
+    m_box(CreateUnitCube()),
+    m_frame(0),
+    m_conditionalRendering(true)
+{
+    assert(m_boxShader != nullptr);
+
+    m_viewProjectionLoc = m_boxShader->GetUniformLocation("viewProjection");
+    m_boxMinLoc = m_boxShader->GetUniformLocation("boxMin");
+    m_boxMaxLoc = m_boxShader->GetUniformLocation("boxMax");
+}
+
+OcclusionQueries::~OcclusionQueries()
+{
+    Reset();
+}
+
+void OcclusionQueries::Reset()
+{
+    for (const ModelState& state : m_states)
+    {
+        if (state.m_query != 0)
+        {
+            glDeleteQueries(1, &state.m_query);
+        }
+    }
+
+    m_states.clear();
+}
+
+void OcclusionQueries::Draw(const glm::mat4& viewProjection,
+    const std::vector<Model3dPtr>& models,
+    const std::vector<int>& candidates)
+{
+    ++m_frame;
+
+    if (m_states.size() < models.size())
+    {
+        m_states.resize(models.size());
+    }
+
+    m_stats = OcclusionQueryStats();
+    m_stats.m_candidates = static_cast<int>(candidates.size());
+
+    m_visible.clear();
+    m_hidden.clear();
+
+    for (int modelIndex : candidates)
+    {
+        ModelState& state = m_states[modelIndex];
+
+        // Model was not drawn in the last frame, its results are outdated
+        if (state.m_lastFrame + 1 != m_frame)
+        {
+            state.m_pending = false;
+            state.m_visible = true;
+            state.m_hiddenResults = 0;
+            state.m_nextQueryFrame = m_frame;
+        }
+
+        state.m_lastFrame = m_frame;
+
+        if (state.m_pending)
+        {
+            ReadResult(state, modelIndex);
+        }
+
+        if (state.m_visible ||
+            CrossesNearPlane(models[modelIndex]->GetBoundingBox(), viewProjection))
+        {
+            m_visible.push_back(modelIndex);
+        }
+        else
+        {
+            m_hidden.push_back(modelIndex);
+        }
+    }
+
+    // Visible models go first to fill depth buffer for boxes
+    for (int modelIndex : m_visible)
+    {
+        ModelState& state = m_states[modelIndex];
+
+        const bool query = !state.m_pending &&
+            static_cast<int32_t>(m_frame - state.m_nextQueryFrame) >= 0;
+
+        if (query)
+        {
+            BeginQuery(state);
+        }
+
+        models[modelIndex]->Draw();
+
+        if (query)
+        {
+            EndQuery(state);
+        }
+    }
+
+    if (m_hidden.empty())
+    {
+        return;
+    }
+
+    m_stats.m_skipped = static_cast<int>(m_hidden.size());
+
+    m_boxShader->Use();
+    glUniformMatrix4fv(m_viewProjectionLoc, 1, GL_FALSE, glm::value_ptr(viewProjection));
+
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDepthMask(GL_FALSE);
+
+    for (int modelIndex : m_hidden)
+    {
+        ModelState& state = m_states[modelIndex];
+
+        // Box from one of previous frames is still in flight
+        if (state.m_pending)
+        {
+            continue;
+        }
+
+        const BoundingBox3f& box = models[modelIndex]->GetBoundingBox();
+        glUniform3f(m_boxMinLoc, box.min.x(), box.min.y(), box.min.z());
+        glUniform3f(m_boxMaxLoc, box.max.x(), box.max.y(), box.max.z());
+
+        BeginQuery(state);
+        m_box->Draw();
+        EndQuery(state);
+    }
+
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glDepthMask(GL_TRUE);
+
+    if (!m_conditionalRendering)
+    {
+        return;
+    }
+
+    // Without waiting GPU draws model if box result is not ready yet
+    for (int modelIndex : m_hidden)
+    {
+        glBeginConditionalRender(m_states[modelIndex].m_query, GL_QUERY_NO_WAIT);
+        models[modelIndex]->Draw();
+        glEndConditionalRender();
+    }
+}
+
+void OcclusionQueries::ReadResult(ModelState& state, int modelIndex)
+{
+    GLuint available = GL_FALSE;
+    glGetQueryObjectuiv(state.m_query, GL_QUERY_RESULT_AVAILABLE, &available);
+
+    if (available == GL_FALSE)
+    {
+        return;
+    }
+
+    GLuint anySamplesPassed = GL_FALSE;
+    glGetQueryObjectuiv(state.m_query, GL_QUERY_RESULT, &anySamplesPassed);
+
+    state.m_pending = false;
+
+    if (anySamplesPassed != GL_FALSE)
+    {
+        state.m_visible = true;
+        state.m_hiddenResults = 0;
+
+        // Offset by index spreads queries of visible models between frames
+        state.m_nextQueryFrame = m_frame + kVisibleQueryInterval +
+            static_cast<uint32_t>(modelIndex) % kVisibleQueryInterval;
+    }
+    else
+    {
+        ++state.m_hiddenResults;
+
+        if (state.m_hiddenResults >= kHiddenResultsToHide)
+        {
+            state.m_visible = false;
+        }
+
+        // Confirm the result as soon as possible
+        state.m_nextQueryFrame = m_frame;
+    }
+}
+
+void OcclusionQueries::BeginQuery(ModelState& state)
+{
+    if (state.m_query == 0)
+    {
+        glGenQueries(1, &state.m_query);
+    }
+
+    glBeginQuery(GL_ANY_SAMPLES_PASSED, state.m_query);
+    ++m_stats.m_queries;
+}
+
+void OcclusionQueries::EndQuery(ModelState& state)
+{
+    glEndQuery(GL_ANY_SAMPLES_PASSED);
+    state.m_pending = true;
+}
\ No newline at end of file
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Render/ElementBufferObject.h"
+#include "Render/Shaders/ShaderProgram.h"
+#include "Scene/Model3d.h"
+
+struct OcclusionQueryStats
+{
+    OcclusionQueryStats() :
+        m_candidates(0),
+        m_queries(0),
+        m_skipped(0)
+    {}
+
+    int m_candidates;
+    // Queries begun this frame, both proxy boxes and real draws
+    int m_queries;
+    // Occluded by previous results, drawn conditionally or not drawn at all
+    int m_skipped;
+};
+
+/* Culls models on GPU with GL_ANY_SAMPLES_PASSED queries. Results are
+ * read one frame late and only when already available, so CPU never
+ * waits for GPU:
+ *  - visible models are drawn first, every few frames their draw is
+ *    wrapped into a query to find out if they became hidden;
+ *  - hidden models are tested by drawing their bounding box without color
+ *    and depth writes, then drawn under conditional rendering, so GPU
+ *    skips them while the box is hidden and nothing pops in when it is not.
+ * Model is hidden only after several hidden results in a row, which keeps
+ * models on the edge of occluders from flickering.
+ */
+class OcclusionQueries
+{
+public:
+    /* Box shader takes unit cube position at location 0 and has
+     * "viewProjection", "boxMin" and "boxMax" uniforms
+     */
+    explicit OcclusionQueries(const ShaderProgramPtr& boxShader);
+    ~OcclusionQueries();
+
+    OcclusionQueries(const OcclusionQueries&) = delete;
+
+    /* Draws models[candidates] (usually frustum culling result). State is
+     * kept per index in models, so indices must be stable between frames.
+     */
+    void Draw(const glm::mat4& viewProjection,
+        const std::vector<Model3dPtr>& models,
+        const std::vector<int>& candidates);
+
+    /* Without conditional rendering hidden models are not drawn at all
+     * until a query says otherwise, so they appear one frame late
+     */
+    void SetConditionalRendering(bool value) { m_conditionalRendering = value; }
+    bool GetConditionalRendering() const { return m_conditionalRendering; }
+
+    // Forgets all results, every model is visible in the next frame
+    void Reset();
+
+    const OcclusionQueryStats& GetStats() const { return m_stats; }
+
+private:
+    struct ModelState
+    {
+        ModelState() :
+            m_query(0),
+            m_lastFrame(0),
+            m_nextQueryFrame(0),
+            m_hiddenResults(0),
+            m_pending(false),
+            m_visible(true)
+        {}
+
+        GLuint m_query;
+        uint32_t m_lastFrame;
+        uint32_t m_nextQueryFrame;
+        int m_hiddenResults;
+        bool m_pending;
+        bool m_visible;
+    };
+
+    void ReadResult(ModelState& state, int modelIndex);
+    void BeginQuery(ModelState& state);
+    void EndQuery(ModelState& state);
+
+    ShaderProgramPtr m_boxShader;
+    ElementBufferObjectPtr m_box;
+    GLuint m_viewProjectionLoc;
+    GLuint m_boxMinLoc;
+    GLuint m_boxMaxLoc;
+
+    std::vector<ModelState> m_states;
+    uint32_t m_frame;
+    bool m_conditionalRendering;
+    OcclusionQueryStats m_stats;
+
+    std::vector<int> m_visible;
+    std::vector<int> m_hidden;
+};
\ No newline at end of file
@@ -0,0 +1,412 @@
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <fstream>
+#include <memory>
+#include <queue>
+#include <utility>
+
+#include "Render/GLState.h"
+#include "Scene/PointCloud.h"
+
+namespace
+{
+    // Requests older than a frame are dropped, so the queue stays short
+    const size_t kMaxRequests = 16;
+
+    static float GetDistance(const BoundingBox3f& box, const glm::vec3& point)
+    {
+        float distanceSquared = 0.0f;
+
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            const float outside = std::max(std::max(box.min[axis] - point[axis],
+                point[axis] - box.max[axis]), 0.0f);
+            distanceSquared += outside * outside;
+        }
+
+        return std::sqrt(distanceSquared);
+    }
+}
+
+PointCloud::PointCloud() :
+    m_pointsBudget(1 << 23),
+    m_frame(0),
+    m_loading(-1),
+    m_exit(false)
+{
+    m_stats = PointCloudStats();
+}
+
+PointCloud::~PointCloud()
+{
+    Close();
+}
+
+bool PointCloud::Open(const std::string& indexPath, std::ostream* logstream)
+{
+    Close();
+
+    if (!XPointCloud::LoadIndex(indexPath, &m_nodes, logstream))
+    {
+        return false;
+    }
+
+    m_indexPath = indexPath;
+    m_states.assign(m_nodes.size(), NodeState());
+    m_exit = false;
+    m_loader = std::thread(&PointCloud::LoaderLoop, this);
+
+    return true;
+}
+
+const BoundingBox3f& PointCloud::GetBounds() const
+{
+    return m_nodes.empty() ? BoundingBox3f::kInvalid : m_nodes[0].m_bounds;
+}
+
+void PointCloud::Close()
+{
+    if (m_loader.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_exit = true;
+        }
+
+        m_condition.notify_all();
+        m_loader.join();
+    }
+
+    for (size_t node = 0; node < m_states.size(); ++node)
+    {
+        Release(static_cast<int>(node));
+    }
+
+    m_nodes.clear();
+    m_states.clear();
+    m_drawList.clear();
+    m_requests.clear();
+    m_loaded.clear();
+    m_loading = -1;
+    m_stats = PointCloudStats();
+}
+
+void PointCloud::Update(const Camera& camera, float screenHeight, float maxPixelSpacing)
+{
+    m_drawList.clear();
+
+    if (m_nodes.empty())
+    {
+        return;
+    }
+
+    ++m_frame;
+    UploadLoaded();
+
+    const Frustum frustum = camera.GetFrustum();
+    const glm::vec3& cameraPosition = camera.GetPosition();
+
+    // Pixels covered by unit length at unit distance
+    const float spacingScale = screenHeight /
+        (2.0f * std::tan(glm::radians(camera.GetFOV()) * 0.5f));
+
+    const auto getPriority = [&](int node) -> std::pair<float, int>
+    {
+        const float distance = GetDistance(m_nodes[node].m_bounds, cameraPosition);
+        const float spacing = distance > 0.0f ?
+            m_nodes[node].m_spacing * spacingScale / distance : FLT_MAX;
+
+        return std::make_pair(spacing, node);
+    };
+
+    // Node with the largest projected spacing is refined first
+    std::priority_queue<std::pair<float, int>> queue;
+    std::vector<int> selected;
+    std::vector<int> requests;
+    uint64_t selectedPoints = 0;
+
+    if (frustum.Intersects(m_nodes[0].m_bounds))
+    {
+        m_states[0].m_visibleFrame = m_frame;
+        queue.push(getPriority(0));
+    }
+
+    while (!queue.empty())
+    {
+        const float spacing = queue.top().first;
+        const int node = queue.top().second;
+        queue.pop();
+
+        const PointCloudNode& nodeData = m_nodes[node];
+
+        if (!selected.empty() && selectedPoints + nodeData.m_pointsCount > m_pointsBudget)
+        {
+            break;
+        }
+
+        selected.push_back(node);
+        selectedPoints += nodeData.m_pointsCount;
+        m_states[node].m_usedFrame = m_frame;
+
+        if (m_states[node].m_VBO == 0 && requests.size() < kMaxRequests)
+        {
+            requests.push_back(node);
+        }
+
+        if (spacing <= maxPixelSpacing)
+        {
+            continue;
+        }
+
+        for (int child : nodeData.m_children)
+        {
+            if (child >= 0 && frustum.Intersects(m_nodes[child].m_bounds))
+            {
+                m_states[child].m_visibleFrame = m_frame;
+                queue.push(getPriority(child));
+            }
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        m_requests.clear();
+
+        for (int node : requests)
+        {
+            if (node != m_loading)
+            {
+                m_requests.push_back(node);
+            }
+        }
+    }
+
+    m_condition.notify_one();
+
+    m_stats.m_selectedNodes = static_cast<int>(selected.size());
+    m_stats.m_drawnNodes = 0;
+    m_stats.m_drawnPoints = 0;
+    m_stats.m_pendingLoads = static_cast<int>(requests.size());
+
+    for (int node : selected)
+    {
+        if (m_states[node].m_VBO == 0)
+        {
+            continue;
+        }
+
+        // Parent is hidden only when every visible child can replace it
+        bool refined = false;
+        bool covered = true;
+
+        for (int child : m_nodes[node].m_children)
+        {
+            if (child >= 0 && m_states[child].m_visibleFrame == m_frame)
+            {
+                const NodeState& childState = m_states[child];
+                refined = true;
+                covered = covered && childState.m_usedFrame == m_frame && childState.m_VBO != 0;
+            }
+        }
+
+        if (!refined || !covered)
+        {
+            m_drawList.push_back(node);
+            ++m_stats.m_drawnNodes;
+            m_stats.m_drawnPoints += m_states[node].m_pointsCount;
+        }
+    }
+
+    EvictOverBudget();
+}
+
+const PointCloud::Uniforms& PointCloud::GetUniforms(const ShaderProgramPtr& shader) const
+{
+    if (m_uniforms.m_program != shader)
+    {
+        m_uniforms.m_program = shader;
+        m_uniforms.m_model = shader->TryGetUniform<glm::mat4>("model");
+        m_uniforms.m_normalMatrix = shader->TryGetUniform<glm::mat3>("normalMatrix");
+    }
+
+    return m_uniforms;
+}
+
+void PointCloud::Draw(const IMaterialPtr& material) const
+{
+    if (m_drawList.empty())
+    {
+        return;
+    }
+
+    const ShaderProgramPtr& shader = material->GetShaderProgram();
+    shader->Use();
+
+    // Points are in world space, shaders of models may still expect matrices
+    const Uniforms& uniforms = GetUniforms(shader);
+    uniforms.m_model.Set(glm::mat4());
+    uniforms.m_normalMatrix.Set(glm::mat3());
+
+    material->PrepareContext();
+
+    for (int node : m_drawList)
+    {
+        XGLState::BindVertexArray(m_states[node].m_VAO);
+        glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(m_states[node].m_pointsCount));
+    }
+
+    XGLState::BindVertexArray(0);
+}
+
+void PointCloud::LoaderLoop()
+{
+    std::vector<std::unique_ptr<std::ifstream>> files;
+
+    for (;;)
+    {
+        LoadedNode loaded;
+
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [this]() { return m_exit || !m_requests.empty(); });
+
+            if (m_exit)
+            {
+                return;
+            }
+
+            loaded.m_node = m_requests.front();
+            m_requests.pop_front();
+            m_loading = loaded.m_node;
+        }
+
+        const PointCloudNode& node = m_nodes[loaded.m_node];
+
+        if (files.size() <= static_cast<size_t>(node.m_file))
+        {
+            files.resize(node.m_file + 1);
+        }
+
+        if (files[node.m_file] == nullptr)
+        {
+            files[node.m_file].reset(new std::ifstream(
+                XPointCloud::GetChunkFileName(m_indexPath, node.m_file), std::ifstream::binary));
+        }
+
+        std::ifstream& stream = *files[node.m_file];
+        loaded.m_points.resize(node.m_pointsCount);
+
+        stream.clear();
+        stream.seekg(static_cast<std::streamoff>(node.m_offset));
+
+        // Broken chunk is drawn empty rather than requested forever
+        if (!stream.read(reinterpret_cast<char*>(loaded.m_points.data()),
+            loaded.m_points.size() * sizeof(Vector3f)))
+        {
+            loaded.m_points.clear();
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_loaded.push_back(std::move(loaded));
+        m_loading = -1;
+    }
+}
+
+void PointCloud::UploadLoaded()
+{
+    std::vector<LoadedNode> loaded;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        loaded.swap(m_loaded);
+    }
+
+    for (const LoadedNode& node : loaded)
+    {
+        Upload(node.m_node, node.m_points);
+    }
+}
+
+void PointCloud::Upload(int node, const std::vector<Vector3f>& points)
+{
+    NodeState& state = m_states[node];
+
+    if (state.m_VBO != 0)
+    {
+        return;
+    }
+
+    glGenVertexArrays(1, &state.m_VAO);
+    glGenBuffers(1, &state.m_VBO);
+
+    XGLState::BindVertexArray(state.m_VAO);
+    XGLState::BindBuffer(GL_ARRAY_BUFFER, state.m_VBO);
+    glBufferData(GL_ARRAY_BUFFER, points.size() * sizeof(Vector3f), points.data(), GL_STATIC_DRAW);
+
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vector3f), (GLvoid*)0);
+    glEnableVertexAttribArray(0);
+
+    XGLState::BindVertexArray(0);
+    XGLState::BindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // Broken chunk comes empty, so it is not drawn
+    state.m_pointsCount = static_cast<uint32_t>(points.size());
+
+    ++m_stats.m_residentNodes;
+    m_stats.m_residentPoints += points.size();
+}
+
+void PointCloud::Release(int node)
+{
+    NodeState& state = m_states[node];
+
+    if (state.m_VBO == 0)
+    {
+        return;
+    }
+
+    XGLState::DeleteBuffers(1, &state.m_VBO);
+    XGLState::DeleteVertexArrays(1, &state.m_VAO);
+    state.m_VBO = 0;
+    state.m_VAO = 0;
+
+    --m_stats.m_residentNodes;
+    m_stats.m_residentPoints -= state.m_pointsCount;
+}
+
+void PointCloud::EvictOverBudget()
+{
+    if (m_stats.m_residentPoints <= m_pointsBudget)
+    {
+        return;
+    }
+
+    std::vector<int> unused;
+
+    for (size_t node = 0; node < m_states.size(); ++node)
+    {
+        if (m_states[node].m_VBO != 0 && m_states[node].m_usedFrame != m_frame)
+        {
+            unused.push_back(static_cast<int>(node));
+        }
+    }
+
+    // Least recently used go first
+    std::sort(unused.begin(), unused.end(), [this](int a, int b)
+    {
+        return m_states[a].m_usedFrame < m_states[b].m_usedFrame;
+    });
+
+    for (int node : unused)
+    {
+        if (m_stats.m_residentPoints <= m_pointsBudget)
+        {
+            break;
+        }
+
+        Release(node);
+    }
+}
\ No newline at end of file
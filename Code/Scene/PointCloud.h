@@ -0,0 +1,118 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Render/Camera.h"
+#include "Scene/Materials/IMaterial.h"
+#include "Scene/PointCloudOctree.h"
+
+struct PointCloudStats
+{
+    // Nodes selected for current view
+    int m_selectedNodes;
+    int m_drawnNodes;
+    uint64_t m_drawnPoints;
+    int m_residentNodes;
+    uint64_t m_residentPoints;
+    int m_pendingLoads;
+};
+
+/* Octree built by XPointCloud::Build streamed from disk. Every frame the
+ * nodes are refined by projected point spacing, most coarse first, until
+ * spacing is small enough or the budget is spent. Missing nodes are read
+ * by background thread and uploaded on the next updates, their parents
+ * are drawn meanwhile.
+ */
+class PointCloud
+{
+public:
+    PointCloud();
+    ~PointCloud();
+
+    PointCloud(const PointCloud&) = delete;
+
+    bool Open(const std::string& indexPath, std::ostream* logstream = nullptr);
+
+    // Points kept in GPU memory, 12 bytes each
+    void SetPointsBudget(uint64_t value) { m_pointsBudget = value; }
+    uint64_t GetPointsBudget() const { return m_pointsBudget; }
+
+    /* Uploads loaded nodes, selects nodes for the view, requests missing
+     * ones and frees least recently used ones over the budget. Must be
+     * called with GL context.
+     */
+    void Update(const Camera& camera, float screenHeight, float maxPixelSpacing);
+
+    // Draws selected nodes as GL_POINTS, points are in world space
+    void Draw(const IMaterialPtr& material) const;
+
+    const PointCloudStats& GetStats() const { return m_stats; }
+    const BoundingBox3f& GetBounds() const;
+
+private:
+    struct NodeState
+    {
+        NodeState() :
+            m_VAO(0),
+            m_VBO(0),
+            m_pointsCount(0),
+            m_usedFrame(0),
+            m_visibleFrame(0)
+        {}
+
+        GLuint m_VAO;
+        GLuint m_VBO;
+        uint32_t m_pointsCount;
+        uint32_t m_usedFrame;
+        uint32_t m_visibleFrame;
+    };
+
+    struct LoadedNode
+    {
+        int m_node;
+        std::vector<Vector3f> m_points;
+    };
+
+    // Resolved again when material shader changes
+    struct Uniforms
+    {
+        ShaderProgramPtr m_program;
+        ShaderUniform<glm::mat4> m_model;
+        ShaderUniform<glm::mat3> m_normalMatrix;
+    };
+
+    const Uniforms& GetUniforms(const ShaderProgramPtr& shader) const;
+
+    void Close();
+    void LoaderLoop();
+    void UploadLoaded();
+    void Upload(int node, const std::vector<Vector3f>& points);
+    void Release(int node);
+    void EvictOverBudget();
+
+    std::string m_indexPath;
+    std::vector<PointCloudNode> m_nodes;
+    std::vector<NodeState> m_states;
+    std::vector<int> m_drawList;
+
+    uint64_t m_pointsBudget;
+    uint32_t m_frame;
+    PointCloudStats m_stats;
+    mutable Uniforms m_uniforms;
+
+    // Shared with loader thread
+    std::thread m_loader;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::deque<int> m_requests;
+    std::vector<LoadedNode> m_loaded;
+    int m_loading;
+    bool m_exit;
+};
\ No newline at end of file
@@ -0,0 +1,712 @@
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+
+#include "Base/ParallelFor.h"
+#include "Parsers/pointparser.h"
+#include "Scene/PointCloudOctree.h"
+
+namespace
+{
+    const uint32_t kFileMagic = 0x314F4350; // "PCO1"
+
+    // Coincident points would be split forever
+    const int kMaxDepth = 20;
+
+    static_assert(sizeof(Vector3f) == 3 * sizeof(float), "Points are stored as float triplets");
+
+    template<typename T>
+    static void Write(std::ostream& stream, const T& value)
+    {
+        stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template<typename T>
+    static bool Read(std::istream& stream, T* value)
+    {
+        return !!stream.read(reinterpret_cast<char*>(value), sizeof(T));
+    }
+
+    static void WritePoints(std::ostream& stream, const std::vector<Vector3f>& points)
+    {
+        stream.write(reinterpret_cast<const char*>(points.data()),
+            points.size() * sizeof(Vector3f));
+    }
+
+    static bool ReadPoints(std::istream& stream, uint64_t offset, uint32_t count,
+        std::vector<Vector3f>* points)
+    {
+        const size_t first = points->size();
+        points->resize(first + count);
+
+        stream.seekg(static_cast<std::streamoff>(offset));
+
+        return !!stream.read(reinterpret_cast<char*>(points->data() + first),
+            count * sizeof(Vector3f));
+    }
+
+    static int GetOctant(const Vector3f& point, const Vector3f& center)
+    {
+        return
+            (point.x() >= center.x() ? 1 : 0) |
+            (point.y() >= center.y() ? 2 : 0) |
+            (point.z() >= center.z() ? 4 : 0);
+    }
+
+    static BoundingBox3f GetOctantBounds(const BoundingBox3f& bounds, int octant)
+    {
+        const Vector3f center = bounds.GetCenter();
+        BoundingBox3f result(bounds);
+
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            if ((octant >> axis) & 1)
+            {
+                result.min[axis] = center[axis];
+            }
+            else
+            {
+                result.max[axis] = center[axis];
+            }
+        }
+
+        return result;
+    }
+
+    static int GetGridSize(const PointCloudBuildSettings& settings)
+    {
+        // Even size keeps every grid cell inside one octant
+        const int size = static_cast<int>(std::cbrt(static_cast<float>(settings.m_pointsPerNode)));
+        return std::max(2, size & ~1);
+    }
+
+    // Keeps the first point in every cell of grid x grid x grid
+    static void GridSample(const std::vector<Vector3f>& points, const BoundingBox3f& bounds,
+        int grid, std::vector<Vector3f>* result)
+    {
+        std::vector<uint8_t> occupied(grid * grid * grid, 0);
+        const float scale = grid / (bounds.max.x() - bounds.min.x());
+
+        for (const Vector3f& point : points)
+        {
+            int cell[3];
+
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                const int coord = static_cast<int>((point[axis] - bounds.min[axis]) * scale);
+                cell[axis] = std::min(std::max(coord, 0), grid - 1);
+            }
+
+            uint8_t& flag = occupied[cell[0] + grid * (cell[1] + grid * cell[2])];
+
+            if (flag == 0)
+            {
+                flag = 1;
+                result->push_back(point);
+            }
+        }
+    }
+
+    static PointCloudNode MakeNode(const BoundingBox3f& bounds)
+    {
+        PointCloudNode node;
+        node.m_bounds = bounds;
+        node.m_spacing = 0.0f;
+        node.m_file = 0;
+        node.m_pointsCount = 0;
+        node.m_offset = 0;
+
+        std::fill(node.m_children, node.m_children + 8, -1);
+
+        return node;
+    }
+
+    // Reads source file with the parser or raw float triplets of a spilled octant
+    class PointReader
+    {
+    public:
+        bool Open(const std::string& fileName, bool source, std::ostream* logstream)
+        {
+            m_source = source;
+
+            if (source)
+            {
+                return m_parser.Open(fileName, logstream) == points::ParseErrorCode::Ok;
+            }
+
+            m_raw.open(fileName, std::ifstream::binary);
+            return m_raw.good();
+        }
+
+        // Replaces content of points, zero means end of file
+        size_t Read(size_t maxCount, std::vector<Vector3f>* points)
+        {
+            points->clear();
+
+            if (m_source)
+            {
+                return m_parser.Read(maxCount, points);
+            }
+
+            points->resize(maxCount);
+            m_raw.read(reinterpret_cast<char*>(points->data()), maxCount * sizeof(Vector3f));
+            points->resize(static_cast<size_t>(m_raw.gcount()) / sizeof(Vector3f));
+
+            return points->size();
+        }
+
+    private:
+        bool m_source;
+        points::PointParser m_parser;
+        std::ifstream m_raw;
+    };
+
+    // Points of an octree node waiting to be split or built
+    struct Chunk
+    {
+        int m_node;
+        int m_depth;
+        uint64_t m_pointsCount;
+        std::string m_file;
+        bool m_source;
+    };
+
+    class OctreeBuilder
+    {
+    public:
+        OctreeBuilder(const std::string& outputPath, const PointCloudBuildSettings& settings,
+            std::ostream* logstream) :
+            m_outputPath(outputPath),
+            m_settings(settings),
+            m_grid(GetGridSize(settings)),
+            m_logstream(logstream)
+        {
+        }
+
+        bool Build(const std::string& sourceFile)
+        {
+            BoundingBox3f bounds(BoundingBox3f::kInvalid);
+            uint64_t pointsCount = 0;
+
+            if (!ComputeBounds(sourceFile, &bounds, &pointsCount))
+            {
+                return false;
+            }
+
+            // Cube keeps octants cubic, so spacing is the same along all axes
+            const Vector3f center = bounds.GetCenter();
+            const Vector3f size = bounds.max - bounds.min;
+            const float halfSize = std::max(size.maxCoeff() * 0.5f * 1.001f, 1.0e-3f);
+            const Vector3f half(halfSize, halfSize, halfSize);
+
+            m_nodes.push_back(MakeNode(BoundingBox3f(center - half, center + half)));
+
+            Chunk root;
+            root.m_node = 0;
+            root.m_depth = 0;
+            root.m_pointsCount = pointsCount;
+            root.m_file = sourceFile;
+            root.m_source = true;
+
+            if (!Partition(root))
+            {
+                return false;
+            }
+
+            if (!BuildJobs() || !BuildUpperNodes())
+            {
+                return false;
+            }
+
+            return WriteIndex();
+        }
+
+    private:
+        bool ComputeBounds(const std::string& sourceFile, BoundingBox3f* bounds, uint64_t* pointsCount)
+        {
+            PointReader reader;
+
+            if (!reader.Open(sourceFile, true, m_logstream))
+            {
+                return Fail(sourceFile, "CAN_NOT_OPEN");
+            }
+
+            std::vector<Vector3f> batch;
+
+            while (reader.Read(m_settings.m_batchSize, &batch) > 0)
+            {
+                *bounds += ArrayView<const Vector3f>(batch.data(), static_cast<int>(batch.size()));
+                *pointsCount += batch.size();
+            }
+
+            if (*pointsCount == 0)
+            {
+                return Fail(sourceFile, "NO_POINTS");
+            }
+
+            return true;
+        }
+
+        /* Spills octants of too large chunks to temporary files until all
+         * of them can be built in memory by build threads at once
+         */
+        bool Partition(const Chunk& rootChunk)
+        {
+            const uint64_t jobLimit = std::max<uint64_t>(m_settings.m_pointsPerNode,
+                m_settings.m_maxPointsInMemory / GetWorkerThreadsCount());
+
+            std::vector<Chunk> stack(1, rootChunk);
+
+            while (!stack.empty())
+            {
+                const Chunk chunk = stack.back();
+                stack.pop_back();
+
+                if (chunk.m_pointsCount <= jobLimit || chunk.m_depth >= kMaxDepth)
+                {
+                    m_jobs.push_back(chunk);
+                    continue;
+                }
+
+                Chunk children[8];
+
+                if (!Split(chunk, children))
+                {
+                    return false;
+                }
+
+                m_splitNodes.push_back(chunk.m_node);
+
+                for (const Chunk& child : children)
+                {
+                    if (child.m_pointsCount > 0)
+                    {
+                        stack.push_back(child);
+                    }
+                }
+            }
+
+            return true;
+        }
+
+        bool Split(const Chunk& chunk, Chunk* children)
+        {
+            PointReader reader;
+
+            if (!reader.Open(chunk.m_file, chunk.m_source, m_logstream))
+            {
+                return Fail(chunk.m_file, "CAN_NOT_OPEN");
+            }
+
+            const BoundingBox3f bounds = m_nodes[chunk.m_node].m_bounds;
+            const Vector3f center = bounds.GetCenter();
+
+            std::unique_ptr<std::ofstream> streams[8];
+            std::vector<Vector3f> buffers[8];
+            std::vector<Vector3f> batch;
+
+            for (int octant = 0; octant < 8; ++octant)
+            {
+                children[octant].m_node = -1;
+                children[octant].m_depth = chunk.m_depth + 1;
+                children[octant].m_pointsCount = 0;
+                children[octant].m_source = false;
+            }
+
+            const auto flush = [&](int octant) -> bool
+            {
+                Chunk& child = children[octant];
+
+                if (streams[octant] == nullptr)
+                {
+                    child.m_node = static_cast<int>(m_nodes.size());
+                    child.m_file = m_outputPath + ".tmp" + std::to_string(child.m_node);
+
+                    m_nodes.push_back(MakeNode(GetOctantBounds(bounds, octant)));
+                    m_nodes[chunk.m_node].m_children[octant] = child.m_node;
+
+                    streams[octant].reset(new std::ofstream(child.m_file, std::ofstream::binary));
+                }
+
+                WritePoints(*streams[octant], buffers[octant]);
+                child.m_pointsCount += buffers[octant].size();
+                buffers[octant].clear();
+
+                return streams[octant]->good();
+            };
+
+            while (reader.Read(m_settings.m_batchSize, &batch) > 0)
+            {
+                for (const Vector3f& point : batch)
+                {
+                    const int octant = GetOctant(point, center);
+                    buffers[octant].push_back(point);
+
+                    if (buffers[octant].size() >= static_cast<size_t>(m_settings.m_batchSize) &&
+                        !flush(octant))
+                    {
+                        return Fail(children[octant].m_file, "CAN_NOT_WRITE");
+                    }
+                }
+            }
+
+            for (int octant = 0; octant < 8; ++octant)
+            {
+                if (!buffers[octant].empty() && !flush(octant))
+                {
+                    return Fail(children[octant].m_file, "CAN_NOT_WRITE");
+                }
+            }
+
+            if (!chunk.m_source)
+            {
+                std::remove(chunk.m_file.c_str());
+            }
+
+            return true;
+        }
+
+        // Every job builds its subtree into its own chunk file, file 0 is for upper nodes
+        bool BuildJobs()
+        {
+            std::vector<std::vector<PointCloudNode>> subtrees(m_jobs.size());
+            std::vector<uint8_t> succeeded(m_jobs.size(), 0);
+            std::atomic<size_t> nextJob(0);
+
+            // Jobs differ in size a lot, so threads take them one by one
+            ParallelFor(std::min(GetWorkerThreadsCount(), m_jobs.size()), 1,
+                [&](size_t, size_t)
+            {
+                for (size_t job = nextJob++; job < m_jobs.size(); job = nextJob++)
+                {
+                    succeeded[job] = BuildJob(job, &subtrees[job]) ? 1 : 0;
+                }
+            });
+
+            for (size_t job = 0; job < m_jobs.size(); ++job)
+            {
+                if (succeeded[job] == 0)
+                {
+                    return Fail(m_jobs[job].m_file, "CAN_NOT_BUILD");
+                }
+
+                // Job root replaces its node, the rest is appended
+                const std::vector<PointCloudNode>& subtree = subtrees[job];
+                const int base = static_cast<int>(m_nodes.size()) - 1;
+
+                for (size_t i = 0; i < subtree.size(); ++i)
+                {
+                    PointCloudNode node = subtree[i];
+
+                    for (int& child : node.m_children)
+                    {
+                        child = child >= 0 ? child + base : -1;
+                    }
+
+                    if (i == 0)
+                    {
+                        m_nodes[m_jobs[job].m_node] = node;
+                    }
+                    else
+                    {
+                        m_nodes.push_back(node);
+                    }
+                }
+            }
+
+            return true;
+        }
+
+        bool BuildJob(size_t job, std::vector<PointCloudNode>* subtree) const
+        {
+            const Chunk& chunk = m_jobs[job];
+            std::vector<Vector3f> points;
+            points.reserve(static_cast<size_t>(chunk.m_pointsCount));
+
+            {
+                PointReader reader;
+
+                if (!reader.Open(chunk.m_file, chunk.m_source, nullptr))
+                {
+                    return false;
+                }
+
+                std::vector<Vector3f> batch;
+
+                while (reader.Read(m_settings.m_batchSize, &batch) > 0)
+                {
+                    points.insert(points.end(), batch.begin(), batch.end());
+                }
+            }
+
+            if (!chunk.m_source)
+            {
+                std::remove(chunk.m_file.c_str());
+            }
+
+            const int file = static_cast<int>(job) + 1;
+            std::ofstream stream(XPointCloud::GetChunkFileName(m_outputPath, file), std::ofstream::binary);
+
+            if (!stream.good())
+            {
+                return false;
+            }
+
+            std::vector<Vector3f> rootPoints;
+            BuildSubtree(&points, 0, points.size(), m_nodes[chunk.m_node].m_bounds,
+                chunk.m_depth, file, stream, subtree, &rootPoints);
+
+            return stream.good();
+        }
+
+        // Returns index of the node in subtree, nodePoints receives points kept by it
+        int BuildSubtree(std::vector<Vector3f>* points, size_t begin, size_t end,
+            const BoundingBox3f& bounds, int depth, int file, std::ofstream& stream,
+            std::vector<PointCloudNode>* subtree, std::vector<Vector3f>* nodePoints) const
+        {
+            const int index = static_cast<int>(subtree->size());
+            subtree->push_back(MakeNode(bounds));
+
+            if (end - begin <= static_cast<size_t>(m_settings.m_pointsPerNode) || depth >= kMaxDepth)
+            {
+                nodePoints->assign(points->begin() + begin, points->begin() + end);
+            }
+            else
+            {
+                const Vector3f center = bounds.GetCenter();
+
+                const auto partition = [&](size_t first, size_t last, int axis) -> size_t
+                {
+                    return std::partition(points->begin() + first, points->begin() + last,
+                        [&center, axis](const Vector3f& point) { return point[axis] < center[axis]; }) -
+                        points->begin();
+                };
+
+                // Octant o is [ranges[o], ranges[o + 1]), o = x + 2y + 4z
+                const size_t z = partition(begin, end, 2);
+                const size_t y0 = partition(begin, z, 1);
+                const size_t y1 = partition(z, end, 1);
+                const size_t ranges[9] = { begin, partition(begin, y0, 0), y0, partition(y0, z, 0),
+                    z, partition(z, y1, 0), y1, partition(y1, end, 0), end };
+
+                std::vector<Vector3f> childrenPoints;
+                std::vector<Vector3f> childPoints;
+
+                for (int octant = 0; octant < 8; ++octant)
+                {
+                    if (ranges[octant] == ranges[octant + 1])
+                    {
+                        continue;
+                    }
+
+                    childPoints.clear();
+
+                    const int child = BuildSubtree(points, ranges[octant], ranges[octant + 1],
+                        GetOctantBounds(bounds, octant), depth + 1, file, stream, subtree, &childPoints);
+
+                    (*subtree)[index].m_children[octant] = child;
+                    childrenPoints.insert(childrenPoints.end(), childPoints.begin(), childPoints.end());
+                }
+
+                GridSample(childrenPoints, bounds, m_grid, nodePoints);
+            }
+
+            PointCloudNode& node = (*subtree)[index];
+            node.m_spacing = (bounds.max.x() - bounds.min.x()) / m_grid;
+            node.m_file = file;
+            node.m_pointsCount = static_cast<uint32_t>(nodePoints->size());
+            node.m_offset = static_cast<uint64_t>(stream.tellp());
+
+            WritePoints(stream, *nodePoints);
+
+            return index;
+        }
+
+        // Split nodes are sampled from their children, children go first
+        bool BuildUpperNodes()
+        {
+            const std::string fileName = XPointCloud::GetChunkFileName(m_outputPath, 0);
+            std::ofstream stream(fileName, std::ofstream::binary);
+
+            if (!stream.good())
+            {
+                return Fail(fileName, "CAN_NOT_WRITE");
+            }
+
+            std::vector<std::vector<Vector3f>> upperPoints(m_nodes.size());
+            std::vector<Vector3f> childrenPoints;
+
+            for (auto it = m_splitNodes.rbegin(); it != m_splitNodes.rend(); ++it)
+            {
+                PointCloudNode& node = m_nodes[*it];
+                childrenPoints.clear();
+
+                for (int child : node.m_children)
+                {
+                    if (child < 0)
+                    {
+                        continue;
+                    }
+
+                    if (!upperPoints[child].empty())
+                    {
+                        childrenPoints.insert(childrenPoints.end(),
+                            upperPoints[child].begin(), upperPoints[child].end());
+
+                        std::vector<Vector3f>().swap(upperPoints[child]);
+                        continue;
+                    }
+
+                    const PointCloudNode& childNode = m_nodes[child];
+                    const std::string childFile = XPointCloud::GetChunkFileName(m_outputPath, childNode.m_file);
+                    std::ifstream childStream(childFile, std::ifstream::binary);
+
+                    if (!ReadPoints(childStream, childNode.m_offset, childNode.m_pointsCount, &childrenPoints))
+                    {
+                        return Fail(childFile, "CAN_NOT_READ");
+                    }
+                }
+
+                std::vector<Vector3f>& nodePoints = upperPoints[*it];
+                GridSample(childrenPoints, node.m_bounds, m_grid, &nodePoints);
+
+                node.m_spacing = (node.m_bounds.max.x() - node.m_bounds.min.x()) / m_grid;
+                node.m_file = 0;
+                node.m_pointsCount = static_cast<uint32_t>(nodePoints.size());
+                node.m_offset = static_cast<uint64_t>(stream.tellp());
+
+                WritePoints(stream, nodePoints);
+            }
+
+            return stream.good() ? true : Fail(fileName, "CAN_NOT_WRITE");
+        }
+
+        bool WriteIndex()
+        {
+            std::ofstream stream(m_outputPath, std::ofstream::binary);
+
+            Write(stream, kFileMagic);
+            Write(stream, static_cast<uint32_t>(m_nodes.size()));
+
+            for (const PointCloudNode& node : m_nodes)
+            {
+                for (int axis = 0; axis < 3; ++axis)
+                {
+                    Write(stream, node.m_bounds.min[axis]);
+                    Write(stream, node.m_bounds.max[axis]);
+                }
+
+                Write(stream, node.m_spacing);
+
+                for (int child : node.m_children)
+                {
+                    Write(stream, static_cast<int32_t>(child));
+                }
+
+                Write(stream, static_cast<int32_t>(node.m_file));
+                Write(stream, node.m_pointsCount);
+                Write(stream, node.m_offset);
+            }
+
+            return stream.good() ? true : Fail(m_outputPath, "CAN_NOT_WRITE");
+        }
+
+        bool Fail(const std::string& fileName, const char* reason) const
+        {
+            if (m_logstream != nullptr)
+            {
+                *m_logstream << "ERROR::POINT_CLOUD::" << fileName << "::" << reason << std::endl;
+            }
+
+            return false;
+        }
+
+        std::string m_outputPath;
+        PointCloudBuildSettings m_settings;
+        int m_grid;
+        std::ostream* m_logstream;
+
+        std::vector<PointCloudNode> m_nodes;
+        // Chunks small enough to be built in memory
+        std::vector<Chunk> m_jobs;
+        // Nodes spilled to disk, in order of splitting
+        std::vector<int> m_splitNodes;
+    };
+}
+
+namespace XPointCloud {
+
+    bool Build(const std::string& sourceFile, const std::string& outputPath,
+        const PointCloudBuildSettings& settings, std::ostream* logstream)
+    {
+        assert(settings.m_pointsPerNode > 0 && settings.m_batchSize > 0);
+
+        OctreeBuilder builder(outputPath, settings, logstream);
+        return builder.Build(sourceFile);
+    }
+
+    bool LoadIndex(const std::string& indexPath, std::vector<PointCloudNode>* nodes,
+        std::ostream* logstream)
+    {
+        std::ifstream stream(indexPath, std::ifstream::binary);
+
+        uint32_t magic = 0;
+        uint32_t nodesCount = 0;
+        bool valid = Read(stream, &magic) && magic == kFileMagic && Read(stream, &nodesCount);
+
+        nodes->clear();
+
+        for (uint32_t i = 0; valid && i < nodesCount; ++i)
+        {
+            PointCloudNode node;
+            node.m_bounds = BoundingBox3f::kInvalid;
+
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                valid = valid &&
+                    Read(stream, &node.m_bounds.min[axis]) &&
+                    Read(stream, &node.m_bounds.max[axis]);
+            }
+
+            valid = valid && Read(stream, &node.m_spacing);
+
+            for (int& child : node.m_children)
+            {
+                int32_t value = -1;
+                valid = valid && Read(stream, &value) && value < static_cast<int32_t>(nodesCount);
+                child = value;
+            }
+
+            int32_t file = 0;
+            valid = valid && Read(stream, &file) && Read(stream, &node.m_pointsCount) &&
+                Read(stream, &node.m_offset);
+            node.m_file = file;
+
+            nodes->push_back(node);
+        }
+
+        if (!valid || nodes->empty())
+        {
+            nodes->clear();
+
+            if (logstream != nullptr)
+            {
+                *logstream << "ERROR::POINT_CLOUD::" << indexPath << "::INVALID_FILE" << std::endl;
+            }
+
+            return false;
+        }
+
+        return true;
+    }
+
+    std::string GetChunkFileName(const std::string& indexPath, int file)
+    {
+        return indexPath + "." + std::to_string(file);
+    }
+
+}
\ No newline at end of file
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "Base/Geom/BoundingBox.h"
+
+struct PointCloudBuildSettings
+{
+    PointCloudBuildSettings() :
+        m_pointsPerNode(1 << 15),
+        m_maxPointsInMemory(1 << 24),
+        m_batchSize(1 << 18)
+    {}
+
+    /* Leaves keep up to this many points, inner nodes keep a grid
+     * subsample of their children of about the same size
+     */
+    int m_pointsPerNode;
+    // Points loaded by all build threads together, bounds peak RAM usage
+    uint64_t m_maxPointsInMemory;
+    // Points read or written with one file operation
+    int m_batchSize;
+};
+
+/* Node of point cloud octree. Every node has points of its own, children
+ * refine them (replacement LOD), so a cut through the tree is drawn.
+ */
+struct PointCloudNode
+{
+    // Cube of the node
+    BoundingBox3f m_bounds;
+    // Distance between neighbour points of the node
+    float m_spacing;
+    // Index of child by octant (x + 2y + 4z), -1 if empty
+    int m_children[8];
+    // Points are m_pointsCount float triplets at m_offset in chunk file
+    int m_file;
+    uint32_t m_pointsCount;
+    uint64_t m_offset;
+};
+
+namespace XPointCloud {
+
+    /* Converts points of OBJ or binary PLY file to octree stored as index
+     * file at outputPath and chunk files next to it. Source is streamed,
+     * too large octants are spilled to temporary files until they fit the
+     * memory limit, then subtrees are built in parallel.
+     */
+    bool Build(const std::string& sourceFile, const std::string& outputPath,
+        const PointCloudBuildSettings& settings = PointCloudBuildSettings(),
+        std::ostream* logstream = nullptr);
+
+    // Root node is the first one
+    bool LoadIndex(const std::string& indexPath, std::vector<PointCloudNode>* nodes,
+        std::ostream* logstream = nullptr);
+
+    std::string GetChunkFileName(const std::string& indexPath, int file);
+
+}
\ No newline at end of file
@@ -0,0 +1,388 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <fstream>
+
+#include "Base/ParallelFor.h"
+#include "Base/Geom/TriangleBVH.h"
+#include "Scene/PotentiallyVisibleSet.h"
+
+namespace
+{
+    const uint32_t kFileMagic = 0x31535650; // "PVS1"
+
+    // Rays may miss the target by a little when it lies on triangle edge
+    const float kTargetTolerance = 1.0e-3f;
+
+    static float HashToUnit(uint32_t value)
+    {
+        value ^= value >> 16;
+        value *= 0x7feb352du;
+        value ^= value >> 15;
+        value *= 0x846ca68bu;
+        value ^= value >> 16;
+        return static_cast<float>(value >> 8) * (1.0f / 16777216.0f);
+    }
+
+    // Nonzero bytes are stored as is, run of zero bytes as zero and run length
+    static void Compress(const std::vector<uint8_t>& bits, std::vector<uint8_t>* result)
+    {
+        for (size_t i = 0; i < bits.size(); ++i)
+        {
+            if (bits[i] != 0)
+            {
+                result->push_back(bits[i]);
+                continue;
+            }
+
+            uint8_t run = 1;
+
+            while (i + 1 < bits.size() && bits[i + 1] == 0 && run < 255)
+            {
+                ++run;
+                ++i;
+            }
+
+            result->push_back(0);
+            result->push_back(run);
+        }
+    }
+
+    template<typename T>
+    static void Write(std::ostream& stream, const T& value)
+    {
+        stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template<typename T>
+    static bool Read(std::istream& stream, T* value)
+    {
+        return !!stream.read(reinterpret_cast<char*>(value), sizeof(T));
+    }
+}
+
+PotentiallyVisibleSet::PotentiallyVisibleSet() :
+    m_bounds(BoundingBox3f::kInvalid),
+    m_modelsCount(0),
+    m_cachedCell(-1)
+{
+    m_cells[0] = m_cells[1] = m_cells[2] = 0;
+}
+
+void PotentiallyVisibleSet::Bake(const std::vector<Model3dPtr>& models,
+    const BoundingBox3f& bounds, const PvsBakeSettings& settings)
+{
+    assert(bounds.IsValid() && settings.m_cellSize > 0.0f);
+
+    m_bounds = bounds;
+    m_modelsCount = static_cast<int>(models.size());
+    m_cachedCell = -1;
+
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        const float size = bounds.max[axis] - bounds.min[axis];
+        m_cells[axis] = std::max(1, static_cast<int>(std::ceil(size / settings.m_cellSize)));
+    }
+
+    // All models in world space, triangle index gives the model
+    std::vector<Vector3f> positions;
+    std::vector<int> indices;
+    std::vector<int> triangleOffsets(models.size() + 1, 0);
+
+    for (size_t i = 0; i < models.size(); ++i)
+    {
+        const MeshDataPtr& meshData = models[i]->GetMeshData();
+        const ArrayView<const Vector3f> localPositions =
+            meshData->GetVertexData()->GetFieldView<VertexBlobField::Pos>();
+        const std::vector<int>& localIndices = meshData->GetIndexData()->GetData();
+        const glm::mat4& matrix = models[i]->GetMatrix();
+
+        const int baseVertex = static_cast<int>(positions.size());
+
+        for (int vertex = 0; vertex < localPositions.size(); ++vertex)
+        {
+            const Vector3f& p = localPositions[vertex];
+            const glm::vec4 world = matrix * glm::vec4(p.x(), p.y(), p.z(), 1.0f);
+            positions.push_back(Vector3f(world.x, world.y, world.z));
+        }
+
+        for (int index : localIndices)
+        {
+            indices.push_back(baseVertex + index);
+        }
+
+        triangleOffsets[i + 1] = static_cast<int>(indices.size() / 3);
+    }
+
+    const TriangleBVH bvh(ArrayView<const Vector3f>(positions.data(),
+        static_cast<int>(positions.size())), indices);
+
+    const int cellsCount = GetCellsCount();
+    const size_t bytesPerCell = (models.size() + 7) / 8;
+    std::vector<std::vector<uint8_t>> compressed(static_cast<size_t>(cellsCount));
+
+    ParallelFor(static_cast<size_t>(cellsCount), 1, [&](size_t begin, size_t end)
+    {
+        std::vector<uint8_t> bits(bytesPerCell);
+
+        for (size_t cell = begin; cell < end; ++cell)
+        {
+            std::fill(bits.begin(), bits.end(), 0);
+
+            const BoundingBox3f cellBounds = GetCellBounds(static_cast<int>(cell));
+            const Vector3f cellSize = cellBounds.max - cellBounds.min;
+
+            for (int model = 0; model < m_modelsCount; ++model)
+            {
+                const int firstTriangle = triangleOffsets[model];
+                const int trianglesCount = triangleOffsets[model + 1] - firstTriangle;
+
+                for (int ray = 0; ray < settings.m_raysPerModel && trianglesCount > 0; ++ray)
+                {
+                    // Occluders found by earlier rays may have made it visible already
+                    if ((bits[model >> 3] & (1 << (model & 7))) != 0)
+                    {
+                        break;
+                    }
+
+                    const uint32_t seed = (static_cast<uint32_t>(cell) * 0x9e3779b9u) ^
+                        (static_cast<uint32_t>(model) * 0x85ebca6bu) ^
+                        (static_cast<uint32_t>(ray) * 0xc2b2ae35u);
+
+                    const Vector3f origin = cellBounds.min + Vector3f(
+                        cellSize.x() * HashToUnit(seed),
+                        cellSize.y() * HashToUnit(seed + 1),
+                        cellSize.z() * HashToUnit(seed + 2));
+
+                    // Uniform point on a random triangle
+                    const int triangle = firstTriangle + std::min(trianglesCount - 1,
+                        static_cast<int>(HashToUnit(seed + 3) * trianglesCount));
+
+                    float u = HashToUnit(seed + 4);
+                    float v = HashToUnit(seed + 5);
+
+                    if (u + v > 1.0f)
+                    {
+                        u = 1.0f - u;
+                        v = 1.0f - v;
+                    }
+
+                    const Vector3f& a = positions[indices[triangle * 3]];
+                    const Vector3f& b = positions[indices[triangle * 3 + 1]];
+                    const Vector3f& c = positions[indices[triangle * 3 + 2]];
+                    const Vector3f target = a + (b - a) * u + (c - a) * v;
+
+                    // Target is at distance one along not normalized direction
+                    RayHit hit;
+                    int visibleModel = model;
+
+                    if (bvh.Intersect(Ray(origin, target - origin), 1.0f + kTargetTolerance, &hit))
+                    {
+                        visibleModel = static_cast<int>(std::upper_bound(triangleOffsets.begin(),
+                            triangleOffsets.end(), hit.m_triangle) - triangleOffsets.begin()) - 1;
+                    }
+
+                    bits[visibleModel >> 3] |= static_cast<uint8_t>(1 << (visibleModel & 7));
+                }
+            }
+
+            Compress(bits, &compressed[cell]);
+        }
+    });
+
+    m_cellOffsets.resize(static_cast<size_t>(cellsCount) + 1);
+    m_cellOffsets[0] = 0;
+    m_data.clear();
+
+    for (int cell = 0; cell < cellsCount; ++cell)
+    {
+        m_data.insert(m_data.end(), compressed[cell].begin(), compressed[cell].end());
+        m_cellOffsets[cell + 1] = static_cast<uint32_t>(m_data.size());
+    }
+}
+
+bool PotentiallyVisibleSet::Save(const char* fileName, std::ostream* logstream) const
+{
+    std::ofstream stream(fileName, std::ofstream::binary);
+
+    if (!stream)
+    {
+        if (logstream != nullptr)
+        {
+            *logstream << "ERROR::PVS::" << fileName << "::CAN_NOT_OPEN" << std::endl;
+        }
+
+        return false;
+    }
+
+    Write(stream, kFileMagic);
+
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        Write(stream, m_bounds.min[axis]);
+        Write(stream, m_bounds.max[axis]);
+        Write(stream, m_cells[axis]);
+    }
+
+    Write(stream, m_modelsCount);
+    Write(stream, static_cast<uint32_t>(m_data.size()));
+
+    stream.write(reinterpret_cast<const char*>(m_cellOffsets.data()),
+        m_cellOffsets.size() * sizeof(uint32_t));
+    stream.write(reinterpret_cast<const char*>(m_data.data()), m_data.size());
+
+    return !!stream;
+}
+
+bool PotentiallyVisibleSet::Load(const char* fileName, std::ostream* logstream)
+{
+    std::ifstream stream(fileName, std::ifstream::binary);
+
+    uint32_t magic = 0;
+    BoundingBox3f bounds;
+    int cells[3] = { 0, 0, 0 };
+    int modelsCount = 0;
+    uint32_t dataSize = 0;
+
+    bool valid = stream && Read(stream, &magic) && magic == kFileMagic;
+
+    for (int axis = 0; axis < 3 && valid; ++axis)
+    {
+        valid = Read(stream, &bounds.min[axis]) && Read(stream, &bounds.max[axis]) &&
+            Read(stream, &cells[axis]) && cells[axis] > 0;
+    }
+
+    valid = valid && Read(stream, &modelsCount) && modelsCount >= 0 && Read(stream, &dataSize);
+
+    std::vector<uint32_t> cellOffsets;
+    std::vector<uint8_t> data;
+
+    if (valid)
+    {
+        cellOffsets.resize(static_cast<size_t>(cells[0]) * cells[1] * cells[2] + 1);
+        data.resize(dataSize);
+
+        valid =
+            stream.read(reinterpret_cast<char*>(cellOffsets.data()), cellOffsets.size() * sizeof(uint32_t)) &&
+            stream.read(reinterpret_cast<char*>(data.data()), data.size()) &&
+            cellOffsets.back() == dataSize;
+
+        // Cell data must not overlap or leave the data block
+        valid = valid && std::is_sorted(cellOffsets.begin(), cellOffsets.end());
+    }
+
+    if (!valid)
+    {
+        if (logstream != nullptr)
+        {
+            *logstream << "ERROR::PVS::" << fileName << "::INVALID_FILE" << std::endl;
+        }
+
+        return false;
+    }
+
+    m_bounds = bounds;
+    std::copy(cells, cells + 3, m_cells);
+    m_modelsCount = modelsCount;
+    m_cellOffsets.swap(cellOffsets);
+    m_data.swap(data);
+    m_cachedCell = -1;
+
+    return true;
+}
+
+int PotentiallyVisibleSet::GetCell(const glm::vec3& position) const
+{
+    if (IsEmpty())
+    {
+        return -1;
+    }
+
+    int cell = 0;
+
+    for (int axis = 2; axis >= 0; --axis)
+    {
+        const float size = m_bounds.max[axis] - m_bounds.min[axis];
+        const float relative = size > 0.0f ? (position[axis] - m_bounds.min[axis]) / size : 0.0f;
+
+        if (!(relative >= 0.0f && relative <= 1.0f))
+        {
+            return -1;
+        }
+
+        const int index = std::min(m_cells[axis] - 1, static_cast<int>(relative * m_cells[axis]));
+        cell = cell * m_cells[axis] + index;
+    }
+
+    return cell;
+}
+
+const std::vector<int>* PotentiallyVisibleSet::GetVisibleModels(const glm::vec3& position) const
+{
+    const int cell = GetCell(position);
+
+    if (cell < 0)
+    {
+        return nullptr;
+    }
+
+    if (cell == m_cachedCell)
+    {
+        return &m_cachedModels;
+    }
+
+    m_cachedCell = cell;
+    m_cachedModels.clear();
+
+    int firstBit = 0;
+    const uint32_t end = m_cellOffsets[cell + 1];
+
+    for (uint32_t i = m_cellOffsets[cell]; i < end; ++i)
+    {
+        const uint8_t byte = m_data[i];
+
+        if (byte == 0)
+        {
+            // Run length follows zero byte, truncated run ends the cell
+            if (++i >= end)
+            {
+                break;
+            }
+
+            firstBit += 8 * m_data[i];
+            continue;
+        }
+
+        for (int bit = 0; bit < 8; ++bit)
+        {
+            // Bits past the last model may be set only in damaged files
+            if ((byte & (1 << bit)) != 0 && firstBit + bit < m_modelsCount)
+            {
+                m_cachedModels.push_back(firstBit + bit);
+            }
+        }
+
+        firstBit += 8;
+    }
+
+    return &m_cachedModels;
+}
+
+BoundingBox3f PotentiallyVisibleSet::GetCellBounds(int cell) const
+{
+    Vector3f min;
+    Vector3f max;
+
+    // x changes fastest
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        const int index = cell % m_cells[axis];
+        cell /= m_cells[axis];
+
+        const float size = (m_bounds.max[axis] - m_bounds.min[axis]) / m_cells[axis];
+        min[axis] = m_bounds.min[axis] + size * index;
+        max[axis] = index + 1 == m_cells[axis] ? m_bounds.max[axis] : min[axis] + size;
+    }
+
+    return BoundingBox3f(min, max);
+}
\ No newline at end of file
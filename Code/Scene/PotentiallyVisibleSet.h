@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "Base/Geom/BoundingBox.h"
+#include "Scene/Model3d.h"
+
+// GLM
+#include <glm/glm.hpp>
+
+struct PvsBakeSettings
+{
+    PvsBakeSettings() :
+        m_cellSize(4.0f),
+        m_raysPerModel(64)
+    {}
+
+    // Maximal edge of a cell, cells are fitted to the baked bounds
+    float m_cellSize;
+    /* Rays from random points of a cell to random points on the model
+     * surface. Model is visible if any of them is not blocked.
+     */
+    int m_raysPerModel;
+};
+
+/* Precomputed visibility of static models from cells of uniform grid.
+ * Visibility is sampled with rays, so very small gaps can be missed.
+ * Per cell bitsets are stored with zero bytes run length encoded
+ * and unpacked on lookup.
+ */
+class PotentiallyVisibleSet
+{
+public:
+    PotentiallyVisibleSet();
+
+    PotentiallyVisibleSet(const PotentiallyVisibleSet&) = delete;
+
+    /* Splits bounds (navigable space) into cells and finds models visible
+     * from every cell, cells are processed on all cores. Models are
+     * identified by index, so the same order must be used at runtime.
+     */
+    void Bake(const std::vector<Model3dPtr>& models, const BoundingBox3f& bounds,
+        const PvsBakeSettings& settings = PvsBakeSettings());
+
+    bool Save(const char* fileName, std::ostream* logstream = nullptr) const;
+    bool Load(const char* fileName, std::ostream* logstream = nullptr);
+
+    bool IsEmpty() const { return m_cellOffsets.empty(); }
+
+    int GetModelsCount() const { return m_modelsCount; }
+    int GetCellsCount() const { return m_cells[0] * m_cells[1] * m_cells[2]; }
+
+    // Returns -1 for positions outside of baked bounds
+    int GetCell(const glm::vec3& position) const;
+
+    /* Ascending indices of models visible from the cell containing position,
+     * nullptr outside of baked bounds. Result of the last cell is cached, so
+     * lookups cost almost nothing while camera stays in the cell.
+     */
+    const std::vector<int>* GetVisibleModels(const glm::vec3& position) const;
+
+private:
+    BoundingBox3f GetCellBounds(int cell) const;
+
+    BoundingBox3f m_bounds;
+    int m_cells[3];
+    int m_modelsCount;
+
+    // Compressed bitset of a cell is m_data[m_cellOffsets[cell], m_cellOffsets[cell + 1])
+    std::vector<uint32_t> m_cellOffsets;
+    std::vector<uint8_t> m_data;
+
+    mutable int m_cachedCell;
+    mutable std::vector<int> m_cachedModels;
+};
\ No newline at end of file
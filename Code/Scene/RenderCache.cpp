@@ -0,0 +1,206 @@
+#include <algorithm>
+#include <cstdint>
+
+#include "Scene/RenderCache.h"
+
+namespace
+{
+    // High half is zero, clash with content key is as unlikely as any hash collision
+    static Hash128 MakeIdentityKey(const void* blob)
+    {
+        return Hash128(static_cast<uint64_t>(reinterpret_cast<uintptr_t>(blob)), 0);
+    }
+}
+
+size_t RenderCache::MeshKeyHash::operator() (const MeshKey& key) const
+{
+    const size_t vertices = Hash128Hasher()(key.m_vertices);
+    const size_t indices = Hash128Hasher()(key.m_indices);
+    return vertices ^ (indices + 0x9e3779b9 + (vertices << 6) + (vertices >> 2));
+}
+
+RenderCache::RenderCache() :
+    m_contentHashing(false)
+{
+}
+
+Hash128 RenderCache::GetKey(const VertexBlob& vertexBlob) const
+{
+    if (!m_contentHashing)
+    {
+        return MakeIdentityKey(&vertexBlob);
+    }
+
+    // Same bytes with other fields layout are different vertices
+    const uint64_t seed = static_cast<uint64_t>(vertexBlob.GetFields());
+    return ComputeContentHash(vertexBlob.Data(), static_cast<size_t>(vertexBlob.TotalSize()), seed);
+}
+
+Hash128 RenderCache::GetKey(IndexBlob& indexBlob) const
+{
+    if (!m_contentHashing)
+    {
+        return MakeIdentityKey(&indexBlob);
+    }
+
+    const std::vector<int>& indices = indexBlob.GetData();
+    return ComputeContentHash(indices.data(), indices.size() * sizeof(int));
+}
+
+MeshBufferPtr RenderCache::GetMeshBuffer(const MeshDataPtr& meshData)
+{
+    const VertexBlobPtr& vertexBlob = meshData->GetVertexData();
+    const IndexBlobPtr& indexBlob = meshData->GetIndexData();
+
+    // Hashing is done before lock, loaders do not wait for each other
+    const MeshKey key{ GetKey(*vertexBlob), GetKey(*indexBlob) };
+
+    std::lock_guard<std::recursive_mutex> lock(m_mutex);
+
+    auto it = m_meshBuffers.find(key);
+
+    if (it != m_meshBuffers.end())
+    {
+        // Expired entry is being released by another thread
+        MeshBufferPtr meshBuffer = it->second.m_resource.lock();
+
+        if (meshBuffer != nullptr)
+        {
+            ++m_stats.m_hits;
+
+            if (it->second.m_vertexBlob != vertexBlob.get() ||
+                it->second.m_indexBlob != indexBlob.get())
+            {
+                ++m_stats.m_contentHits;
+            }
+
+            return meshBuffer;
+        }
+
+        m_stats.m_bytes -= it->second.m_bytes;
+        m_meshBuffers.erase(it);
+    }
+
+    ++m_stats.m_misses;
+
+    MeshBuffer* created = new MeshBuffer(GetVertices(key.m_vertices, vertexBlob), indexBlob);
+    MeshBufferPtr meshBuffer(created, [this, key](MeshBuffer* released)
+    {
+        Release(key, released);
+    });
+
+    Entry<MeshBuffer>& entry = m_meshBuffers[key];
+    entry.m_resource = meshBuffer;
+    entry.m_raw = created;
+    entry.m_vertexBlob = vertexBlob.get();
+    entry.m_indexBlob = indexBlob.get();
+    entry.m_bytes = indexBlob->GetData().size() * sizeof(int);
+    m_stats.m_bytes += entry.m_bytes;
+
+    return meshBuffer;
+}
+
+PooledVerticesPtr RenderCache::GetVertices(const Hash128& key, const VertexBlobPtr& vertexBlob)
+{
+    auto it = m_vertices.find(key);
+
+    if (it != m_vertices.end())
+    {
+        PooledVerticesPtr vertices = it->second.m_resource.lock();
+
+        if (vertices != nullptr)
+        {
+            return vertices;
+        }
+
+        m_stats.m_bytes -= it->second.m_bytes;
+        m_vertices.erase(it);
+    }
+
+    PooledVertices* created = new PooledVertices(GetPool(vertexBlob->GetFields()), vertexBlob);
+    PooledVerticesPtr vertices(created, [this, key](PooledVertices* released)
+    {
+        Release(key, released);
+    });
+
+    Entry<PooledVertices>& entry = m_vertices[key];
+    entry.m_resource = vertices;
+    entry.m_raw = created;
+    entry.m_vertexBlob = vertexBlob.get();
+    entry.m_indexBlob = nullptr;
+    entry.m_bytes = static_cast<size_t>(vertexBlob->TotalSize());
+    m_stats.m_bytes += entry.m_bytes;
+
+    return vertices;
+}
+
+MeshBufferPoolPtr RenderCache::GetPool(VertexBlobField fields)
+{
+    // Meshes with the same vertex fields share buffers and VAO
+    MeshBufferPoolPtr& pool = m_pools[fields];
+
+    if (pool == nullptr)
+    {
+        pool = std::make_shared<MeshBufferPool>(fields);
+    }
+
+    return pool;
+}
+
+void RenderCache::Release(const MeshKey& key, MeshBuffer* meshBuffer)
+{
+    std::lock_guard<std::recursive_mutex> lock(m_mutex);
+
+    auto it = m_meshBuffers.find(key);
+
+    if (it != m_meshBuffers.end() && it->second.m_raw == meshBuffer)
+    {
+        m_stats.m_bytes -= it->second.m_bytes;
+        m_meshBuffers.erase(it);
+    }
+
+    ++m_stats.m_evictions;
+
+    // Frees pool ranges, vertices may be released with the same lock
+    delete meshBuffer;
+}
+
+void RenderCache::Release(const Hash128& key, PooledVertices* vertices)
+{
+    std::lock_guard<std::recursive_mutex> lock(m_mutex);
+
+    auto it = m_vertices.find(key);
+
+    if (it != m_vertices.end() && it->second.m_raw == vertices)
+    {
+        m_stats.m_bytes -= it->second.m_bytes;
+        m_vertices.erase(it);
+    }
+
+    delete vertices;
+}
+
+size_t RenderCache::Defragment(size_t maxMovedBytes)
+{
+    std::lock_guard<std::recursive_mutex> lock(m_mutex);
+
+    size_t moved = 0;
+
+    for (auto& pool : m_pools)
+    {
+        moved += pool.second->Defragment(maxMovedBytes - std::min(moved, maxMovedBytes));
+    }
+
+    return moved;
+}
+
+RenderCacheStats RenderCache::GetStats() const
+{
+    std::lock_guard<std::recursive_mutex> lock(m_mutex);
+
+    RenderCacheStats stats = m_stats;
+    stats.m_meshBuffers = static_cast<int>(m_meshBuffers.size());
+    stats.m_vertexRanges = static_cast<int>(m_vertices.size());
+
+    return stats;
+}
\ No newline at end of file
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "Base/ContentHash.h"
+#include "Render/MeshBufferPool.h"
+#include "Scene/MeshData.h"
+
+struct RenderCacheStats
+{
+    RenderCacheStats() :
+        m_hits(0),
+        m_misses(0),
+        m_evictions(0),
+        m_contentHits(0),
+        m_meshBuffers(0),
+        m_vertexRanges(0),
+        m_bytes(0)
+    {}
+
+    int m_hits;
+    int m_misses;
+    int m_evictions;
+    // Hits on meshes made of other blobs with the same content
+    int m_contentHits;
+    // Alive now
+    int m_meshBuffers;
+    int m_vertexRanges;
+    // Vertex and index data held in pools
+    size_t m_bytes;
+};
+
+/* GPU buffers of meshes keyed by blob identity. Models using the same
+ * blobs share buffers, which are freed when the last of them is gone.
+ * With content hashing blobs are keyed by 128 bit hash of their data
+ * instead, so identical geometry loaded twice shares one allocation.
+ * Lookup, insertion and eviction are guarded by mutex, so models may be
+ * created and released by background loaders. GL calls are done by the
+ * calling thread, it must have a context sharing objects with the main one.
+ * Pools fence uploads of loaders, see MeshBufferPool::Sync.
+ */
+class RenderCache
+{
+public:
+    RenderCache();
+
+    RenderCache(const RenderCache&) = delete;
+
+    MeshBufferPtr GetMeshBuffer(const MeshDataPtr& meshData);
+
+    /* Blob data is hashed on every lookup, it costs a pass over vertices
+     * and indices. Entries added before the switch are not found after it.
+     */
+    void SetContentHashing(bool enabled) { m_contentHashing = enabled; }
+    bool IsContentHashing() const { return m_contentHashing; }
+
+    // Defragments all pools, see MeshBufferPool::Defragment
+    size_t Defragment(size_t maxMovedBytes);
+
+    RenderCacheStats GetStats() const;
+
+private:
+    struct MeshKey
+    {
+        Hash128 m_vertices;
+        Hash128 m_indices;
+
+        bool operator== (const MeshKey& other) const
+        {
+            return m_vertices == other.m_vertices && m_indices == other.m_indices;
+        }
+    };
+
+    struct MeshKeyHash
+    {
+        size_t operator() (const MeshKey& key) const;
+    };
+
+    /* Cache does not own resources. Raw pointer tells if entry still
+     * belongs to the resource being deleted, it may be replaced by a new
+     * one after the last reference is gone. Blobs are the ones data was
+     * uploaded from, to count hits on other blobs with the same content.
+     */
+    template<typename T>
+    struct Entry
+    {
+        std::weak_ptr<T> m_resource;
+        const T* m_raw;
+        const VertexBlob* m_vertexBlob;
+        const IndexBlob* m_indexBlob;
+        size_t m_bytes;
+    };
+
+    // Blob address as key, or content hash if enabled
+    Hash128 GetKey(const VertexBlob& vertexBlob) const;
+    Hash128 GetKey(IndexBlob& indexBlob) const;
+
+    // Mutex must be locked by caller
+    PooledVerticesPtr GetVertices(const Hash128& key, const VertexBlobPtr& vertexBlob);
+    MeshBufferPoolPtr GetPool(VertexBlobField fields);
+
+    void Release(const MeshKey& key, MeshBuffer* meshBuffer);
+    void Release(const Hash128& key, PooledVertices* vertices);
+
+    // Releasing mesh buffer releases its vertices with the same lock
+    mutable std::recursive_mutex m_mutex;
+    std::unordered_map<MeshKey, Entry<MeshBuffer>, MeshKeyHash> m_meshBuffers;
+    std::unordered_map<Hash128, Entry<PooledVertices>, Hash128Hasher> m_vertices;
+    std::map<VertexBlobField, MeshBufferPoolPtr> m_pools;
+    RenderCacheStats m_stats;
+    std::atomic<bool> m_contentHashing;
+};
\ No newline at end of file
@@ -0,0 +1,211 @@
+#include <algorithm>
+#include <cmath>
+
+#include "Scene/RenderQueue.h"
+
+namespace
+{
+    // Widths of key fields, pass takes the highest four bits
+    const int kPassShift = 60;
+    const int kIdBits = 12;
+    const int kDepthBits = 24;
+
+    const uint64_t kIdMask = (1ull << kIdBits) - 1;
+    const uint64_t kDepthMask = (1ull << kDepthBits) - 1;
+
+    // Least significant first
+    const int kRadixBits = 8;
+    const int kRadixPasses = 64 / kRadixBits;
+    const size_t kBucketsCount = 1 << kRadixBits;
+
+    static uint64_t QuantizeDepth(float depth)
+    {
+        const float clamped = std::min(std::max(depth, 0.0f), 1.0f);
+        return static_cast<uint64_t>(clamped * static_cast<float>(kDepthMask)) & kDepthMask;
+    }
+}
+
+void RenderQueue::Submit(const Model3d& model, float depth)
+{
+    const IMaterial& material = *model.GetMaterial();
+    const uint64_t program = GetId(m_programIds, material.GetShaderProgram().get());
+    const uint64_t materialId = GetId(m_materialIds, &material);
+    const uint64_t mesh = GetId(m_meshIds, model.GetMeshBuffer().get());
+    const uint64_t quantizedDepth = QuantizeDepth(depth);
+
+    Item item;
+    item.m_model = &model;
+
+    if (material.IsTransparent())
+    {
+        item.m_key = (static_cast<uint64_t>(RenderPass::Transparent) << kPassShift) |
+            ((kDepthMask - quantizedDepth) << (3 * kIdBits)) |
+            (program << (2 * kIdBits)) |
+            (materialId << kIdBits) |
+            mesh;
+    }
+    else
+    {
+        item.m_key = (static_cast<uint64_t>(RenderPass::Opaque) << kPassShift) |
+            (program << (kDepthBits + 2 * kIdBits)) |
+            (materialId << (kDepthBits + kIdBits)) |
+            (mesh << kDepthBits) |
+            quantizedDepth;
+    }
+
+    m_items.push_back(item);
+}
+
+void RenderQueue::Submit(const Camera& camera, const std::vector<Model3dPtr>& models,
+    const std::vector<int>& indices)
+{
+    const glm::vec3& position = camera.GetPosition();
+    const glm::vec3& front = camera.GetFront();
+    const float farDistance = camera.GetFar();
+
+    for (int index : indices)
+    {
+        const Model3d& model = *models[index];
+        const BoundingBox3f& box = model.GetBoundingBox();
+
+        glm::vec3 center = model.GetPosition();
+
+        if (box.IsValid())
+        {
+            const Vector3f boxCenter = box.GetCenter();
+            center = glm::vec3(boxCenter.x(), boxCenter.y(), boxCenter.z());
+        }
+
+        Submit(model, glm::dot(center - position, front) / farDistance);
+    }
+}
+
+void RenderQueue::Submit(const Camera& camera, const std::vector<Model3dPtr>& models)
+{
+    std::vector<int> indices(models.size());
+
+    for (size_t i = 0; i < models.size(); ++i)
+    {
+        indices[i] = static_cast<int>(i);
+    }
+
+    Submit(camera, models, indices);
+}
+
+void RenderQueue::Execute()
+{
+    m_stats = RenderQueueStats();
+
+    Sort();
+
+    const ShaderProgram* program = nullptr;
+    const IMaterial* material = nullptr;
+    const MeshBuffer* mesh = nullptr;
+    bool blending = false;
+
+    for (const Item& item : m_items)
+    {
+        const Model3d& model = *item.m_model;
+
+        // Transparent models do not hide each other
+        if (!blending && (item.m_key >> kPassShift) == static_cast<uint64_t>(RenderPass::Transparent))
+        {
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            glDepthMask(GL_FALSE);
+            blending = true;
+        }
+
+        if (model.GetMaterial().get() != material)
+        {
+            material = model.GetMaterial().get();
+            material->PrepareContext();
+            ++m_stats.m_materialChanges;
+
+            if (material->GetShaderProgram().get() != program)
+            {
+                program = material->GetShaderProgram().get();
+                ++m_stats.m_programChanges;
+            }
+        }
+
+        if (model.GetMeshBuffer().get() != mesh)
+        {
+            mesh = model.GetMeshBuffer().get();
+            ++m_stats.m_meshChanges;
+        }
+
+        model.DrawPrepared();
+        ++m_stats.m_draws;
+    }
+
+    if (blending)
+    {
+        glDepthMask(GL_TRUE);
+        glDisable(GL_BLEND);
+    }
+
+    m_items.clear();
+}
+
+uint64_t RenderQueue::GetId(std::unordered_map<const void*, uint32_t>& ids, const void* object)
+{
+    auto it = ids.find(object);
+
+    if (it != ids.end())
+    {
+        return it->second;
+    }
+
+    // Ids are reassigned when they do not fit into key, sorting gets worse for a frame
+    if (ids.size() > kIdMask)
+    {
+        ids.clear();
+    }
+
+    const uint32_t id = static_cast<uint32_t>(ids.size());
+    ids.emplace(object, id);
+
+    return id;
+}
+
+void RenderQueue::Sort()
+{
+    m_sortBuffer.resize(m_items.size());
+
+    size_t counts[kBucketsCount];
+
+    for (int pass = 0; pass < kRadixPasses; ++pass)
+    {
+        const int shift = pass * kRadixBits;
+
+        std::fill(counts, counts + kBucketsCount, static_cast<size_t>(0));
+
+        for (const Item& item : m_items)
+        {
+            ++counts[(item.m_key >> shift) & (kBucketsCount - 1)];
+        }
+
+        // Digit is the same for all keys, order would not change
+        if (std::find(counts, counts + kBucketsCount, m_items.size()) != counts + kBucketsCount)
+        {
+            continue;
+        }
+
+        size_t offset = 0;
+
+        for (size_t& count : counts)
+        {
+            const size_t bucketSize = count;
+            count = offset;
+            offset += bucketSize;
+        }
+
+        for (const Item& item : m_items)
+        {
+            m_sortBuffer[counts[(item.m_key >> shift) & (kBucketsCount - 1)]++] = item;
+        }
+
+        m_items.swap(m_sortBuffer);
+    }
+}
\ No newline at end of file
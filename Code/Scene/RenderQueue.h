@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "Render/Camera.h"
+#include "Scene/Model3d.h"
+
+// Passes are drawn in this order
+enum class RenderPass : uint8_t
+{
+    Opaque = 0,
+    Transparent = 1
+};
+
+struct RenderQueueStats
+{
+    RenderQueueStats() :
+        m_draws(0),
+        m_programChanges(0),
+        m_materialChanges(0),
+        m_meshChanges(0)
+    {}
+
+    int m_draws;
+    int m_programChanges;
+    int m_materialChanges;
+    int m_meshChanges;
+};
+
+/* Draws models ordered by 64 bit sort key. Opaque keys hold pass,
+ * program, material, mesh and depth from most to least significant
+ * bits, so state changes are rare and near models are drawn first.
+ * Transparent keys put depth, inverted, right after pass, so they are
+ * blended farthest first. Keys are radix sorted. Material is prepared
+ * once for models drawn in a row with it.
+ */
+class RenderQueue
+{
+public:
+    RenderQueue() {}
+
+    RenderQueue(const RenderQueue&) = delete;
+
+    // Depth is distance along camera front, normalized by far plane distance
+    void Submit(const Model3d& model, float depth);
+
+    // Adds models[indices], e.g. frustum culling result
+    void Submit(const Camera& camera, const std::vector<Model3dPtr>& models,
+        const std::vector<int>& indices);
+
+    void Submit(const Camera& camera, const std::vector<Model3dPtr>& models);
+
+    // Sorts, draws and clears submitted models
+    void Execute();
+
+    // Of the last Execute call
+    const RenderQueueStats& GetStats() const { return m_stats; }
+
+private:
+    struct Item
+    {
+        uint64_t m_key;
+        const Model3d* m_model;
+    };
+
+    // Small numbers of objects used in keys, assigned in order of appearance
+    uint64_t GetId(std::unordered_map<const void*, uint32_t>& ids, const void* object);
+
+    void Sort();
+
+    std::vector<Item> m_items;
+    std::vector<Item> m_sortBuffer;
+    std::unordered_map<const void*, uint32_t> m_programIds;
+    std::unordered_map<const void*, uint32_t> m_materialIds;
+    std::unordered_map<const void*, uint32_t> m_meshIds;
+    RenderQueueStats m_stats;
+};
\ No newline at end of file
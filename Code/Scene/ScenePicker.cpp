@@ -0,0 +1,64 @@
+#include <cassert>
+
+#include "Scene/ScenePicker.h"
+
+ScenePicker::ScenePicker(const SceneTree& scene) :
+    m_scene(scene)
+{
+}
+
+bool ScenePicker::Pick(const Ray& ray, float maxDistance, PickResult* result)
+{
+    assert(result != nullptr);
+
+    bool found = false;
+
+    m_scene.RayCast(ray, maxDistance, [&](int modelIndex, float distance)
+    {
+        const Model3d& model = *m_scene.GetModels()[modelIndex];
+        const TriangleBVH& meshTree = GetMeshTree(model.GetMeshData());
+
+        // Direction is not normalized in model space, so hit distance stays world one
+        const glm::mat4 inverse = glm::inverse(model.GetMatrix());
+        const glm::vec4 origin = inverse *
+            glm::vec4(ray.m_origin.x(), ray.m_origin.y(), ray.m_origin.z(), 1.0f);
+        const glm::vec4 direction = inverse *
+            glm::vec4(ray.m_direction.x(), ray.m_direction.y(), ray.m_direction.z(), 0.0f);
+
+        const Ray localRay(
+            Vector3f(origin.x, origin.y, origin.z),
+            Vector3f(direction.x, direction.y, direction.z));
+
+        RayHit hit;
+
+        if (!meshTree.Intersect(localRay, distance, &hit))
+        {
+            return distance;
+        }
+
+        found = true;
+
+        result->m_model = modelIndex;
+        result->m_triangle = hit.m_triangle;
+        result->m_distance = hit.m_distance;
+        result->m_barycentrics = Vector3f(1.0f - hit.m_u - hit.m_v, hit.m_u, hit.m_v);
+
+        return hit.m_distance;
+    });
+
+    return found;
+}
+
+const TriangleBVH& ScenePicker::GetMeshTree(const MeshDataPtr& meshData)
+{
+    TriangleBVHPtr& meshTree = m_meshTrees[meshData];
+
+    if (meshTree == nullptr)
+    {
+        meshTree = std::make_shared<TriangleBVH>(
+            meshData->GetVertexData()->GetFieldView<VertexBlobField::Pos>(),
+            meshData->GetIndexData()->GetData());
+    }
+
+    return *meshTree;
+}
\ No newline at end of file
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <map>
+
+#include "Base/Geom/Ray.h"
+#include "Base/Geom/TriangleBVH.h"
+#include "Scene/SceneTree.h"
+
+struct PickResult
+{
+    PickResult() :
+        m_model(-1), m_triangle(-1), m_distance(0.0f) {}
+
+    // Index in SceneTree::GetModels()
+    int m_model;
+    // Triangle in mesh index data (first index / 3)
+    int m_triangle;
+    // Distance along the world ray
+    float m_distance;
+    // Weights of triangle vertices
+    Vector3f m_barycentrics;
+};
+
+/* Picks models with rays. Scene tree gives candidate models, then the
+ * ray is moved to model space and tested against triangle BVH of its
+ * mesh. Triangle BVH is built on first use and shared by all models
+ * with the same mesh.
+ */
+class ScenePicker
+{
+public:
+    explicit ScenePicker(const SceneTree& scene);
+
+    ScenePicker(const ScenePicker&) = delete;
+
+    // Finds closest triangle hit by the ray, scene tree must be up to date
+    bool Pick(const Ray& ray, float maxDistance, PickResult* result);
+
+    // Cache holds meshes alive, clear it when scene meshes are replaced
+    void ClearCache() { m_meshTrees.clear(); }
+
+private:
+    const TriangleBVH& GetMeshTree(const MeshDataPtr& meshData);
+
+    const SceneTree& m_scene;
+    std::map<MeshDataPtr, TriangleBVHPtr> m_meshTrees;
+};
\ No newline at end of file
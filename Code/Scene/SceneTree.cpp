@@ -0,0 +1,94 @@
+#include <cassert>
+
+#include "Base/ParallelFor.h"
+#include "Scene/SceneTree.h"
+
+namespace
+{
+    const size_t kMinModelsPerThread = 4096;
+}
+
+SceneTree::SceneTree(const std::vector<Model3dPtr>& models) :
+    m_models(models),
+    m_revisions(models.size())
+{
+    std::vector<BoundingBox3f> boxes(models.size());
+
+    // Every model caches own world box, so threads don't share state
+    ParallelFor(models.size(), kMinModelsPerThread, [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            boxes[i] = models[i]->GetBoundingBox();
+            m_revisions[i] = models[i]->GetMatrixRevision();
+        }
+    });
+
+    m_tree.Build(boxes, &m_proxies);
+}
+
+int SceneTree::Add(const Model3dPtr& model)
+{
+    assert(model != nullptr);
+
+    const int index = static_cast<int>(m_models.size());
+
+    m_models.push_back(model);
+    m_revisions.push_back(model->GetMatrixRevision());
+    m_proxies.push_back(m_tree.Insert(model->GetBoundingBox(), index));
+
+    return index;
+}
+
+void SceneTree::Remove(int index)
+{
+    assert(index >= 0 && index < static_cast<int>(m_models.size()));
+
+    m_tree.Remove(m_proxies[index]);
+
+    const int last = static_cast<int>(m_models.size()) - 1;
+
+    if (index != last)
+    {
+        m_models[index] = m_models[last];
+        m_proxies[index] = m_proxies[last];
+        m_revisions[index] = m_revisions[last];
+
+        // Proxy keeps its place in the tree, only user data changes
+        m_tree.SetUserData(m_proxies[index], index);
+    }
+
+    m_models.pop_back();
+    m_proxies.pop_back();
+    m_revisions.pop_back();
+}
+
+void SceneTree::Update()
+{
+    m_moved.resize(m_models.size());
+
+    // Find moved models and recompute their boxes on all cores
+    ParallelFor(m_models.size(), kMinModelsPerThread, [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            const uint32_t revision = m_models[i]->GetMatrixRevision();
+
+            m_moved[i] = revision != m_revisions[i] ? 1 : 0;
+
+            if (m_moved[i] != 0)
+            {
+                m_revisions[i] = revision;
+                m_models[i]->GetBoundingBox();
+            }
+        }
+    });
+
+    for (size_t i = 0; i < m_models.size(); ++i)
+    {
+        if (m_moved[i] != 0)
+        {
+            m_tree.Move(m_proxies[i], m_models[i]->GetBoundingBox());
+        }
+    }
+}
\ No newline at end of file
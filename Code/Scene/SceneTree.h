@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Base/Geom/DynamicAABBTree.h"
+#include "Scene/Model3d.h"
+
+/* Models indexed by world space bounding boxes. Queries return
+ * indices in GetModels(). Call Update after moving models to refit
+ * the tree, only models with changed matrices are touched.
+ */
+class SceneTree
+{
+public:
+    // Builds the tree in parallel
+    explicit SceneTree(const std::vector<Model3dPtr>& models = std::vector<Model3dPtr>());
+
+    SceneTree(const SceneTree&) = delete;
+
+    const std::vector<Model3dPtr>& GetModels() const { return m_models; }
+
+    const DynamicAABBTree& GetTree() const { return m_tree; }
+
+    // Returns index of the model
+    int Add(const Model3dPtr& model);
+
+    // Last model takes index of removed one
+    void Remove(int index);
+
+    // Reinserts models which were moved since previous call
+    void Update();
+
+    void Query(const BoundingBox3f& box, std::vector<int>* models) const
+    {
+        m_tree.Query(box, models);
+    }
+
+    void Query(const Frustum& frustum, std::vector<int>* models) const
+    {
+        m_tree.Query(frustum, models);
+    }
+
+    // See DynamicAABBTree::RayCast, callback gets model index
+    template<typename Callback>
+    void RayCast(const Ray& ray, float maxDistance, const Callback& callback) const
+    {
+        m_tree.RayCast(ray, maxDistance, callback);
+    }
+
+private:
+    std::vector<Model3dPtr> m_models;
+    std::vector<int> m_proxies;
+    std::vector<uint32_t> m_revisions;
+
+    DynamicAABBTree m_tree;
+    std::vector<uint8_t> m_moved;
+};
+
+using SceneTreePtr = std::shared_ptr<SceneTree>;
\ No newline at end of file
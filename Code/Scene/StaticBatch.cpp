@@ -0,0 +1,180 @@
+#include <cassert>
+#include <map>
+#include <utility>
+
+#include "Base/ParallelFor.h"
+#include "Scene/StaticBatch.h"
+
+StaticBatch::StaticBatch(const std::vector<Model3dPtr>& models)
+{
+    assert(!models.empty());
+
+    const IMaterialPtr& material = models.front()->GetMaterial();
+    const VertexBlobField fields = models.front()->GetMeshData()->GetVertexData()->GetFields();
+
+    std::vector<int> vertexOffsets(models.size() + 1, 0);
+    std::vector<int> indexOffsets(models.size() + 1, 0);
+    std::vector<glm::mat3> normalMatrices(models.size());
+
+    for (size_t i = 0; i < models.size(); ++i)
+    {
+        const MeshDataPtr& meshData = models[i]->GetMeshData();
+
+        assert(models[i]->GetMaterial() == material);
+        assert(meshData->GetVertexData()->GetFields() == fields);
+
+        vertexOffsets[i + 1] = vertexOffsets[i] + meshData->GetVertexData()->Size();
+        indexOffsets[i + 1] = indexOffsets[i] +
+            static_cast<int>(meshData->GetIndexData()->GetData().size());
+
+        // Normal matrix is lazily computed, so do it before threads start
+        normalMatrices[i] = models[i]->GetNormalMatrix();
+    }
+
+    VertexBlobPtr vertexBlob = std::make_shared<VertexBlob>(fields, vertexOffsets.back());
+    std::vector<int> indices(static_cast<size_t>(indexOffsets.back()));
+    m_subMeshes.resize(models.size());
+
+    ParallelFor(models.size(), 16, [&](size_t begin, size_t end)
+    {
+        ArrayView<Vector3f> positions = vertexBlob->GetFieldView<VertexBlobField::Pos>();
+        ArrayView<Vector3f> normals = vertexBlob->GetFieldView<VertexBlobField::Norm>();
+        ArrayView<Vector4f> tangents = vertexBlob->GetFieldView<VertexBlobField::Tangent>();
+
+        for (size_t i = begin; i < end; ++i)
+        {
+            const MeshDataPtr& meshData = models[i]->GetMeshData();
+            const VertexBlob& source = *meshData->GetVertexData();
+            const std::vector<int>& sourceIndices = meshData->GetIndexData()->GetData();
+
+            const glm::mat4& matrix = models[i]->GetMatrix();
+            const glm::mat3 linear(matrix);
+            const glm::mat3& normalMatrix = normalMatrices[i];
+
+            // Mirroring transform flips triangles winding and tangent space handedness
+            const bool mirrored = glm::determinant(linear) < 0.0f;
+
+            const int baseVertex = vertexOffsets[i];
+            BoundingBox3f boundingBox = BoundingBox3f::kInvalid;
+
+            for (int vertex = 0; vertex < source.Size(); ++vertex)
+            {
+                const int target = baseVertex + vertex;
+
+                vertexBlob->CopyPoint(target, source, vertex);
+
+                Vector3f& pos = positions[target];
+                const glm::vec4 worldPos = matrix * glm::vec4(pos.x(), pos.y(), pos.z(), 1.0f);
+                pos = Vector3f(worldPos.x, worldPos.y, worldPos.z);
+                boundingBox += pos;
+
+                if (!normals.empty())
+                {
+                    Vector3f& norm = normals[target];
+                    const glm::vec3 worldNorm = normalMatrix * glm::vec3(norm.x(), norm.y(), norm.z());
+                    norm = Vector3f(worldNorm.x, worldNorm.y, worldNorm.z).normalized();
+                }
+
+                if (!tangents.empty())
+                {
+                    Vector4f& tangent = tangents[target];
+                    const glm::vec3 worldTangent = glm::normalize(
+                        linear * glm::vec3(tangent.x(), tangent.y(), tangent.z()));
+                    tangent = Vector4f(worldTangent.x, worldTangent.y, worldTangent.z,
+                        mirrored ? -tangent.w() : tangent.w());
+                }
+            }
+
+            const size_t firstIndex = static_cast<size_t>(indexOffsets[i]);
+
+            for (size_t index = 0; index < sourceIndices.size(); index += 3)
+            {
+                indices[firstIndex + index] = baseVertex + sourceIndices[index];
+                indices[firstIndex + index + 1] = baseVertex + sourceIndices[mirrored ? index + 2 : index + 1];
+                indices[firstIndex + index + 2] = baseVertex + sourceIndices[mirrored ? index + 1 : index + 2];
+            }
+
+            SubMesh& subMesh = m_subMeshes[i];
+            subMesh.m_indices = IndexRange(indexOffsets[i], indexOffsets[i + 1] - indexOffsets[i]);
+            subMesh.m_boundingBox = boundingBox;
+        }
+    });
+
+    BoundingBox3f boundingBox = BoundingBox3f::kInvalid;
+
+    for (const SubMesh& subMesh : m_subMeshes)
+    {
+        if (subMesh.m_boundingBox.IsValid())
+        {
+            boundingBox += subMesh.m_boundingBox;
+        }
+    }
+
+    m_model = std::make_shared<Model3d>(
+        std::make_shared<MeshData>(vertexBlob, std::make_shared<IndexBlob>(indices), boundingBox),
+        material);
+}
+
+void StaticBatch::Draw() const
+{
+    m_model->Draw();
+}
+
+void StaticBatch::Draw(const std::vector<int>& subMeshes) const
+{
+    m_cachedRanges.clear();
+
+    for (int subMesh : subMeshes)
+    {
+        const IndexRange& range = m_subMeshes[subMesh].m_indices;
+
+        if (!m_cachedRanges.empty() &&
+            m_cachedRanges.back().m_first + m_cachedRanges.back().m_count == range.m_first)
+        {
+            m_cachedRanges.back().m_count += range.m_count;
+        }
+        else
+        {
+            m_cachedRanges.push_back(range);
+        }
+    }
+
+    if (!m_cachedRanges.empty())
+    {
+        m_model->Draw(m_cachedRanges);
+    }
+}
+
+std::vector<StaticBatchPtr> BuildStaticBatches(const std::vector<Model3dPtr>& models)
+{
+    std::map<std::pair<const IMaterial*, VertexBlobField>, size_t> groupIndices;
+    std::vector<std::vector<Model3dPtr>> groups;
+
+    for (const Model3dPtr& model : models)
+    {
+        const auto key = std::make_pair(model->GetMaterial().get(),
+            model->GetMeshData()->GetVertexData()->GetFields());
+
+        const auto it = groupIndices.find(key);
+
+        if (it == groupIndices.end())
+        {
+            groupIndices.emplace(key, groups.size());
+            groups.emplace_back(1, model);
+        }
+        else
+        {
+            groups[it->second].push_back(model);
+        }
+    }
+
+    std::vector<StaticBatchPtr> result;
+    result.reserve(groups.size());
+
+    for (const auto& group : groups)
+    {
+        result.push_back(std::make_shared<StaticBatch>(group));
+    }
+
+    return result;
+}
\ No newline at end of file
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "Base/Geom/BoundingBox.h"
+#include "Base/Geom/IndexBlob.h"
+#include "Scene/Model3d.h"
+
+/* Several static models with the same material merged into one mesh.
+ * Matrices of source models are baked into vertices, so models must not
+ * move after batching. Index range of every source model is kept to let
+ * culling skip parts of the batch.
+ */
+class StaticBatch
+{
+public:
+    // Part of the batch which came from one source model
+    struct SubMesh
+    {
+        IndexRange m_indices;
+        // World space bounds
+        BoundingBox3f m_boundingBox;
+    };
+
+    // All models must share material and vertex fields
+    explicit StaticBatch(const std::vector<Model3dPtr>& models);
+
+    StaticBatch(const StaticBatch&) = delete;
+
+    const Model3dPtr& GetModel() const { return m_model; }
+    const std::vector<SubMesh>& GetSubMeshes() const { return m_subMeshes; }
+
+    void Draw() const;
+
+    /* Draws sub meshes by sorted indices. Adjacent sub meshes are
+     * drawn with single call.
+     */
+    void Draw(const std::vector<int>& subMeshes) const;
+
+private:
+    Model3dPtr m_model;
+    std::vector<SubMesh> m_subMeshes;
+
+    mutable std::vector<IndexRange> m_cachedRanges;
+};
+
+using StaticBatchPtr = std::shared_ptr<StaticBatch>;
+
+// Splits models by material and vertex fields and batches every group
+std::vector<StaticBatchPtr> BuildStaticBatches(const std::vector<Model3dPtr>& models);
\ No newline at end of file
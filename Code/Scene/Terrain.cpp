@@ -0,0 +1,603 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <utility>
+
+#include "Render/GLState.h"
+#include "Scene/Terrain.h"
+
+namespace
+{
+    const uint64_t kNoTile = ~0ull;
+
+    // Material textures take the first units
+    const int kHeightsTextureUnit = 7;
+
+    // Range of the root level, it covers any view
+    const float kInfiniteRange = 1.0e30f;
+
+    static float GetDistance(const BoundingBox3f& box, const glm::vec3& point)
+    {
+        float distanceSquared = 0.0f;
+
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            const float outside = std::max(std::max(box.min[axis] - point[axis],
+                point[axis] - box.max[axis]), 0.0f);
+            distanceSquared += outside * outside;
+        }
+
+        return std::sqrt(distanceSquared);
+    }
+
+    static bool IsPowerOfTwo(int value)
+    {
+        return value > 0 && (value & (value - 1)) == 0;
+    }
+
+    static int GetTileLevel(uint64_t key) { return static_cast<int>(key >> 48); }
+    static int GetTileX(uint64_t key) { return static_cast<int>((key >> 24) & 0xFFFFFF); }
+    static int GetTileY(uint64_t key) { return static_cast<int>(key & 0xFFFFFF); }
+}
+
+Terrain::Terrain() :
+    m_levelsCount(0),
+    m_frame(0),
+    m_loading(kNoTile),
+    m_exit(false)
+{
+    m_stats = TerrainStats();
+}
+
+Terrain::~Terrain()
+{
+    Close();
+}
+
+bool Terrain::Open(const HeightmapPtr& heightmap, const TerrainSettings& settings,
+    std::ostream* logstream)
+{
+    assert(IsPowerOfTwo(settings.m_gridSize) && settings.m_gridSize >= 2);
+    assert(settings.m_tileSize % settings.m_gridSize == 0 &&
+        IsPowerOfTwo(settings.m_tileSize / settings.m_gridSize) &&
+        settings.m_tileSize > settings.m_gridSize);
+
+    Close();
+
+    if (heightmap == nullptr || heightmap->GetWidth() < 2 || heightmap->GetHeight() < 2)
+    {
+        if (logstream != nullptr)
+        {
+            *logstream << "ERROR::TERRAIN::HEIGHTMAP_IS_EMPTY" << std::endl;
+        }
+
+        return false;
+    }
+
+    m_heightmap = heightmap;
+    m_settings = settings;
+
+    BuildMinMax();
+    CreateGrid();
+
+    m_ranges.resize(m_levelsCount);
+
+    for (int level = 0; level < m_levelsCount; ++level)
+    {
+        m_ranges[level] = level + 1 < m_levelsCount ?
+            m_settings.m_lodDistance * static_cast<float>(1 << level) : kInfiniteRange;
+    }
+
+    m_exit = false;
+    m_loader = std::thread(&Terrain::LoaderLoop, this);
+
+    return true;
+}
+
+void Terrain::Close()
+{
+    if (m_loader.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_exit = true;
+        }
+
+        m_condition.notify_all();
+        m_loader.join();
+    }
+
+    for (auto& tile : m_tiles)
+    {
+        XGLState::DeleteTextures(1, &tile.second.m_texture);
+    }
+
+    m_tiles.clear();
+    m_patches.clear();
+    m_requests.clear();
+    m_loaded.clear();
+    m_loading = kNoTile;
+    m_heightmap.reset();
+    m_levelsCount = 0;
+    m_stats = TerrainStats();
+}
+
+void Terrain::BuildMinMax()
+{
+    const int width = m_heightmap->GetWidth();
+    const int height = m_heightmap->GetHeight();
+    const int grid = m_settings.m_gridSize;
+
+    m_levelWidths.assign(1, std::max((width - 2) / grid + 1, 1));
+    m_levelHeights.assign(1, std::max((height - 2) / grid + 1, 1));
+
+    while (m_levelWidths.back() > 1 || m_levelHeights.back() > 1)
+    {
+        m_levelWidths.push_back((m_levelWidths.back() + 1) / 2);
+        m_levelHeights.push_back((m_levelHeights.back() + 1) / 2);
+    }
+
+    m_levelsCount = static_cast<int>(m_levelWidths.size());
+    m_minMax.resize(m_levelsCount);
+
+    // Nodes share border samples, row y belongs to nodes y / grid and (y - 1) / grid
+    std::vector<uint16_t>& leaves = m_minMax[0];
+    leaves.resize(m_levelWidths[0] * m_levelHeights[0] * 2);
+
+    for (size_t i = 0; i < leaves.size(); i += 2)
+    {
+        leaves[i] = 0xFFFF;
+        leaves[i + 1] = 0;
+    }
+
+    std::vector<uint16_t> row(width);
+
+    for (int y = 0; y < height; ++y)
+    {
+        m_heightmap->ReadRow(y, 0, width, 1, row.data());
+
+        const int lastNodeY = std::min(y / grid, m_levelHeights[0] - 1);
+        const int firstNodeY = y % grid == 0 && y > 0 ? lastNodeY - 1 : lastNodeY;
+
+        for (int nodeY = std::max(firstNodeY, 0); nodeY <= lastNodeY; ++nodeY)
+        {
+            for (int nodeX = 0; nodeX < m_levelWidths[0]; ++nodeX)
+            {
+                const auto first = row.begin() + nodeX * grid;
+                const auto last = row.begin() + std::min((nodeX + 1) * grid + 1, width);
+                const auto range = std::minmax_element(first, last);
+
+                uint16_t* minMax = &leaves[(nodeY * m_levelWidths[0] + nodeX) * 2];
+                minMax[0] = std::min(minMax[0], *range.first);
+                minMax[1] = std::max(minMax[1], *range.second);
+            }
+        }
+    }
+
+    for (int level = 1; level < m_levelsCount; ++level)
+    {
+        const std::vector<uint16_t>& children = m_minMax[level - 1];
+        std::vector<uint16_t>& nodes = m_minMax[level];
+        nodes.resize(m_levelWidths[level] * m_levelHeights[level] * 2);
+
+        for (int y = 0; y < m_levelHeights[level]; ++y)
+        {
+            for (int x = 0; x < m_levelWidths[level]; ++x)
+            {
+                uint16_t* minMax = &nodes[(y * m_levelWidths[level] + x) * 2];
+                minMax[0] = 0xFFFF;
+                minMax[1] = 0;
+
+                for (int quadrant = 0; quadrant < 4; ++quadrant)
+                {
+                    const int childX = 2 * x + (quadrant & 1);
+                    const int childY = 2 * y + (quadrant >> 1);
+
+                    if (childX < m_levelWidths[level - 1] && childY < m_levelHeights[level - 1])
+                    {
+                        const uint16_t* child = &children[(childY * m_levelWidths[level - 1] + childX) * 2];
+                        minMax[0] = std::min(minMax[0], child[0]);
+                        minMax[1] = std::max(minMax[1], child[1]);
+                    }
+                }
+            }
+        }
+    }
+}
+
+void Terrain::CreateGrid()
+{
+    const int grid = m_settings.m_gridSize;
+    const int side = grid + 1;
+
+    VertexBlobPtr vertices = std::make_shared<VertexBlob>(VertexBlobField::Pos, side * side);
+    ArrayView<Vector3f> positions = vertices->GetFieldView<VertexBlobField::Pos>();
+
+    for (int z = 0; z < side; ++z)
+    {
+        for (int x = 0; x < side; ++x)
+        {
+            positions[x + side * z] = Vector3f(
+                static_cast<float>(x) / grid, 0.0f, static_cast<float>(z) / grid);
+        }
+    }
+
+    // Quadrants go one by one, so a quarter of the node is one index range
+    std::vector<int> indices;
+    indices.reserve(grid * grid * 6);
+
+    const int half = grid / 2;
+
+    for (int quadrant = 0; quadrant < 4; ++quadrant)
+    {
+        m_quadrants[quadrant].m_first = static_cast<int>(indices.size());
+
+        const int firstX = (quadrant & 1) * half;
+        const int firstZ = (quadrant >> 1) * half;
+
+        for (int z = firstZ; z < firstZ + half; ++z)
+        {
+            for (int x = firstX; x < firstX + half; ++x)
+            {
+                const int corner = x + side * z;
+
+                // Counter clockwise seen from above
+                indices.push_back(corner);
+                indices.push_back(corner + side);
+                indices.push_back(corner + 1);
+
+                indices.push_back(corner + 1);
+                indices.push_back(corner + side);
+                indices.push_back(corner + side + 1);
+            }
+        }
+
+        m_quadrants[quadrant].m_count = static_cast<int>(indices.size()) - m_quadrants[quadrant].m_first;
+    }
+
+    VertexBufferObjectPtr vbo = std::make_shared<VertexBufferObject>(vertices);
+
+    m_grid = std::make_shared<ElementBufferObject>(vbo, std::make_shared<IndexBlob>(indices));
+}
+
+BoundingBox3f Terrain::GetBounds() const
+{
+    if (m_levelsCount == 0)
+    {
+        return BoundingBox3f::kInvalid;
+    }
+
+    return GetNodeBounds(m_levelsCount - 1, 0, 0);
+}
+
+BoundingBox3f Terrain::GetNodeBounds(int level, int x, int y) const
+{
+    const float size = m_settings.m_gridSize * static_cast<float>(1 << level) * m_settings.m_sampleSpacing;
+    const uint16_t* minMax = &m_minMax[level][(y * m_levelWidths[level] + x) * 2];
+    const float heightScale = m_settings.m_heightScale / 65535.0f;
+
+    return BoundingBox3f(
+        Vector3f(x * size, minMax[0] * heightScale, y * size),
+        Vector3f((x + 1) * size, minMax[1] * heightScale, (y + 1) * size));
+}
+
+uint64_t Terrain::GetTileKey(int level, int nodeX, int nodeY) const
+{
+    const int nodesPerTile = m_settings.m_tileSize / m_settings.m_gridSize;
+
+    return
+        (static_cast<uint64_t>(level) << 48) |
+        (static_cast<uint64_t>(nodeX / nodesPerTile) << 24) |
+        static_cast<uint64_t>(nodeY / nodesPerTile);
+}
+
+Terrain::Tile* Terrain::FindTile(uint64_t key)
+{
+    auto it = m_tiles.find(key);
+    return it != m_tiles.end() ? &it->second : nullptr;
+}
+
+void Terrain::Update(const Camera& camera)
+{
+    m_patches.clear();
+
+    if (m_levelsCount == 0)
+    {
+        return;
+    }
+
+    ++m_frame;
+    UploadLoaded();
+
+    std::vector<uint64_t> requests;
+    Select(m_levelsCount - 1, 0, 0, camera.GetFrustum(), camera.GetPosition(), &requests);
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // Tiles not needed any more are not loaded
+        m_requests.clear();
+
+        for (uint64_t key : requests)
+        {
+            if (key != m_loading)
+            {
+                m_requests.push_back(key);
+            }
+        }
+    }
+
+    m_condition.notify_one();
+
+    EvictTiles();
+
+    m_stats.m_patches = static_cast<int>(m_patches.size());
+    m_stats.m_residentTiles = static_cast<int>(m_tiles.size());
+    m_stats.m_pendingLoads = static_cast<int>(requests.size());
+}
+
+/* Returns false if the node is out of its level range, then parent
+ * draws the area with its own level
+ */
+bool Terrain::Select(int level, int x, int y, const Frustum& frustum,
+    const glm::vec3& cameraPosition, std::vector<uint64_t>* requests)
+{
+    const BoundingBox3f bounds = GetNodeBounds(level, x, y);
+    const float distance = GetDistance(bounds, cameraPosition);
+
+    if (distance > m_ranges[level])
+    {
+        return false;
+    }
+
+    if (!frustum.Intersects(bounds))
+    {
+        return true;
+    }
+
+    // Tiles of children are checked before descending, so only root can miss
+    const uint64_t key = GetTileKey(level, x, y);
+    Tile* tile = FindTile(key);
+
+    if (tile == nullptr)
+    {
+        requests->push_back(key);
+        return true;
+    }
+
+    tile->m_usedFrame = m_frame;
+
+    if (level == 0 || distance > m_ranges[level - 1])
+    {
+        AddPatch(level, x, y, -1, tile);
+        return true;
+    }
+
+    // Children of a node always share the tile
+    const uint64_t childrenKey = GetTileKey(level - 1, 2 * x, 2 * y);
+    Tile* childrenTile = FindTile(childrenKey);
+
+    if (childrenTile == nullptr)
+    {
+        requests->push_back(childrenKey);
+        AddPatch(level, x, y, -1, tile);
+        return true;
+    }
+
+    childrenTile->m_usedFrame = m_frame;
+
+    for (int quadrant = 0; quadrant < 4; ++quadrant)
+    {
+        const int childX = 2 * x + (quadrant & 1);
+        const int childY = 2 * y + (quadrant >> 1);
+
+        // Quadrant is out of the heightmap
+        if (childX >= m_levelWidths[level - 1] || childY >= m_levelHeights[level - 1])
+        {
+            continue;
+        }
+
+        if (!Select(level - 1, childX, childY, frustum, cameraPosition, requests))
+        {
+            AddPatch(level, x, y, quadrant, tile);
+        }
+    }
+
+    return true;
+}
+
+void Terrain::AddPatch(int level, int x, int y, int quadrant, Tile* tile)
+{
+    Patch patch;
+    patch.m_level = level;
+    patch.m_x = x;
+    patch.m_y = y;
+    patch.m_quadrant = quadrant;
+    patch.m_texture = tile->m_texture;
+
+    m_patches.push_back(patch);
+}
+
+void Terrain::Draw(const IMaterialPtr& material) const
+{
+    if (m_patches.empty())
+    {
+        return;
+    }
+
+    const ShaderProgramPtr& shader = material->GetShaderProgram();
+    shader->Use();
+    material->PrepareContext();
+
+    const Uniforms& uniforms = GetUniforms(shader);
+    const int tileSamples = m_settings.m_tileSize + 1;
+
+    uniforms.m_gridSize.Set(static_cast<float>(m_settings.m_gridSize));
+    uniforms.m_heightScale.Set(m_settings.m_heightScale);
+    uniforms.m_heights.Set(kHeightsTextureUnit);
+
+    XGLState::ActiveTexture(GL_TEXTURE0 + kHeightsTextureUnit);
+
+    const IndexRange wholeGrid(0, m_quadrants[3].m_first + m_quadrants[3].m_count);
+
+    for (const Patch& patch : m_patches)
+    {
+        const float step = static_cast<float>(1 << patch.m_level);
+        const float nodeSize = m_settings.m_gridSize * step * m_settings.m_sampleSpacing;
+
+        // Morphing to coarser grid ends where the level range ends
+        const float morphEnd = m_ranges[patch.m_level];
+        const float previousRange = patch.m_level > 0 ? m_ranges[patch.m_level - 1] : 0.0f;
+        const float morphStart = morphEnd - (morphEnd - previousRange) * m_settings.m_morphFraction;
+
+        // Texel i of the tile is the sample origin + i * step
+        const float tileWorldSize = m_settings.m_tileSize * step * m_settings.m_sampleSpacing;
+        const int nodesPerTile = m_settings.m_tileSize / m_settings.m_gridSize;
+        const float uvScale = 1.0f / (step * m_settings.m_sampleSpacing * tileSamples);
+
+        uniforms.m_nodeOffsetSize.Set(glm::vec3(patch.m_x * nodeSize, patch.m_y * nodeSize, nodeSize));
+        uniforms.m_morphRange.Set(glm::vec2(morphStart, morphEnd));
+        uniforms.m_tileTransform.Set(glm::vec3(
+            0.5f / tileSamples - (patch.m_x / nodesPerTile) * tileWorldSize * uvScale,
+            0.5f / tileSamples - (patch.m_y / nodesPerTile) * tileWorldSize * uvScale,
+            uvScale));
+        uniforms.m_texelSize.Set(glm::vec2(1.0f / tileSamples, step * m_settings.m_sampleSpacing));
+
+        XGLState::BindTexture(GL_TEXTURE_2D, patch.m_texture);
+
+        m_grid->Draw(patch.m_quadrant < 0 ? wholeGrid : m_quadrants[patch.m_quadrant]);
+    }
+
+    XGLState::BindTexture(GL_TEXTURE_2D, 0);
+    XGLState::ActiveTexture(GL_TEXTURE0);
+}
+
+const Terrain::Uniforms& Terrain::GetUniforms(const ShaderProgramPtr& shader) const
+{
+    if (m_uniforms.m_program != shader)
+    {
+        m_uniforms.m_program = shader;
+        m_uniforms.m_nodeOffsetSize = shader->GetUniform<glm::vec3>("nodeOffsetSize");
+        m_uniforms.m_morphRange = shader->GetUniform<glm::vec2>("morphRange");
+        m_uniforms.m_tileTransform = shader->GetUniform<glm::vec3>("tileTransform");
+        m_uniforms.m_texelSize = shader->GetUniform<glm::vec2>("texelSize");
+        m_uniforms.m_gridSize = shader->GetUniform<float>("gridSize");
+        m_uniforms.m_heightScale = shader->GetUniform<float>("heightScale");
+        m_uniforms.m_heights = shader->GetUniform<int>("heights");
+    }
+
+    return m_uniforms;
+}
+
+void Terrain::LoaderLoop()
+{
+    const int tileSamples = m_settings.m_tileSize + 1;
+
+    for (;;)
+    {
+        LoadedTile loaded;
+
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [this]() { return m_exit || !m_requests.empty(); });
+
+            if (m_exit)
+            {
+                return;
+            }
+
+            loaded.m_key = m_requests.front();
+            m_requests.pop_front();
+            m_loading = loaded.m_key;
+        }
+
+        const int step = 1 << GetTileLevel(loaded.m_key);
+        const int originX = GetTileX(loaded.m_key) * m_settings.m_tileSize * step;
+        const int originY = GetTileY(loaded.m_key) * m_settings.m_tileSize * step;
+
+        loaded.m_samples.resize(tileSamples * tileSamples);
+
+        for (int row = 0; row < tileSamples; ++row)
+        {
+            m_heightmap->ReadRow(originY + row * step, originX, tileSamples, step,
+                &loaded.m_samples[row * tileSamples]);
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_loaded.push_back(std::move(loaded));
+        m_loading = kNoTile;
+    }
+}
+
+void Terrain::UploadLoaded()
+{
+    std::vector<LoadedTile> loaded;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        loaded.swap(m_loaded);
+    }
+
+    const int tileSamples = m_settings.m_tileSize + 1;
+
+    for (const LoadedTile& tileData : loaded)
+    {
+        if (m_tiles.count(tileData.m_key) != 0)
+        {
+            continue;
+        }
+
+        Tile tile;
+        tile.m_usedFrame = m_frame;
+
+        glGenTextures(1, &tile.m_texture);
+        XGLState::BindTexture(GL_TEXTURE_2D, tile.m_texture);
+
+        // Rows of odd samples count are not 4 byte aligned
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R16, tileSamples, tileSamples, 0,
+            GL_RED, GL_UNSIGNED_SHORT, tileData.m_samples.data());
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+        XGLState::BindTexture(GL_TEXTURE_2D, 0);
+
+        m_tiles[tileData.m_key] = tile;
+    }
+}
+
+void Terrain::EvictTiles()
+{
+    if (static_cast<int>(m_tiles.size()) <= m_settings.m_maxResidentTiles)
+    {
+        return;
+    }
+
+    std::vector<std::pair<uint32_t, uint64_t>> unused;
+
+    for (const auto& tile : m_tiles)
+    {
+        if (tile.second.m_usedFrame != m_frame)
+        {
+            unused.push_back(std::make_pair(tile.second.m_usedFrame, tile.first));
+        }
+    }
+
+    // Least recently used go first
+    std::sort(unused.begin(), unused.end());
+
+    for (const auto& tile : unused)
+    {
+        if (static_cast<int>(m_tiles.size()) <= m_settings.m_maxResidentTiles)
+        {
+            break;
+        }
+
+        XGLState::DeleteTextures(1, &m_tiles[tile.second].m_texture);
+        m_tiles.erase(tile.second);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "Base/Geom/BoundingBox.h"
+#include "Render/Camera.h"
+#include "Render/ElementBufferObject.h"
+#include "Scene/Heightmap.h"
+#include "Scene/Materials/IMaterial.h"
+
+struct TerrainSettings
+{
+    TerrainSettings() :
+        m_gridSize(32),
+        m_tileSize(256),
+        m_sampleSpacing(1.0f),
+        m_heightScale(256.0f),
+        m_lodDistance(64.0f),
+        m_morphFraction(0.3f),
+        m_maxResidentTiles(64)
+    {}
+
+    // Quads per patch side, power of two
+    int m_gridSize;
+    // Samples per height tile side, power of two multiple of grid size
+    int m_tileSize;
+    // World distance between neighbour samples
+    float m_sampleSpacing;
+    // World height of the largest sample
+    float m_heightScale;
+    // Range of the finest level, range doubles with every coarser level
+    float m_lodDistance;
+    // Far part of level range where vertices morph into coarser grid
+    float m_morphFraction;
+    int m_maxResidentTiles;
+};
+
+struct TerrainStats
+{
+    int m_patches;
+    int m_residentTiles;
+    int m_pendingLoads;
+};
+
+/* Heightmap terrain drawn with continuous distance-dependent LOD (CDLOD).
+ * Quadtree nodes of every level are drawn with the same small grid, node
+ * size doubles per level. Heights are sampled in vertex shader from
+ * tiles of the node level, the tiles are read from heightmap by
+ * background thread, so only tiles around the camera are in memory.
+ * Node height ranges come from min/max pyramid built on open.
+ */
+class Terrain
+{
+public:
+    Terrain();
+    ~Terrain();
+
+    Terrain(const Terrain&) = delete;
+
+    /* Reads the whole heightmap once to build min/max pyramid, then
+     * heightmap is used by the loader thread only. Must be called with
+     * GL context.
+     */
+    bool Open(const HeightmapPtr& heightmap, const TerrainSettings& settings = TerrainSettings(),
+        std::ostream* logstream = nullptr);
+
+    // Selects patches for the view, uploads loaded tiles and requests missing ones
+    void Update(const Camera& camera);
+
+    /* Material shader must use TerrainVS.glsl, Camera uniform block is
+     * bound by caller like for other models. Morphing uses the camera of
+     * the block, so it should be the one passed to Update.
+     */
+    void Draw(const IMaterialPtr& material) const;
+
+    BoundingBox3f GetBounds() const;
+    const TerrainStats& GetStats() const { return m_stats; }
+
+private:
+    struct Tile
+    {
+        GLuint m_texture;
+        uint32_t m_usedFrame;
+    };
+
+    struct Patch
+    {
+        int m_level;
+        int m_x;
+        int m_y;
+        // -1 for the whole node
+        int m_quadrant;
+        GLuint m_texture;
+    };
+
+    struct LoadedTile
+    {
+        uint64_t m_key;
+        std::vector<uint16_t> m_samples;
+    };
+
+    // Uniforms of TerrainVS.glsl, resolved again when material shader changes
+    struct Uniforms
+    {
+        ShaderProgramPtr m_program;
+        ShaderUniform<glm::vec3> m_nodeOffsetSize;
+        ShaderUniform<glm::vec2> m_morphRange;
+        ShaderUniform<glm::vec3> m_tileTransform;
+        ShaderUniform<glm::vec2> m_texelSize;
+        ShaderUniform<float> m_gridSize;
+        ShaderUniform<float> m_heightScale;
+        ShaderUniform<int> m_heights;
+    };
+
+    void Close();
+    void BuildMinMax();
+    void CreateGrid();
+
+    bool Select(int level, int x, int y, const Frustum& frustum,
+        const glm::vec3& cameraPosition, std::vector<uint64_t>* requests);
+    void AddPatch(int level, int x, int y, int quadrant, Tile* tile);
+
+    BoundingBox3f GetNodeBounds(int level, int x, int y) const;
+    uint64_t GetTileKey(int level, int nodeX, int nodeY) const;
+    Tile* FindTile(uint64_t key);
+
+    const Uniforms& GetUniforms(const ShaderProgramPtr& shader) const;
+
+    void LoaderLoop();
+    void UploadLoaded();
+    void EvictTiles();
+
+    HeightmapPtr m_heightmap;
+    TerrainSettings m_settings;
+    int m_levelsCount;
+
+    // Per level min and max sample of nodes, x fastest
+    std::vector<int> m_levelWidths;
+    std::vector<int> m_levelHeights;
+    std::vector<std::vector<uint16_t>> m_minMax;
+    std::vector<float> m_ranges;
+
+    ElementBufferObjectPtr m_grid;
+    // Index ranges of grid quadrants, x + 2y
+    IndexRange m_quadrants[4];
+
+    std::unordered_map<uint64_t, Tile> m_tiles;
+    std::vector<Patch> m_patches;
+    uint32_t m_frame;
+    TerrainStats m_stats;
+    mutable Uniforms m_uniforms;
+
+    // Shared with loader thread
+    std::thread m_loader;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::deque<uint64_t> m_requests;
+    std::vector<LoadedTile> m_loaded;
+    uint64_t m_loading;
+    bool m_exit;
+};
\ No newline at end of file
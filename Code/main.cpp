@@ -1,6 +1,8 @@
 ﻿//STL
+#include <algorithm>
 #include <iostream>
 #include <iomanip>
+#include <random>
 #include <vector>
 
 // GLEW
@@ -20,15 +22,27 @@
 #include <SOIL/SOIL.h>
 
 #include "Base/Stopwatch.h"
+#include "Base/Geom/SpatialOrder.h"
+#include "Base/Geom/TriangleBVH.h"
 #include "Base/Geom/VertexBlob.h"
 #include "Render/VertexBufferObject.h"
 #include "Render/ElementBufferObject.h"
 #include "Render/Shaders/ShaderProgram.h"
 #include "Render/Texture.h"
 #include "Render/Camera.h"
+#include "Render/CameraUniformBlock.h"
+#include "Render/GLState.h"
+#include "Render/VertexFormat.h"
 #include "Scene/Materials/TexturedMaterial.h"
 #include "Scene/Materials/ColoredMaterial.h"
+#include "Scene/FrustumCuller.h"
+#include "Scene/IndirectRenderer.h"
+#include "Scene/InstancedRenderer.h"
 #include "Scene/Model3d.h"
+#include "Scene/OcclusionQueries.h"
+#include "Scene/RenderQueue.h"
+#include "Scene/ScenePicker.h"
+#include "Scene/SceneTree.h"
 #include "Scene/Lights/LightsArray.h"
 
 namespace
@@ -273,6 +287,38 @@ namespace
         }
     }
 
+    // How scene models are submitted
+    enum class DrawMode
+    {
+        Instanced,
+        MultiDrawIndirect,
+        OcclusionQueries,
+        SortedQueue
+    };
+
+    static void ProcessDrawModeChange(DrawMode* drawMode)
+    {
+        if (g_keys[GLFW_KEY_LEFT_CONTROL])
+        {
+            if (g_keys[GLFW_KEY_I])
+            {
+                *drawMode = DrawMode::Instanced;
+            }
+            else if (g_keys[GLFW_KEY_M])
+            {
+                *drawMode = DrawMode::MultiDrawIndirect;
+            }
+            else if (g_keys[GLFW_KEY_O])
+            {
+                *drawMode = DrawMode::OcclusionQueries;
+            }
+            else if (g_keys[GLFW_KEY_Q])
+            {
+                *drawMode = DrawMode::SortedQueue;
+            }
+        }
+    }
+
     static void ProcessFlashlight(LightsArrayPtr& lights, const SpotLightPtr& spotLight)
     {
         if (g_keys[GLFW_KEY_LEFT_CONTROL])
@@ -289,6 +335,178 @@ namespace
         }
     }
 
+    // Average time of one query in microseconds
+    template<typename Query>
+    static double MeasureQueries(int repeats, const Query& query)
+    {
+        Stopwatch<std::chrono::high_resolution_clock> stopwatch;
+
+        for (int i = 0; i < repeats; ++i)
+        {
+            query(i);
+        }
+
+        return static_cast<double>(stopwatch.GetElapsedTime<std::chrono::nanoseconds>()) /
+            (1000.0 * repeats);
+    }
+
+    static void MeasureModelQueries(const std::vector<Model3dPtr>& models,
+        const std::vector<Frustum>& frustums, const char* name, std::ostream& logstream)
+    {
+        const int repeats = 8 * static_cast<int>(frustums.size());
+        FrustumCuller culler;
+        SceneTree tree(models);
+        std::vector<int> visible;
+
+        // First pass updates world boxes and warms up the caches
+        culler.Cull(frustums.front(), models, &visible);
+
+        const double cullerTime = MeasureQueries(repeats, [&](int i)
+        {
+            culler.Cull(frustums[i % frustums.size()], models, &visible);
+        });
+
+        const double treeTime = MeasureQueries(repeats, [&](int i)
+        {
+            visible.clear();
+            tree.Query(frustums[i % frustums.size()], &visible);
+        });
+
+        logstream << "    " << name << " models: frustum culler " << cullerTime
+            << " us, scene tree " << treeTime << " us" << std::endl;
+    }
+
+    static void MeasureMeshQueries(const VertexBlob& vertices, const std::vector<int>& indices,
+        const std::vector<Ray>& rays, const char* name, std::ostream& logstream)
+    {
+        const ArrayView<const Vector3f> positions = vertices.GetFieldView<VertexBlobField::Pos>();
+
+        Stopwatch<std::chrono::high_resolution_clock> stopwatch;
+        TriangleBVH tree(positions, indices);
+        const long long buildTime = stopwatch.GetElapsedTime<std::chrono::microseconds>();
+
+        const double rayTime = MeasureQueries(static_cast<int>(rays.size()), [&](int i)
+        {
+            RayHit hit;
+            tree.Intersect(rays[i], 100.0f, &hit);
+        });
+
+        logstream << "    " << name << " vertices: triangle BVH build " << buildTime
+            << " us, ray cast " << rayTime << " us" << std::endl;
+    }
+
+    /* Times scene queries on a big grid of cubes created in random order,
+     * then on the same cubes sorted with SortSpatially. Mesh part does the
+     * same for a shuffled height field and its ReorderVertices copy.
+     */
+    static void BenchmarkSpatialOrder(const Model3dPtr& cube, std::ostream& logstream)
+    {
+        const int modelsPerAxis = 32;
+        const int verticesPerAxis = 256;
+        const int viewsCount = 32;
+        const int raysCount = 4096;
+        const float spacing = 3.0f;
+
+        std::mt19937 random(1);
+
+        std::vector<Model3dPtr> models;
+        models.reserve(modelsPerAxis * modelsPerAxis * modelsPerAxis);
+
+        for (int x = 0; x < modelsPerAxis; ++x)
+        {
+            for (int y = 0; y < modelsPerAxis; ++y)
+            {
+                for (int z = 0; z < modelsPerAxis; ++z)
+                {
+                    Model3dPtr model = CreateTestCube(cube, cube->GetMaterial());
+                    model->SetMatrix(glm::translate(glm::mat4(),
+                        spacing * glm::vec3(float(x), float(y), float(z))));
+                    models.push_back(model);
+                }
+            }
+        }
+
+        std::shuffle(models.begin(), models.end(), random);
+
+        // Cameras on a circle around the grid looking at its center
+        const glm::vec3 center(spacing * modelsPerAxis * 0.5f);
+        Camera camera(1.0f, 0.1f, 100.f);
+        std::vector<Frustum> frustums;
+
+        for (int i = 0; i < viewsCount; ++i)
+        {
+            const float angle = 2.0f * static_cast<float>(M_PI) * i / viewsCount;
+            const glm::vec3 position = center + 60.0f * glm::vec3(std::cos(angle), 0.3f, std::sin(angle));
+
+            camera.SetPosition(position);
+            camera.SetFront(glm::normalize(center - position));
+            frustums.push_back(camera.GetFrustum());
+        }
+
+        logstream << "Spatial order benchmark, " << models.size() << " models, "
+            << frustums.size() << " views" << std::endl;
+
+        MeasureModelQueries(models, frustums, "Shuffled", logstream);
+
+        SortSpatially(models, [](const Model3dPtr& model) { return model->GetBoundingBox(); });
+        MeasureModelQueries(models, frustums, "Sorted", logstream);
+
+        // Height field with vertices stored in random order
+        std::vector<int> order(verticesPerAxis * verticesPerAxis);
+
+        for (size_t i = 0; i < order.size(); ++i)
+        {
+            order[i] = static_cast<int>(i);
+        }
+
+        std::shuffle(order.begin(), order.end(), random);
+
+        VertexBlob vertices(VertexBlobField::Pos, static_cast<int>(order.size()));
+        ArrayView<Vector3f> positions = vertices.GetFieldView<VertexBlobField::Pos>();
+
+        for (int x = 0; x < verticesPerAxis; ++x)
+        {
+            for (int z = 0; z < verticesPerAxis; ++z)
+            {
+                positions[order[x * verticesPerAxis + z]] =
+                    Vector3f(0.1f * x, std::sin(0.05f * x) * std::cos(0.05f * z), 0.1f * z);
+            }
+        }
+
+        std::vector<int> indices;
+
+        for (int x = 0; x + 1 < verticesPerAxis; ++x)
+        {
+            for (int z = 0; z + 1 < verticesPerAxis; ++z)
+            {
+                const int corner = x * verticesPerAxis + z;
+                const int quad[] = { corner, corner + verticesPerAxis, corner + verticesPerAxis + 1, corner + 1 };
+
+                for (int i : { 0, 1, 2, 0, 2, 3 })
+                {
+                    indices.push_back(order[quad[i]]);
+                }
+            }
+        }
+
+        std::uniform_real_distribution<float> distribution(0.0f, 0.1f * verticesPerAxis);
+        std::vector<Ray> rays;
+
+        for (int i = 0; i < raysCount; ++i)
+        {
+            rays.emplace_back(Vector3f(distribution(random), 10.0f, distribution(random)),
+                Vector3f(0.0f, -1.0f, 0.0f));
+        }
+
+        logstream << "    Height field, " << indices.size() / 3 << " triangles, "
+            << rays.size() << " rays" << std::endl;
+
+        MeasureMeshQueries(vertices, indices, rays, "Shuffled", logstream);
+
+        const VertexBlobPtr reordered = ReorderVertices(vertices, &indices);
+        MeasureMeshQueries(*reordered, indices, rays, "Reordered", logstream);
+    }
+
     void GLAPIENTRY DebugGl(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* message, const void* userParam)
     {
         userParam;
@@ -515,6 +733,10 @@ void main()
     ShaderProgramPtr coloredMaterialShader = std::make_shared<ShaderProgram>(
         lights->GetShader()->GetVertexShader(), coloredMatFS, &logstream);
 
+    VertexShaderPtr boundingBoxVS = std::make_shared<VertexShader>("Data\\Shaders\\BoundingBoxVS.glsl", nullptr, &logstream);
+    ShaderProgramPtr boundingBoxShader = std::make_shared<ShaderProgram>(
+        boundingBoxVS, coloredMatFS, &logstream);
+
     // Define the viewport dimensions
     glViewport(0, 0, WIDTH, HEIGHT);
 
@@ -532,6 +754,9 @@ void main()
     specularTexture->SetWrapping(Texture2DAxis::T, TextureWrappingType::ClampToBorder);
     specularTexture->SetClampBorderColor(Vector4f(0.f, 0.f, 0.f, 0.f));
 
+    // Meshes loaded or generated more than once are uploaded once
+    Model3d::SetContentDeduplication(true);
+
     std::vector<Model3dPtr> models;
     IMaterialPtr material = std::make_shared<TexturedMaterial>(lights->GetShader());
     static_cast<TexturedMaterial*>(material.get())->SetAmbient(diffuseTexture);
@@ -585,6 +810,23 @@ void main()
     g_camera.SetFront(glm::normalize(glm::vec3(1.f, 1.f, -1.f)));
 
     Stopwatch<std::chrono::high_resolution_clock> stopwatch;
+    FrustumCuller culler;
+    std::vector<int> visibleModels;
+    OcclusionQueries occlusionQueries(boundingBoxShader);
+    InstancedRenderer instancedRenderer;
+    IndirectRenderer indirectRenderer;
+    RenderQueue renderQueue;
+    indirectRenderer.SetModels(models);
+    DrawMode drawMode = DrawMode::Instanced;
+
+    // Camera data is shared by all programs through uniform block
+    CameraUniformBlock cameraBlock;
+    cameraBlock.Bind();
+
+    SceneTree sceneTree(models);
+    ScenePicker picker(sceneTree);
+    bool pickButtonPressed = false;
+    bool benchmarkKeysPressed = false;
 
     double lastCursorPos[2];
     glfwGetCursorPos(window, lastCursorPos, lastCursorPos + 1);
@@ -602,6 +844,9 @@ void main()
         */
         glfwPollEvents();
 
+        // Issued and filtered GL calls are counted per frame
+        XGLState::ResetStats();
+
         // Render
         // Clear the colorbuffer
         //glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
@@ -647,12 +892,7 @@ void main()
         auto dt = stopwatch.GetElapsedTime<std::chrono::nanoseconds>();
         val += static_cast<float>(dt) / 1.0e+10f;
 
-        lights->PrepareContext();
-
-        coloredMaterialShader->Use();
-        glUniformMatrix4fv(coloredMaterialShader->GetUniformLocation("view"), 1, GL_FALSE, glm::value_ptr(g_camera.GetViewMatrix()));
-        glUniformMatrix4fv(coloredMaterialShader->GetUniformLocation("projection"), 1, GL_FALSE, glm::value_ptr(projection));
-
+        cameraBlock.Update(g_camera);
 
         auto& ptLights = lights->GetPointLights();
         for (size_t pointLightIndex = 0; pointLightIndex < ptLights.size(); ++pointLightIndex)
@@ -662,21 +902,16 @@ void main()
             pointLight->SetAttenuation().SetDistance(distance);
         }
 
-        for (auto& obj : lightSourceObjects)
+        // After lights are changed for this frame
+        lights->PrepareContext();
+
+        // Sorted queue draws light sources along with scene models
+        if (drawMode != DrawMode::SortedQueue)
         {
-            obj->Draw();
+            instancedRenderer.Draw(lightSourceObjects);
         }
 
         //Draw scene models
-        lights->GetShader()->Use();
-
-        glUniform3f(lights->GetShader()->GetUniformLocation("viewPosition"),
-            g_camera.GetPosition().x, g_camera.GetPosition().y, g_camera.GetPosition().z);
-        glUniformMatrix4fv(lights->GetShader()->GetUniformLocation("view"),
-            1, GL_FALSE, glm::value_ptr(g_camera.GetViewMatrix()));
-        glUniformMatrix4fv(lights->GetShader()->GetUniformLocation("projection"),
-            1, GL_FALSE, glm::value_ptr(projection));
-
         for (size_t i = 0; i < models.size(); ++i)
         {
             auto& model = models[i];
@@ -689,8 +924,59 @@ void main()
             matrix = glm::rotate(matrix, glm::radians(sin(val)), glm::vec3(.0f, 1.f, 0.f));
             matrix = glm::rotate(matrix, glm::radians(sin(val)), glm::vec3(.0f, 0.f, 1.f));
             model->SetMatrix(matrix);
+        }
+
+        sceneTree.Update();
 
-            model->Draw();
+        // Small budget keeps the frame time flat while gaps are closed
+        Model3d::DefragmentBuffers(1 << 20);
+
+        // Pick on right button press, left one rotates the camera
+        const bool pickButtonState =
+            glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_PRESS;
+
+        if (pickButtonState && !pickButtonPressed)
+        {
+            PickResult pick;
+
+            if (picker.Pick(g_camera.GetRay(normCoords[0], normCoords[1]), g_camera.GetFar(), &pick))
+            {
+                logstream << "Picked model " << pick.m_model
+                    << ", triangle " << pick.m_triangle
+                    << ", distance " << pick.m_distance << std::endl;
+            }
+        }
+
+        pickButtonPressed = pickButtonState;
+
+        // Ctrl+B logs timings of spatial queries with and without spatial ordering
+        const bool benchmarkKeysState = g_keys[GLFW_KEY_LEFT_CONTROL] && g_keys[GLFW_KEY_B];
+
+        if (benchmarkKeysState && !benchmarkKeysPressed)
+        {
+            BenchmarkSpatialOrder(models.front(), logstream);
+        }
+
+        benchmarkKeysPressed = benchmarkKeysState;
+
+        culler.Cull(g_camera.GetFrustum(), models, &visibleModels);
+
+        switch (drawMode)
+        {
+        case DrawMode::Instanced:
+            instancedRenderer.Draw(models, visibleModels);
+            break;
+        case DrawMode::MultiDrawIndirect:
+            indirectRenderer.Draw(visibleModels);
+            break;
+        case DrawMode::OcclusionQueries:
+            occlusionQueries.Draw(projection * g_camera.GetViewMatrix(), models, visibleModels);
+            break;
+        case DrawMode::SortedQueue:
+            renderQueue.Submit(g_camera, lightSourceObjects);
+            renderQueue.Submit(g_camera, models, visibleModels);
+            renderQueue.Execute();
+            break;
         }
 
         stopwatch.Start();
@@ -706,6 +992,7 @@ void main()
 
         ProcessPolygonModeChange(material);
         ProcessFlashlight(lights, flashLight);
+        ProcessDrawModeChange(&drawMode);
         for (const auto& coloredMaterial : coloredMaterials)
         {
             ProcessPolygonModeChange(coloredMaterial);
@@ -713,6 +1000,9 @@ void main()
         glfwSwapBuffers(window);
     }
 
+    // GL objects must go before the context does
+    XVertexFormat::ReleaseSharedVertexArrays();
+
     // Terminate GLFW, clearing any resources allocated by GLFW.
     glfwTerminate();
 
@@ -0,0 +1,13 @@
+#version 330 core
+
+// Unit cube scaled to world space bounding box
+layout (location = 0) in vec3 position;
+
+uniform mat4 viewProjection;
+uniform vec3 boxMin;
+uniform vec3 boxMax;
+
+void main()
+{
+    gl_Position = viewProjection * vec4(mix(boxMin, boxMax, position), 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,36 @@
+#version 330 core
+
+uniform sampler2D atlas;
+uniform float framesPerSide;
+
+in vec2 Corner;
+flat in vec2 OctahedralCoords;
+
+out vec4 color;
+
+vec4 SampleFrame(vec2 frame)
+{
+    frame = clamp(frame, vec2(0.0), vec2(framesPerSide - 1.0));
+    return texture(atlas, (frame + Corner) / framesPerSide);
+}
+
+void main()
+{
+    // Frame centers are at half integer grid positions
+    vec2 grid = OctahedralCoords * framesPerSide - 0.5;
+    vec2 frame = floor(grid);
+    vec2 weight = grid - frame;
+
+    vec4 result = mix(
+        mix(SampleFrame(frame), SampleFrame(frame + vec2(1.0, 0.0)), weight.x),
+        mix(SampleFrame(frame + vec2(0.0, 1.0)), SampleFrame(frame + vec2(1.0, 1.0)), weight.x),
+        weight.y);
+
+    if (result.a < 0.5)
+    {
+        discard;
+    }
+
+    // Blended edges are darkened by empty texels, alpha restores them
+    color = vec4(result.rgb / result.a, 1.0);
+}
\ No newline at end of file
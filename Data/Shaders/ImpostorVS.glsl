@@ -0,0 +1,38 @@
+#version 330 core
+
+layout (location = 0) in vec3 position;
+// Model space direction from the model to the camera
+layout (location = 1) in vec3 viewDirection;
+// Quad corner in [0, 1]
+layout (location = 2) in vec2 corner;
+
+uniform mat4 viewProjection;
+
+out vec2 Corner;
+flat out vec2 OctahedralCoords;
+
+vec2 SignNotZero(vec2 v)
+{
+    return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+// Same mapping as XImpostor::EncodeDirection
+vec2 EncodeDirection(vec3 direction)
+{
+    vec3 d = direction / (abs(direction.x) + abs(direction.y) + abs(direction.z));
+    vec2 p = d.xz;
+
+    if (d.y < 0.0)
+    {
+        p = (1.0 - abs(p.yx)) * SignNotZero(p);
+    }
+
+    return p * 0.5 + 0.5;
+}
+
+void main()
+{
+    gl_Position = viewProjection * vec4(position, 1.0);
+    Corner = corner;
+    OctahedralCoords = EncodeDirection(viewDirection);
+}
\ No newline at end of file
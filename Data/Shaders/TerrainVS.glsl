@@ -0,0 +1,66 @@
+#version 330 core
+
+// Grid vertex in [0, 1] range on xz plane
+layout (location = 0) in vec3 position;
+
+layout (std140) uniform Camera
+{
+    mat4 view;
+    mat4 projection;
+    vec3 viewPosition;
+};
+
+// World xz offset and size of the node
+uniform vec3 nodeOffsetSize;
+// Distances where morphing into coarser grid starts and ends
+uniform vec2 morphRange;
+// Tile coordinates of world xz are xy + world * z
+uniform vec3 tileTransform;
+// Texel size in tile coordinates and in world units
+uniform vec2 texelSize;
+uniform float gridSize;
+uniform float heightScale;
+uniform sampler2D heights;
+
+out vec3 Normal;
+out vec3 FragmentPosition;
+out vec2 TextureCoords;
+out vec4 BakedLight;
+
+float SampleHeight(vec2 coords)
+{
+    return texture(heights, coords).r * heightScale;
+}
+
+void main()
+{
+    vec2 gridPosition = position.xz;
+    vec2 world = nodeOffsetSize.xy + gridPosition * nodeOffsetSize.z;
+
+    float distanceToView = distance(viewPosition,
+        vec3(world.x, SampleHeight(tileTransform.xy + world * tileTransform.z), world.y));
+    float morph = clamp((distanceToView - morphRange.x) /
+        max(morphRange.y - morphRange.x, 0.0001), 0.0, 1.0);
+
+    // Odd vertices slide onto edges of the twice coarser grid
+    vec2 oddOffset = fract(gridPosition * gridSize * 0.5) * 2.0 / gridSize;
+    gridPosition -= oddOffset * morph;
+    world = nodeOffsetSize.xy + gridPosition * nodeOffsetSize.z;
+
+    vec2 coords = tileTransform.xy + world * tileTransform.z;
+    float height = SampleHeight(coords);
+
+    float left = SampleHeight(coords - vec2(texelSize.x, 0.0));
+    float right = SampleHeight(coords + vec2(texelSize.x, 0.0));
+    float back = SampleHeight(coords - vec2(0.0, texelSize.x));
+    float front = SampleHeight(coords + vec2(0.0, texelSize.x));
+
+    FragmentPosition = vec3(world.x, height, world.y);
+    gl_Position = projection * view * vec4(FragmentPosition, 1.0);
+
+    Normal = normalize(vec3(left - right, 2.0 * texelSize.y, back - front));
+    TextureCoords = world;
+
+    // No baked lighting, full ambient occlusion factor
+    BakedLight = vec4(0.0, 0.0, 0.0, 1.0);
+}
\ No newline at end of file
@@ -28,6 +28,11 @@ in vec3 FragmentPosition;
 in vec3 Normal;
 in vec2 TextureCoords;
 
+#ifdef BAKED_LIGHTING
+    // Static lights irradiance and ambient occlusion
+    in vec4 BakedLight;
+#endif //BAKED_LIGHTING
+
 #ifdef POINT_LIGHTS
     #ifndef POINT_LIGHTS_CAPACITY
         #error "POINT_LIGHTS_CAPACITY macro is not defined"
@@ -41,9 +46,6 @@ in vec2 TextureCoords;
         Color color;
     };
 
-    uniform int pointLightsCount;
-    uniform PointLight pointLights[POINT_LIGHTS_CAPACITY];
-
     vec3 CalculatePointLight(in PointLight light, in vec3 normal, in vec3 fragmentPosition, in vec3 viewDirection);
 #endif //POINT_LIGHTS
 
@@ -58,9 +60,6 @@ in vec2 TextureCoords;
         Color color;
     };
 
-    uniform int directionalLightsCount;
-    uniform DirectionalLight directionalLights[DIRECTIONAL_LIGHTS_CAPACITY];
-
     vec3 CalculateDirectionalLight(in DirectionalLight light, in vec3 normal, in vec3 viewDirection);
 #endif //DIRECTIONAL_LIGHTS
 
@@ -79,14 +78,37 @@ in vec2 TextureCoords;
         Color color;
     };
 
-    uniform int spotLightsCount;
-    uniform SpotLight spotLights[SPOT_LIGHTS_CAPACITY];
-
     vec3 CalculateSpotLight(in SpotLight light, in vec3 normal, in vec3 fragmentPosition, in vec3 viewDirection);
 #endif //SPOT_LIGHTS
 
+// Filled by LightsArray, which defines all kinds of lights
+layout (std140) uniform Lights
+{
+    int pointLightsCount;
+    int directionalLightsCount;
+    int spotLightsCount;
+
+    #ifdef POINT_LIGHTS
+    PointLight pointLights[POINT_LIGHTS_CAPACITY];
+    #endif //POINT_LIGHTS
+
+    #ifdef DIRECTIONAL_LIGHTS
+    DirectionalLight directionalLights[DIRECTIONAL_LIGHTS_CAPACITY];
+    #endif //DIRECTIONAL_LIGHTS
+
+    #ifdef SPOT_LIGHTS
+    SpotLight spotLights[SPOT_LIGHTS_CAPACITY];
+    #endif //SPOT_LIGHTS
+};
+
+layout (std140) uniform Camera
+{
+    mat4 view;
+    mat4 projection;
+    vec3 viewPosition;
+};
+
 uniform TexturedMaterial material;
-uniform vec3 viewPosition;
 
 out vec4 color;
 
@@ -98,6 +120,10 @@ void main()
 
     vec3 result = vec3(0.0, 0.0, 0.0);
 
+    #ifdef BAKED_LIGHTING
+    result += BakedLight.rgb * vec3(texture(material.diffuse, TextureCoords));
+    #endif //BAKED_LIGHTING
+
     #ifdef POINT_LIGHTS
     for(int i = 0; i < pointLightsCount; ++i)
     {
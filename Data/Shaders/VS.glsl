@@ -3,23 +3,39 @@
 layout (location = 0) in vec3 position;
 layout (location = 1) in vec3 normal;
 layout (location = 2) in vec2 textureCoords;
+layout (location = 4) in vec4 bakedLight;
+// Per instance attributes of InstancedRenderer
+layout (location = 5) in mat4 instanceModel;
+layout (location = 9) in mat3 instanceNormalMatrix;
 
 uniform mat4 model;
 uniform mat3 normalMatrix;
-uniform mat4 view;
-uniform mat4 projection;
+// Matrices are taken from instance attributes instead of uniforms
+uniform bool instanced;
+
+layout (std140) uniform Camera
+{
+    mat4 view;
+    mat4 projection;
+    vec3 viewPosition;
+};
 
 out vec3 Normal;
 out vec3 FragmentPosition;
 out vec2 TextureCoords;
+out vec4 BakedLight;
 
 void main()
 {
-    gl_Position = projection * view * model
+    mat4 modelMatrix = instanced ? instanceModel : model;
+    mat3 normalModelMatrix = instanced ? instanceNormalMatrix : normalMatrix;
+
+    gl_Position = projection * view * modelMatrix
         * vec4(position.x, position.y, position.z, 1.0);
 
-    FragmentPosition = vec3(model * vec4(position, 1.0f));
+    FragmentPosition = vec3(modelMatrix * vec4(position, 1.0f));
 
-    Normal = normalMatrix * normal;
+    Normal = normalModelMatrix * normal;
     TextureCoords = textureCoords;
+    BakedLight = bakedLight;
 }
\ No newline at end of file